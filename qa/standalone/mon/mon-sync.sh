@@ -0,0 +1,126 @@
+#!/usr/bin/env bash
+
+source $CEPH_ROOT/qa/standalone/ceph-helpers.sh
+
+function run() {
+    local dir=$1
+    shift
+
+    export CEPH_MON_A="127.0.0.1:7160" # git grep '\<7160\>' : there must be only one
+    export CEPH_MON_B="127.0.0.1:7161" # git grep '\<7161\>' : there must be only one
+    export CEPH_MON_C="127.0.0.1:7162" # git grep '\<7162\>' : there must be only one
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+
+    export BASE_CEPH_ARGS=$CEPH_ARGS
+    CEPH_ARGS+="--mon-host=$CEPH_MON_A "
+
+    local funcs=${@:-$(set | sed -n -e 's/^\(TEST_[0-9a-z_]*\) .*/\1/p')}
+    for func in $funcs ; do
+        setup $dir || return 1
+        $func $dir || return 1
+        teardown $dir || return 1
+    done
+}
+
+# restart a mon on its existing store
+function restart_mon() {
+    local dir=$1
+    shift
+    local id=$1
+    shift
+
+    kill_daemons $dir TERM mon.$id || return 1
+    ceph-mon \
+        --id $id \
+        --paxos-propose-interval=0.1 \
+        --debug-mon 20 \
+        --debug-paxos 20 \
+        --chdir= \
+        --mon-data=$dir/$id \
+        --log-file=$dir/\$name.log \
+        --admin-socket=$(get_asok_path) \
+        --run-dir=$dir \
+        --pid-file=$dir/\$name.pid \
+        "$@" || return 1
+}
+
+function fill_store() {
+    local count=$1
+
+    for i in $(seq 1 $count) ; do
+        ceph config-key set test/$i $(printf 'v%.0s' {1..512})$i > /dev/null || return 1
+    done
+}
+
+function check_store() {
+    local count=$1
+
+    for i in 1 $((count / 2)) $count ; do
+        ceph config-key get test/$i | grep -q "v$i\$" || return 1
+    done
+}
+
+function TEST_mon_sync_full() {
+    local dir=$1
+
+    run_mon $dir a --public-addr $CEPH_MON_A || return 1
+    run_mon $dir b --public-addr $CEPH_MON_B || return 1
+    CEPH_ARGS="$BASE_CEPH_ARGS --mon-host=$CEPH_MON_A,$CEPH_MON_B"
+    wait_for_quorum 300 2 || return 1
+    fill_store 500 || return 1
+
+    # mon.b pulls the whole store again, in small chunks, fetching the
+    # next chunk while the previous ones are written
+    ceph daemon mon.b sync_force --yes-i-really-mean-it || return 1
+    restart_mon $dir b --public-addr $CEPH_MON_B \
+        --mon-sync-max-payload-size 4096 || return 1
+    wait_for_quorum 300 2 || return 1
+
+    grep -q 'chunks pending' $dir/mon.b.log || return 1
+    CEPH_ARGS="$BASE_CEPH_ARGS --mon-host=$CEPH_MON_B"
+    check_store 500 || return 1
+}
+
+function TEST_mon_sync_resume() {
+    local dir=$1
+
+    run_mon $dir a --public-addr $CEPH_MON_A || return 1
+    run_mon $dir b --public-addr $CEPH_MON_B || return 1
+    run_mon $dir c --public-addr $CEPH_MON_C || return 1
+    CEPH_ARGS="$BASE_CEPH_ARGS --mon-host=$CEPH_MON_A,$CEPH_MON_B,$CEPH_MON_C"
+    wait_for_quorum 300 3 || return 1
+    fill_store 500 || return 1
+
+    # mon.c syncs slowly...
+    ceph daemon mon.c sync_force --yes-i-really-mean-it || return 1
+    restart_mon $dir c --public-addr $CEPH_MON_C \
+        --mon-sync-max-payload-size 4096 \
+        --mon-sync-timeout 5 \
+        --mon-inject-sync-get-chunk-delay 0.2 || return 1
+
+    # ... and its provider goes away half way
+    for i in $(seq 1 60) ; do
+        test $(grep -c 'handle_sync_chunk mon_sync(chunk' $dir/mon.c.log) -gt 10 && \
+            break
+        sleep 1
+    done
+    local provider=b
+    if grep 'sync_start ' $dir/mon.c.log | tail -1 | grep -q ':7160' ; then
+        provider=a
+    fi
+    kill_daemons $dir TERM mon.$provider || return 1
+
+    # mon.c goes on with the other mon, after the keys it already has
+    wait_for_quorum 300 2 || return 1
+    grep -q 'resuming sync after key' $dir/mon.c.log || return 1
+    ! grep -q 'provider did not resume' $dir/mon.c.log || return 1
+    CEPH_ARGS="$BASE_CEPH_ARGS --mon-host=$CEPH_MON_C"
+    check_store 500 || return 1
+}
+
+main mon-sync "$@"
+
+# Local Variables:
+# compile-command: "cd ../.. ; make -j4 && test/mon/mon-sync.sh"
+# End:
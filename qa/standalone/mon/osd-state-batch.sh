@@ -0,0 +1,78 @@
+#!/usr/bin/env bash
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Library Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Library Public License for more details.
+#
+source $CEPH_ROOT/qa/standalone/ceph-helpers.sh
+
+function run() {
+    local dir=$1
+    shift
+
+    export CEPH_MON="127.0.0.1:7306" # git grep '\<7306\>' : there must be only one
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+    CEPH_ARGS+="--mon-host=$CEPH_MON "
+
+    local funcs=${@:-$(set | sed -n -e 's/^\(TEST_[0-9a-z_]*\) .*/\1/p')}
+    for func in $funcs ; do
+        setup $dir || return 1
+        $func $dir || return 1
+        teardown $dir || return 1
+    done
+}
+
+function get_epoch() {
+    ceph osd dump --format=json | jq '.epoch'
+}
+
+#
+# OSDs that boot within mon_osd_state_batch_window of each other go up
+# in the same epoch, even with other services (e.g. the cluster log of
+# each boot) proposing in between.
+#
+function TEST_batch_boots() {
+    local dir=$1
+    local osds="0 1 2"
+
+    run_mon $dir a --mon-osd-state-batch-window=5 || return 1
+    for id in $osds ; do
+        run_osd $dir $id || return 1
+    done
+
+    kill_daemons $dir TERM osd || return 1
+    for id in $osds ; do
+        wait_for_osd down $id || return 1
+    done
+    local before=$(get_epoch)
+
+    for id in $osds ; do
+        activate_osd $dir $id &
+    done
+    wait
+    for id in $osds ; do
+        wait_for_osd up $id || return 1
+    done
+    local after=$(get_epoch)
+
+    # all three in one epoch, or two if the window closed in between
+    echo "boots took epochs $before..$after"
+    test $((after - before)) -le 2 || return 1
+
+    local saved=$(CEPH_ARGS='' ceph --admin-daemon $(get_asok_path mon.a) \
+        perf dump mon | jq '.mon.osd_state_epochs_saved')
+    test $saved -gt 0 || return 1
+}
+
+main osd-state-batch "$@"
+
+# Local Variables:
+# compile-command: "cd ../../.. ; make -j4 && qa/standalone/mon/osd-state-batch.sh"
+# End:
@@ -0,0 +1,74 @@
+#!/usr/bin/env bash
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Library Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Library Public License for more details.
+#
+source $CEPH_ROOT/qa/standalone/ceph-helpers.sh
+
+function run() {
+    local dir=$1
+    shift
+
+    export CEPH_MON="127.0.0.1:7307" # git grep '\<7307\>' : there must be only one
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+    CEPH_ARGS+="--mon-host=$CEPH_MON "
+
+    local funcs=${@:-$(set | sed -n -e 's/^\(TEST_[0-9a-z_]*\) .*/\1/p')}
+    for func in $funcs ; do
+        setup $dir || return 1
+        $func $dir || return 1
+        teardown $dir || return 1
+    done
+}
+
+function paxos_perf() {
+    CEPH_ARGS='' ceph --admin-daemon $(get_asok_path mon.a) \
+        perf dump paxos | jq "$1"
+}
+
+#
+# With several services changing at once, those waiting for their
+# proposal timer join the rounds that the others start.
+#
+function TEST_batch_services() {
+    local dir=$1
+
+    run_mon $dir a --paxos-propose-interval=2 || return 1
+    ceph osd pool create foo 8 || return 1
+
+    local rounds=$(paxos_perf '.paxos.propose_values.avgcount')
+    local values=$(paxos_perf '.paxos.propose_values.sum')
+    local pids=""
+    for i in $(seq 1 5) ; do
+        ceph log "storm $i" &
+        pids+=" $!"
+        ceph config set mon.a debug_ms $i &
+        pids+=" $!"
+        ceph config set osd osd_max_backfills $i &
+        pids+=" $!"
+        ceph osd pool set foo target_size_ratio 0.$i &
+        pids+=" $!"
+        sleep 0.5
+    done
+    wait $pids
+    rounds=$(($(paxos_perf '.paxos.propose_values.avgcount') - rounds))
+    values=$(($(paxos_perf '.paxos.propose_values.sum') - values))
+    echo "$values proposals in $rounds rounds"
+
+    test $(paxos_perf '.paxos.propose_piggyback') -gt 0 || return 1
+    test $values -gt $rounds || return 1
+}
+
+main paxos-batch "$@"
+
+# Local Variables:
+# compile-command: "cd ../../.. ; make -j4 && qa/standalone/mon/paxos-batch.sh"
+# End:
@@ -0,0 +1,71 @@
+#!/usr/bin/env bash
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Library Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Library Public License for more details.
+#
+source $CEPH_ROOT/qa/standalone/ceph-helpers.sh
+
+function run() {
+    local dir=$1
+    shift
+
+    export CEPH_MON="127.0.0.1:7305" # git grep '\<7305\>' : there must be only one
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+    CEPH_ARGS+="--mon-host=$CEPH_MON "
+    CEPH_ARGS+="--mon-osd-range-incremental-min-epochs=8 "
+
+    local funcs=${@:-$(set | sed -n -e 's/^\(TEST_[0-9a-z_]*\) .*/\1/p')}
+    for func in $funcs ; do
+        $func $dir || return 1
+    done
+}
+
+#
+# An osd that comes back far behind asks for the missing epochs through
+# the subscription it shares with its objecter, which would otherwise
+# ask for range incrementals.  It must get every epoch.
+#
+function TEST_osd_catch_up() {
+    local dir=$1
+
+    setup $dir || return 1
+    run_mon $dir a --osd_pool_default_size=1 || return 1
+    run_mgr $dir x || return 1
+    run_osd $dir 0 || return 1
+    run_osd $dir 1 || return 1
+    create_rbd_pool || return 1
+    wait_for_clean || return 1
+
+    kill_daemons $dir TERM osd.1 || return 1
+    ceph osd down 1 || return 1
+    for i in $(seq 1 20) ; do
+        ceph osd set noscrub || return 1
+        ceph osd unset noscrub || return 1
+    done
+    local epoch=$(ceph osd dump -f json | jq '.epoch')
+
+    activate_osd $dir 1 || return 1
+    wait_for_osd up 1 || return 1
+    wait_for_clean || return 1
+    local newest=$(CEPH_ARGS='' ceph --admin-daemon $(get_asok_path osd.1) \
+        status | jq '.newest_map')
+    test $newest -ge $epoch || return 1
+    ! grep -q 'MOSDMap lied' $dir/osd.1.log || return 1
+    ! grep -q 'send_incremental range' $dir/mon.a.log || return 1
+
+    teardown $dir || return 1
+}
+
+main osd-range-incremental "$@"
+
+# Local Variables:
+# compile-command: "cd ../../.. ; make -j4 && qa/standalone/osd/osd-range-incremental.sh"
+# End:
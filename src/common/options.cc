@@ -1348,6 +1348,13 @@ std::vector<Option> get_global_options() {
     .add_service("mon")
     .set_description("The minimum amount of bytes to be kept mapped in memory for osd monitor caches."),
 
+    Option("mon_osd_range_incremental_min_epochs", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64)
+    .add_service("mon")
+    .set_description("Minimum number of epochs a client must be behind to get an osdmap range incremental (0 to disable)")
+    .set_long_description("A client that asks for range incrementals and is at least this many epochs behind gets a single delta between its osdmap and the latest one instead of one incremental per epoch.  Deltas are cached along with the incrementals.")
+    .add_see_also("objecter_range_incremental"),
+
     Option("mon_memory_target", Option::TYPE_SIZE, Option::LEVEL_BASIC)
     .set_default(2_G)
     .set_flag(Option::FLAG_RUNTIME)
@@ -1370,6 +1377,13 @@ std::vector<Option> get_global_options() {
     .add_service("mon")
     .set_description("granularity of PG placement calculation background work"),
 
+    Option("mon_osd_mapping_incremental", Option::TYPE_BOOL, Option::LEVEL_DEV)
+    .set_default(true)
+    .add_service("mon")
+    .set_description("only recompute the PG mappings an osdmap incremental may change")
+    .set_long_description("When a new osdmap epoch only changes the state of some OSDs, pools, pg_temp or upmap entries, recompute the placement of the PGs that can be affected by it instead of every PG in the cluster.  A crush map change always remaps everything.")
+    .add_see_also("mon_osd_mapping_pgs_per_chunk"),
+
     Option("mon_clean_pg_upmaps_per_chunk", Option::TYPE_UINT, Option::LEVEL_DEV)
     .set_default(256)
     .add_service("mon")
@@ -1526,6 +1540,14 @@ std::vector<Option> get_global_options() {
     .set_description("lease interval between quorum monitors (seconds)")
     .set_long_description("This setting controls how sensitive your mon quorum is to intermittent network issues or other failures."),
 
+    Option("mon_lease_read_max_staleness", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min(0)
+    .add_service("mon")
+    .set_description("how long past the end of its lease a peon keeps answering read-only requests (seconds, 0 to disable)")
+    .set_long_description("A peon whose lease has run out normally holds read-only commands and map version queries until the leader renews the lease or a new election finishes.  Within this many seconds of the lease running out, it answers them from its local store instead.  No value can be committed without the peon before its lease ends, so an answer is at most about this much older than the cluster state, give or take clock drift.  Requests that modify state are never affected.")
+    .add_see_also("mon_lease"),
+
     Option("mon_lease_renew_interval_factor", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(.6)
     .set_min_max((double)0.0, (double).9999999)
@@ -1803,6 +1825,43 @@ std::vector<Option> get_global_options() {
     .add_service("mon")
     .set_description("number of recent cluster log messages to retain"),
 
+    Option("mon_log_chunks", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .add_service("mon")
+    .set_description("keep a history of the cluster log in the local monitor store")
+    .set_long_description("Committed cluster log entries are also written, in "
+                          "compressed chunks, to a keyspace of the local "
+                          "monitor store that is not replicated by paxos, "
+                          "along with an index by channel and priority.  "
+                          "'ceph log last' can then go back further than "
+                          "mon_log_max_summary entries.")
+    .add_see_also("mon_log_max_chunks"),
+
+    Option("mon_log_chunk_entries", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1024)
+    .add_service("mon")
+    .set_description("number of cluster log entries per stored chunk")
+    .set_long_description("A partial chunk is also written once its first "
+                          "entry is mon_log_chunk_max_age old, and when the "
+                          "monitor shuts down.")
+    .add_see_also("mon_log_chunk_max_age"),
+
+    Option("mon_log_chunk_max_age", Option::TYPE_SECS, Option::LEVEL_ADVANCED)
+    .set_default(1_hr)
+    .add_service("mon")
+    .set_description("how long cluster log entries wait for their chunk to fill up before it is written anyway"),
+
+    Option("mon_log_chunk_compression", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("snappy")
+    .set_enum_allowed({"none", "snappy", "zlib", "zstd", "lz4"})
+    .add_service("mon")
+    .set_description("compression algorithm of the stored cluster log chunks"),
+
+    Option("mon_log_max_chunks", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000)
+    .add_service("mon")
+    .set_description("number of cluster log chunks kept in the monitor store"),
+
     Option("mon_max_log_entries_per_event", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(4096)
     .add_service("mon")
@@ -1926,6 +1985,25 @@ std::vector<Option> get_global_options() {
     .add_service("mon")
     .set_description("target max message payload for mon sync"),
 
+    Option("mon_sync_max_pending_chunks", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .add_service("mon")
+    .set_description("max sync chunks being written while the next is fetched")
+    .set_long_description("During a full sync the syncing mon asks for the "
+                          "next chunk as soon as it has queued the previous "
+                          "one for writing, until this many chunks are "
+                          "waiting to be committed.  0 writes each chunk "
+                          "before asking for the next."),
+
+    Option("mon_sync_resume", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .add_service("mon")
+    .set_description("resume an interrupted full sync where it left off")
+    .set_long_description("If a full sync is interrupted, e.g. by its "
+                          "provider going away, continue after the last key "
+                          "written instead of clearing the store and starting "
+                          "over."),
+
     Option("mon_sync_debug", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(false)
     .add_service("mon")
@@ -1936,6 +2014,19 @@ std::vector<Option> get_global_options() {
     .add_service("mon")
     .set_description("inject delay during sync (seconds)"),
 
+    Option("mon_osd_state_batch_window", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(1.0)
+    .set_min(0.0)
+    .add_service("mon")
+    .set_description("seconds to gather OSD boots and markdowns into one osdmap epoch")
+    .set_long_description("Once an OSD boot, failure or markdown is pending, the "
+                          "leader waits this long before proposing, so that "
+                          "the boots and failures of many OSDs (e.g., of a "
+                          "rack being power-cycled) go in a few osdmap epochs "
+                          "rather than one each.  0 proposes them as soon as "
+                          "other updates would be.")
+    .add_see_also("paxos_propose_interval"),
+
     Option("mon_osd_min_down_reporters", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(2)
     .add_service("mon")
@@ -2033,6 +2124,14 @@ std::vector<Option> get_global_options() {
     .set_flag(Option::FLAG_CLUSTER_CREATE)
     .set_description("do not set any monmap features for new mon clusters"),
 
+    Option("mon_store_group_commit_max_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(32_M)
+    .add_service("mon")
+    .set_description("max bytes of mon store transactions written together")
+    .set_long_description("Transactions queued while the monitor store is "
+                          "writing are written together, with a single sync, "
+                          "up to this many bytes at a time."),
+
     Option("mon_inject_transaction_delay_max", Option::TYPE_FLOAT, Option::LEVEL_DEV)
     .set_default(10.0)
     .add_service("mon")
@@ -2116,6 +2215,13 @@ std::vector<Option> get_global_options() {
     .add_service("mon")
     .set_description(""),
 
+    Option("paxos_batch_services", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .add_service("mon")
+    .set_description("Let pending changes of all services ride the next paxos round")
+    .set_long_description("When the leader starts a paxos round, services that have a change waiting for their proposal timer add it to the same round instead of starting another one once the timer fires.")
+    .add_see_also("paxos_propose_interval"),
+
     Option("paxos_min_wait", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(0.05)
     .add_service("mon")
@@ -2317,6 +2423,38 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("objecter_crush_cache", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Memoize raw CRUSH mappings across osdmap epochs")
+    .set_long_description("Keep the raw CRUSH result of each (pool, placement seed) with the client's osdmap and reuse it for later epochs as long as the crush map, osd weights and the pool's placement parameters are unchanged, so that retargeting ops after a map change does not run CRUSH.")
+    .add_see_also("osd_map_crush_cache"),
+
+    Option("objecter_range_incremental", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Ask the monitors for osdmap range incrementals")
+    .set_long_description("When behind by many epochs, take a single delta from the client's osdmap to the latest one instead of one incremental per epoch.  If a delta does not apply, the client goes back to plain incrementals for the rest of its life.")
+    .add_see_also("mon_osd_range_incremental_min_epochs"),
+
+    Option("objecter_read_coalesce_window_us", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("How long to hold small reads for merging with other reads of the same object (microseconds, 0 to disable)")
+    .set_long_description("Single-extent reads of the same object, snap and flags submitted within this window are sent as one multi-op request, and the reply is split back to the individual callers.  Such reads can no longer be cancelled by tid.")
+    .add_see_also({"objecter_read_coalesce_max_ops", "objecter_read_coalesce_max_bytes"}),
+
+    Option("objecter_read_coalesce_max_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Maximum number of reads merged into one request")
+    .add_see_also("objecter_read_coalesce_window_us"),
+
+    Option("objecter_read_coalesce_max_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(64_K)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Largest read considered for merging, and the most data a merged request reads")
+    .add_see_also("objecter_read_coalesce_window_us"),
+
     Option("filer_max_purge_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_description("Max in-flight operations for purging a striped range (e.g., MDS journal)"),
@@ -2363,6 +2501,18 @@ std::vector<Option> get_global_options() {
     .set_description("Maximum number of PGs we can attempt to unmap or upmap "
                      "for a specific overfull or underfull osd per iteration "),
 
+    Option("osd_calc_pg_upmaps_time_budget", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Stop calculating PG upmaps after this many seconds (0 for no limit)")
+    .set_long_description("The upmaps found until then are kept; the next round picks up from there."),
+
+    Option("osd_calc_pg_upmaps_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Number of threads used to map PGs while calculating PG upmaps")
+    .set_long_description("PG mappings and candidate moves are computed in parallel by this many threads; 1 computes them in the calling thread."),
+
     Option("osd_numa_prefer_iface", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_flag(Option::FLAG_STARTUP)
@@ -2725,6 +2875,19 @@ std::vector<Option> get_global_options() {
     .set_default(true)
     .set_description(""),
 
+    Option("osd_map_crush_cache", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Memoize raw CRUSH mappings of cached osdmaps")
+    .set_long_description("Keep the raw CRUSH result of each (pool, placement seed) with the osdmaps in the OSD's map cache.  Maps deduplicated against a neighbouring epoch share these results when their crush map, osd weights and the pool's placement parameters are the same, so advancing PGs through a series of maps runs CRUSH once per PG instead of once per epoch.")
+    .add_see_also("osd_map_dedup"),
+
+    Option("osd_map_snapshot", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Keep a snapshot of the current osdmap in the osd data directory")
+    .set_long_description("On a clean shutdown the OSD writes its current osdmap to osd_data/osdmap_snapshot, a flat file that is mapped read-only on the next start.  If it holds the epoch recorded in the superblock, the map is decoded in place from the mapped file instead of being read from the object store, and the file backs the cached map buffer of that epoch.  Any other snapshot is ignored."),
+
     Option("osd_map_cache_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(50)
     .set_description(""),
@@ -3087,6 +3250,19 @@ std::vector<Option> get_global_options() {
     .set_default(8_M)
     .set_description(""),
 
+    Option("osd_ec_read_cache_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Size of the cache of reconstructed erasure coded object data on the primary")
+    .set_long_description("Client reads of erasure coded objects normally fetch data from k shards and decode it on every read.  When this is non-zero the primary keeps recently read, reconstructed stripes in a cache of up to this many bytes shared by all of its PGs.  Writes to an object invalidate its cached data.  0 disables the cache.")
+    .add_see_also("osd_memory_target"),
+
+    Option("osd_ec_recovery_pipeline_depth", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_min(1)
+    .set_description("Number of recovery chunks per object an erasure coded primary keeps in flight")
+    .set_long_description("With a value greater than 1 the primary reads and decodes the next osd_recovery_max_chunk of an object while the pushes of the previous chunks are still being applied on the recovering shards.  Each additional chunk in flight costs up to osd_recovery_max_chunk of memory on the primary.")
+    .add_see_also("osd_recovery_max_chunk"),
+
     Option("osd_recovery_max_omap_entries_per_chunk", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(8096)
     .set_description(""),
@@ -3188,6 +3364,29 @@ std::vector<Option> get_global_options() {
     .add_see_also("osd_scrub_begin_week_day")
     .add_see_also("osd_scrub_end_week_day"),
 
+    Option("osd_scrub_throttle_client_p99_target", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Client op p99 latency (seconds) above which scrub backs off")
+    .set_long_description("When non-zero the OSD computes the 99th percentile latency of the client ops it completed every tick.  While it is above this target scrubs use smaller chunks and sleep longer between them; once it drops well below the target scrub speeds back up.  0 disables this signal.")
+    .add_see_also("osd_scrub_throttle_max_sleep")
+    .add_see_also("osd_scrub_throttle_store_latency_target"),
+
+    Option("osd_scrub_throttle_store_latency_target", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Object store commit latency (seconds) above which scrub backs off")
+    .set_long_description("Like osd_scrub_throttle_client_p99_target, but driven by the commit latency the object store reports for the device.  0 disables this signal.")
+    .add_see_also("osd_scrub_throttle_client_p99_target"),
+
+    Option("osd_scrub_throttle_max_sleep", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(1.0)
+    .set_description("Sleep between scrub chunks (seconds) at the highest scrub throttle level")
+    .add_see_also("osd_scrub_sleep")
+    .add_see_also("osd_scrub_throttle_client_p99_target"),
+
+    Option("osd_scrub_throttle_min_ops", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(100)
+    .set_description("Minimum number of client ops per tick needed to compute a client p99 latency for the scrub throttle"),
+
     Option("osd_scrub_auto_repair", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("Automatically repair damaged objects detected during scrub"),
@@ -3214,6 +3413,12 @@ std::vector<Option> get_global_options() {
     .set_default(512_K)
     .set_description("Number of bytes to read from an object at a time during deep scrub"),
 
+    Option("osd_deep_scrub_store_crc", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Let the object store compute the deep scrub data digest")
+    .set_long_description("When enabled, deep scrub asks the object store for the crc32c of the data it reads.  BlueStore verifies the data against its per-blob crc32c checksums and derives the digest from the stored values instead of hashing the data again.  The digest is identical either way.")
+    .add_see_also("bluestore_csum_type"),
+
     Option("osd_deep_scrub_keys", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(1024)
     .set_description("Number of keys to read from an object at a time during deep scrub"),
@@ -3468,6 +3673,18 @@ std::vector<Option> get_global_options() {
     .set_default(10.0)
     .set_description(""),
 
+    Option("osd_perf_metric_max_keys", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000)
+    .set_description("Maximum number of keys tracked per mgr perf metric query")
+    .set_long_description("Each placement group, and the OSD when it merges "
+                          "them into a report, keeps the counters of at most "
+                          "this many keys per query.  When a new key shows up "
+                          "and the limit is reached, it replaces the key with "
+                          "the fewest ops, so the heaviest keys (e.g. the "
+                          "hottest objects or clients) are reported with "
+                          "bounded memory.  0 tracks every key.")
+    .add_see_also("mgr_stats_period"),
+
     Option("osd_target_transaction_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(30)
     .set_description(""),
@@ -5025,6 +5242,25 @@ std::vector<Option> get_global_options() {
     .set_min_max((int64_t)PerfCountersBuilder::PRIO_DEBUGONLY,
 		 (int64_t)PerfCountersBuilder::PRIO_CRITICAL + 1),
 
+    Option("mgr_module_dump_cache", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .add_service("mgr")
+    .set_description("Keep the last dump of each cluster map a module asked for")
+    .set_long_description("A module asking again for an unchanged map (osd_map, "
+			  "pg_dump, df and the like) then gets a copy of the "
+			  "dump it was last given instead of a fresh one, at "
+			  "the price of every module keeping the last dump of "
+			  "each map it asked for, pg_dump included, in memory."),
+
+    Option("mgr_stats_delta", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Have daemons report only perf counters that changed")
+    .set_long_description("Daemons send the manager daemon the perf counters "
+			  "that changed since their previous report, encoded "
+			  "as varint differences, instead of every counter in "
+			  "each report.")
+    .add_see_also("mgr_stats_threshold"),
+
     Option("journal_zero_on_create", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(false)
     .set_description(""),
@@ -5088,6 +5324,12 @@ std::vector<Option> get_global_options() {
     .add_service("mgr")
     .set_description("Period in seconds of beacon messages to monitor"),
 
+    Option("mgr_pgmap_digest_verify", Option::TYPE_BOOL, Option::LEVEL_DEV)
+    .set_default(false)
+    .add_service("mgr")
+    .set_description("Check the incrementally maintained PGMap digest against a full recalculation")
+    .set_long_description("Before each report to the monitors, recalculate the osd sums by device class, rule availability and purged snaps from scratch and compare them with the incrementally maintained values.  A mismatch is logged and the digest is recalculated in full."),
+
     Option("mgr_stats_period", Option::TYPE_INT, Option::LEVEL_BASIC)
     .set_default(5)
     .add_service("mgr")
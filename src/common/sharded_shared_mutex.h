@@ -0,0 +1,85 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <shared_mutex>
+
+namespace ceph {
+
+/**
+ * sharded_shared_mutex
+ *
+ * A SharedMutex for read-mostly state.  A reader takes one of NumShards
+ * shared_mutexes, picked by its thread, in shared mode; a writer takes
+ * all of them in order.  Readers on different threads thus never write
+ * to the same cache line, where a plain std::shared_mutex makes every
+ * reader bump the same counter.  The price is paid by writers, which
+ * should be rare.
+ *
+ * The shard belongs to the thread, so a shared lock must be released
+ * by the thread that took it.
+ */
+template <unsigned NumShards = 32>
+class sharded_shared_mutex {
+  struct alignas(64) shard_t {
+    std::shared_mutex m;
+  };
+  std::array<shard_t, NumShards> shards;
+
+  static unsigned my_shard() {
+    static std::atomic<unsigned> next_shard = {0};
+    thread_local unsigned shard = next_shard++ % NumShards;
+    return shard;
+  }
+
+public:
+  sharded_shared_mutex() = default;
+  sharded_shared_mutex(const sharded_shared_mutex&) = delete;
+  sharded_shared_mutex& operator=(const sharded_shared_mutex&) = delete;
+
+  void lock() {
+    for (auto& s : shards) {
+      s.m.lock();
+    }
+  }
+  bool try_lock() {
+    for (unsigned i = 0; i < NumShards; ++i) {
+      if (!shards[i].m.try_lock()) {
+	while (i > 0) {
+	  shards[--i].m.unlock();
+	}
+	return false;
+      }
+    }
+    return true;
+  }
+  void unlock() {
+    for (unsigned i = NumShards; i > 0; --i) {
+      shards[i - 1].m.unlock();
+    }
+  }
+
+  void lock_shared() {
+    shards[my_shard()].m.lock_shared();
+  }
+  bool try_lock_shared() {
+    return shards[my_shard()].m.try_lock_shared();
+  }
+  void unlock_shared() {
+    shards[my_shard()].m.unlock_shared();
+  }
+};
+
+} // namespace ceph
@@ -120,6 +120,28 @@ __u32 crush_hash32_3(int type, __u32 a, __u32 b, __u32 c)
 	}
 }
 
+/*
+ * out[i] = crush_hash32_3(type, a, b[i], c) for i < n.  The mix is
+ * plain 32-bit integer arithmetic with no branches, so the compiler
+ * can evaluate several lanes per instruction.
+ */
+void crush_hash32_3_vec(int type, __u32 a, const __u32 *b, __u32 c,
+			__u32 *out, unsigned n)
+{
+	unsigned i;
+
+	switch (type) {
+	case CRUSH_HASH_RJENKINS1:
+		for (i = 0; i < n; i++)
+			out[i] = crush_hash32_rjenkins1_3(a, b[i], c);
+		break;
+	default:
+		for (i = 0; i < n; i++)
+			out[i] = 0;
+		break;
+	}
+}
+
 __u32 crush_hash32_4(int type, __u32 a, __u32 b, __u32 c, __u32 d)
 {
 	switch (type) {
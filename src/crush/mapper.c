@@ -331,10 +331,8 @@ static inline __s32 *get_choose_arg_ids(const struct crush_bucket_straw2 *bucket
  * for reference, see the exponential distribution example at:  
  * https://en.wikipedia.org/wiki/Inverse_transform_sampling#Examples
  */
-static inline __s64 generate_exponential_distribution(int type, int x, int y, int z, 
-                                                      int weight)
+static inline __s64 exponential_draw(unsigned int u, int weight)
 {
-	unsigned int u = crush_hash32_3(type, x, y, z);
 	u &= 0xffff;
 
 	/*
@@ -358,25 +356,41 @@ static inline __s64 generate_exponential_distribution(int type, int x, int y, in
 	return div64_s64(ln, weight);
 }
 
+/*
+ * hash the items of a straw2 bucket this many at a time; see
+ * crush_hash32_3_vec()
+ */
+#define CRUSH_STRAW2_HASH_BATCH 16
+
 static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 				int x, int r, const struct crush_choose_arg *arg,
                                 int position)
 {
-	unsigned int i, high = 0;
+	unsigned int i, j, n, high = 0;
 	__s64 draw, high_draw = 0;
         __u32 *weights = get_choose_arg_weights(bucket, arg, position);
         __s32 *ids = get_choose_arg_ids(bucket, arg);
-	for (i = 0; i < bucket->h.size; i++) {
-                dprintk("weight 0x%x item %d\n", weights[i], ids[i]);
-		if (weights[i]) {
-			draw = generate_exponential_distribution(bucket->h.hash, x, ids[i], r, weights[i]);
-		} else {
-			draw = S64_MIN;
-		}
+	__u32 u[CRUSH_STRAW2_HASH_BATCH];
+	for (i = 0; i < bucket->h.size; i += n) {
+		n = bucket->h.size - i;
+		if (n > CRUSH_STRAW2_HASH_BATCH)
+			n = CRUSH_STRAW2_HASH_BATCH;
+		crush_hash32_3_vec(bucket->h.hash, x, (const __u32 *)ids + i,
+				   r, u, n);
+		for (j = 0; j < n; j++) {
+			dprintk("weight 0x%x item %d\n", weights[i + j],
+				ids[i + j]);
+			if (weights[i + j]) {
+				draw = exponential_draw(u[j],
+							weights[i + j]);
+			} else {
+				draw = S64_MIN;
+			}
 
-		if (i == 0 || draw > high_draw) {
-			high = i;
-			high_draw = draw;
+			if (i + j == 0 || draw > high_draw) {
+				high = i + j;
+				high_draw = draw;
+			}
 		}
 	}
 
@@ -1103,3 +1117,34 @@ int crush_do_rule(const struct crush_map *map,
 
 	return result_len;
 }
+
+/**
+ * crush_do_rule_batch - calculate the mappings of several inputs
+ * @map: the crush_map
+ * @ruleno: the rule id
+ * @x: hash inputs
+ * @count: number of inputs
+ * @result: count rows of result_max items, one per input
+ * @result_max: maximum result size
+ * @result_len: the size of each result row
+ * @weight: weight vector (for map leaves)
+ * @weight_max: size of weight vector
+ * @cwin: workspace initialized by crush_init_workspace
+ *
+ * Equivalent to calling crush_do_rule for each input, but the
+ * workspace is set up once and reused for the whole batch.
+ */
+void crush_do_rule_batch(const struct crush_map *map,
+			 int ruleno, const int *x, int count,
+			 int *result, int result_max, int *result_len,
+			 const __u32 *weight, int weight_max,
+			 void *cwin, const struct crush_choose_arg *choose_args)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		result_len[i] = crush_do_rule(map, ruleno, x[i],
+					      result + i * result_max,
+					      result_max, weight, weight_max,
+					      cwin, choose_args);
+}
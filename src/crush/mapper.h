@@ -78,6 +78,20 @@ extern int crush_do_rule(const struct crush_map *map,
 			 const __u32 *weights, int weight_max,
 			 void *cwin, const struct crush_choose_arg *choose_args);
 
+/*
+ * Map count inputs x[] with the same rule.  The result for x[i] is
+ * result[i * result_max .. i * result_max + result_len[i]).  The
+ * workspace is set up as for crush_do_rule() and shared by the whole
+ * batch.
+ */
+extern void crush_do_rule_batch(const struct crush_map *map,
+				int ruleno,
+				const int *x, int count,
+				int *result, int result_max, int *result_len,
+				const __u32 *weights, int weight_max,
+				void *cwin,
+				const struct crush_choose_arg *choose_args);
+
 /* Returns the exact amount of workspace that will need to be used
    for a given combination of crush_map and result_max. The caller can
    then allocate this much on its own, either on the stack, in a
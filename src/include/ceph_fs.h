@@ -257,6 +257,7 @@ struct ceph_client_mount {
 } __attribute__ ((packed));
 
 #define CEPH_SUBSCRIBE_ONETIME    1  /* i want only 1 update after have */
+#define CEPH_SUBSCRIBE_RANGE_INC  2  /* i take osdmap range incrementals */
 
 struct ceph_mon_subscribe_item {
 	__le64 start;
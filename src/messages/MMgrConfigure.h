@@ -24,7 +24,7 @@
  */
 class MMgrConfigure : public Message {
 private:
-  static constexpr int HEAD_VERSION = 3;
+  static constexpr int HEAD_VERSION = 4;
   static constexpr int COMPAT_VERSION = 1;
 
 public:
@@ -35,6 +35,9 @@ public:
 
   std::map<OSDPerfMetricQuery, OSDPerfMetricLimits> osd_perf_metric_queries;
 
+  // The mgr accepts delta encoded perf counters in MMgrReport
+  bool stats_delta = false;
+
   void decode_payload() override
   {
     using ceph::decode;
@@ -46,6 +49,9 @@ public:
     if (header.version >= 3) {
       decode(osd_perf_metric_queries, p);
     }
+    if (header.version >= 4) {
+      decode(stats_delta, p);
+    }
   }
 
   void encode_payload(uint64_t features) override {
@@ -53,12 +59,14 @@ public:
     encode(stats_period, payload);
     encode(stats_threshold, payload);
     encode(osd_perf_metric_queries, payload);
+    encode(stats_delta, payload);
   }
 
   std::string_view get_type_name() const override { return "mgrconfigure"; }
   void print(std::ostream& out) const override {
     out << get_type_name() << "(period=" << stats_period
-			   << ", threshold=" << stats_threshold << ")";
+			   << ", threshold=" << stats_threshold
+			   << (stats_delta ? ", delta" : "") << ")";
   }
 
 private:
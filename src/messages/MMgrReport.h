@@ -71,6 +71,65 @@ public:
 };
 WRITE_CLASS_ENCODER(PerfCounterType)
 
+/**
+ * The last value reported for a counter.
+ *
+ * Both ends of a session remember it for every declared counter.  A
+ * delta encoded report (packed struct_v 2) only carries the counters
+ * that changed since the previous report on the session, each as the
+ * gap in declared order since the previous changed counter followed by
+ * the zigzag varint differences from the remembered value.
+ */
+struct PerfCounterValue
+{
+  uint64_t v = 0;
+  uint64_t avgcount = 0;
+  uint64_t avgcount2 = 0;
+
+  /// upper bound on the encoded size of one delta entry
+  static constexpr size_t max_delta_len = 4 * 10;
+
+  bool operator==(const PerfCounterValue& o) const {
+    return v == o.v && avgcount == o.avgcount && avgcount2 == o.avgcount2;
+  }
+  bool operator!=(const PerfCounterValue& o) const {
+    return !(*this == o);
+  }
+
+  static uint64_t zigzag(uint64_t from, uint64_t to) {
+    // the difference modulo 2^64, folded so that small negative steps
+    // of a gauge stay short too
+    int64_t d = static_cast<int64_t>(to - from);
+    return (static_cast<uint64_t>(d) << 1) ^ static_cast<uint64_t>(d >> 63);
+  }
+  static uint64_t unzigzag(uint64_t from, uint64_t z) {
+    return from + ((z >> 1) ^ (0 - (z & 1)));
+  }
+
+  void encode_delta(const PerfCounterValue& prev, uint64_t gap, bool avg,
+		    ceph::buffer::list& bl) const {
+    auto p = bl.get_contiguous_appender(max_delta_len);
+    denc_varint(gap, p);
+    denc_varint(zigzag(prev.v, v), p);
+    if (avg) {
+      denc_varint(zigzag(prev.avgcount, avgcount), p);
+      denc_varint(zigzag(prev.avgcount2, avgcount2), p);
+    }
+  }
+  /// apply the differences of an entry whose gap was already consumed
+  void decode_delta(bool avg, ceph::buffer::ptr::const_iterator& p) {
+    uint64_t z;
+    denc_varint(z, p);
+    v = unzigzag(v, z);
+    if (avg) {
+      denc_varint(z, p);
+      avgcount = unzigzag(avgcount, z);
+      denc_varint(z, p);
+      avgcount2 = unzigzag(avgcount2, z);
+    }
+  }
+};
+
 class MMgrReport : public Message {
 private:
   static constexpr int HEAD_VERSION = 8;
@@ -91,6 +150,10 @@ public:
   // Decode: iterate over the types we know about, sorted by idx,
   // and use the current type's type to decide how to decode
   // the next bytes from the ceph::buffer::list.
+  //
+  // If the mgr asked for deltas (MMgrConfigure::stats_delta), packed
+  // is struct_v 2 instead and holds the number of changed counters and
+  // a buffer of PerfCounterValue delta entries.
   ceph::buffer::list packed;
 
   std::string daemon_name;
@@ -22,7 +22,7 @@
 
 class MOSDMap : public Message {
 private:
-  static constexpr int HEAD_VERSION = 4;
+  static constexpr int HEAD_VERSION = 5;
   static constexpr int COMPAT_VERSION = 3;
 
 public:
@@ -30,6 +30,8 @@ public:
   uint64_t encode_features = 0;
   std::map<epoch_t, ceph::buffer::list> maps;
   std::map<epoch_t, ceph::buffer::list> incremental_maps;
+  /// epoch -> OSDMap::RangeIncremental from an earlier epoch to it
+  std::map<epoch_t, ceph::buffer::list> range_incremental_maps;
   epoch_t oldest_map =0, newest_map = 0;
 
   epoch_t get_first() const {
@@ -39,6 +41,9 @@ public:
     i = incremental_maps.begin();    
     if (i != incremental_maps.end() &&
         (e == 0 || i->first < e)) e = i->first;
+    i = range_incremental_maps.begin();
+    if (i != range_incremental_maps.end() &&
+        (e == 0 || i->first < e)) e = i->first;
     return e;
   }
   epoch_t get_last() const {
@@ -48,6 +53,9 @@ public:
     i = incremental_maps.rbegin();    
     if (i != incremental_maps.rend() &&
         (e == 0 || i->first > e)) e = i->first;
+    i = range_incremental_maps.rbegin();
+    if (i != range_incremental_maps.rend() &&
+        (e == 0 || i->first > e)) e = i->first;
     return e;
   }
   epoch_t get_oldest() {
@@ -85,6 +93,9 @@ public:
       mempool::osdmap::map<int64_t,snap_interval_set_t> gap_removed_snaps;
       decode(gap_removed_snaps, p);
     }
+    if (header.version >= 5) {
+      decode(range_incremental_maps, p);
+    }
   }
   void encode_payload(uint64_t features) override {
     using ceph::encode;
@@ -149,11 +160,18 @@ public:
     if (header.version >= 4) {
       encode((uint32_t)0, payload);
     }
+    if (header.version >= 5) {
+      // range incrementals carry the features of their base and are not
+      // reencoded
+      encode(range_incremental_maps, payload);
+    }
   }
 
   std::string_view get_type_name() const override { return "osdmap"; }
   void print(std::ostream& out) const override {
     out << "osd_map(" << get_first() << ".." << get_last();
+    if (!range_incremental_maps.empty())
+      out << " range";
     if (oldest_map || newest_map)
       out << " src has " << oldest_map << ".." << newest_map;
     out << ")";
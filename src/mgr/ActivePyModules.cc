@@ -161,9 +161,20 @@ PyObject *ActivePyModules::get_daemon_status_python(
   return f.get();
 }
 
-PyObject *ActivePyModules::get_python(const std::string &what)
+PyObject *ActivePyModules::get_python(const std::string &what,
+				      PyDumpCache *cache)
 {
   PyFormatter f;
+  // set if the dump of an unchanged map could be taken from cache
+  PyObject *cached = nullptr;
+  auto from_cache = [&what, cache, &cached](const PyDumpCache::version_t& v) {
+    return cache && (cached = cache->get(what, v));
+  };
+  auto to_cache = [&what, cache, &cached, &f](const PyDumpCache::version_t& v) {
+    if (cache) {
+      cached = cache->put(what, v, f.get());
+    }
+  };
 
   // Drop the GIL, as most of the following blocks will block on
   // a mutex -- they are all responsible for re-taking the GIL before
@@ -171,11 +182,15 @@ PyObject *ActivePyModules::get_python(const std::string &what)
   PyThreadState *tstate = PyEval_SaveThread();
 
   if (what == "fs_map") {
-    cluster_state.with_fsmap([&f, &tstate](const FSMap &fsmap) {
+    cluster_state.with_fsmap([&](const FSMap &fsmap) {
       PyEval_RestoreThread(tstate);
+      if (from_cache({fsmap.get_epoch(), 0})) {
+        return;
+      }
       fsmap.dump(&f);
+      to_cache({fsmap.get_epoch(), 0});
     });
-    return f.get();
+    return cached ? cached : f.get();
   } else if (what == "osdmap_crush_map_text") {
     bufferlist rdata;
     cluster_state.with_osdmap([&rdata, &tstate](const OSDMap &osd_map){
@@ -185,8 +200,11 @@ PyObject *ActivePyModules::get_python(const std::string &what)
     std::string crush_text = rdata.to_str();
     return PyString_FromString(crush_text.c_str());
   } else if (what.substr(0, 7) == "osd_map") {
-    cluster_state.with_osdmap([&f, &what, &tstate](const OSDMap &osd_map){
+    cluster_state.with_osdmap([&](const OSDMap &osd_map){
       PyEval_RestoreThread(tstate);
+      if (from_cache({osd_map.get_epoch(), 0})) {
+        return;
+      }
       if (what == "osd_map") {
         osd_map.dump(&f);
       } else if (what == "osd_map_tree") {
@@ -194,8 +212,9 @@ PyObject *ActivePyModules::get_python(const std::string &what)
       } else if (what == "osd_map_crush") {
         osd_map.crush->dump(&f);
       }
+      to_cache({osd_map.get_epoch(), 0});
     });
-    return f.get();
+    return cached ? cached : f.get();
   } else if (what == "modified_config_options") {
     PyEval_RestoreThread(tstate);
     auto all_daemons = daemon_state.get_all();
@@ -222,12 +241,16 @@ PyObject *ActivePyModules::get_python(const std::string &what)
     return f.get();
   } else if (what == "mon_map") {
     cluster_state.with_monmap(
-      [&f, &tstate](const MonMap &monmap) {
+      [&](const MonMap &monmap) {
         PyEval_RestoreThread(tstate);
+        if (from_cache({monmap.get_epoch(), 0})) {
+          return;
+        }
         monmap.dump(&f);
+        to_cache({monmap.get_epoch(), 0});
       }
     );
-    return f.get();
+    return cached ? cached : f.get();
   } else if (what == "service_map") {
     cluster_state.with_servicemap(
       [&f, &tstate](const ServiceMap &service_map) {
@@ -266,8 +289,11 @@ PyObject *ActivePyModules::get_python(const std::string &what)
     return f.get();
   } else if (what == "pg_summary") {
     cluster_state.with_pgmap(
-        [&f, &tstate](const PGMap &pg_map) {
+        [&](const PGMap &pg_map) {
           PyEval_RestoreThread(tstate);
+          if (from_cache({pg_map.version, 0})) {
+            return;
+          }
 
           std::map<std::string, std::map<std::string, uint32_t> > osds;
           std::map<std::string, std::map<std::string, uint32_t> > pools;
@@ -308,25 +334,34 @@ PyObject *ActivePyModules::get_python(const std::string &what)
           f.open_object_section("pg_stats_sum");
           pg_map.pg_sum.dump(&f);
           f.close_section();
+          to_cache({pg_map.version, 0});
         }
     );
-    return f.get();
+    return cached ? cached : f.get();
   } else if (what == "pg_status") {
     cluster_state.with_pgmap(
-        [&f, &tstate](const PGMap &pg_map) {
+        [&](const PGMap &pg_map) {
           PyEval_RestoreThread(tstate);
+          if (from_cache({pg_map.version, 0})) {
+            return;
+          }
 	  pg_map.print_summary(&f, nullptr);
+          to_cache({pg_map.version, 0});
         }
     );
-    return f.get();
+    return cached ? cached : f.get();
   } else if (what == "pg_dump") {
     cluster_state.with_pgmap(
-      [&f, &tstate](const PGMap &pg_map) {
+      [&](const PGMap &pg_map) {
         PyEval_RestoreThread(tstate);
+        if (from_cache({pg_map.version, 0})) {
+          return;
+        }
 	pg_map.dump(&f);
+        to_cache({pg_map.version, 0});
       }
     );
-    return f.get();
+    return cached ? cached : f.get();
   } else if (what == "devices") {
     daemon_state.with_devices2(
       [&tstate, &f]() {
@@ -361,34 +396,46 @@ PyObject *ActivePyModules::get_python(const std::string &what)
     return f.get();
   } else if (what == "df") {
     cluster_state.with_osdmap_and_pgmap(
-      [&f, &tstate](
+      [&](
 	const OSDMap& osd_map,
 	const PGMap &pg_map) {
 	PyEval_RestoreThread(tstate);
+        if (from_cache({osd_map.get_epoch(), pg_map.version})) {
+          return;
+        }
         pg_map.dump_cluster_stats(nullptr, &f, true);
         pg_map.dump_pool_stats_full(osd_map, nullptr, &f, true);
+        to_cache({osd_map.get_epoch(), pg_map.version});
       });
-    return f.get();
+    return cached ? cached : f.get();
   } else if (what == "osd_stats") {
     cluster_state.with_pgmap(
-        [&f, &tstate](const PGMap &pg_map) {
+        [&](const PGMap &pg_map) {
       PyEval_RestoreThread(tstate);
+      if (from_cache({pg_map.version, 0})) {
+        return;
+      }
       pg_map.dump_osd_stats(&f);
+      to_cache({pg_map.version, 0});
     });
-    return f.get();
+    return cached ? cached : f.get();
   } else if (what == "osd_pool_stats") {
     int64_t poolid = -ENOENT;
     cluster_state.with_osdmap_and_pgmap([&](const OSDMap& osdmap,
 					    const PGMap& pg_map) {
         PyEval_RestoreThread(tstate);
+        if (from_cache({osdmap.get_epoch(), pg_map.version})) {
+          return;
+        }
         f.open_array_section("pool_stats");
         for (auto &p : osdmap.get_pools()) {
           poolid = p.first;
           pg_map.dump_pool_stats_and_io_rate(poolid, osdmap, &f, nullptr);
         }
         f.close_section();
+        to_cache({osdmap.get_epoch(), pg_map.version});
     });
-    return f.get();
+    return cached ? cached : f.get();
   } else if (what == "health" || what == "mon_status") {
     bufferlist json;
     if (what == "health") {
@@ -403,11 +450,15 @@ PyObject *ActivePyModules::get_python(const std::string &what)
     f.dump_string("json", json.to_str());
     return f.get();
   } else if (what == "mgr_map") {
-    cluster_state.with_mgrmap([&f, &tstate](const MgrMap &mgr_map) {
+    cluster_state.with_mgrmap([&](const MgrMap &mgr_map) {
       PyEval_RestoreThread(tstate);
+      if (from_cache({mgr_map.get_epoch(), 0})) {
+        return;
+      }
       mgr_map.dump(&f);
+      to_cache({mgr_map.get_epoch(), 0});
     });
-    return f.get();
+    return cached ? cached : f.get();
   } else {
     derr << "Python module requested unknown data '" << what << "'" << dendl;
     PyEval_RestoreThread(tstate);
@@ -685,7 +736,7 @@ std::map<std::string, std::string> ActivePyModules::get_services() const
 }
 
 PyObject* ActivePyModules::with_perf_counters(
-    std::function<void(PerfCounterInstance& counter_instance, PerfCounterType& counter_type, PyFormatter& f)> fct,
+    std::function<void(PerfCounterInstance& counter_instance, PerfCounterType& counter_type, const PerfCounterStamps& stamps, PyFormatter& f)> fct,
     const std::string &svc_name,
     const std::string &svc_id,
     const std::string &path) const
@@ -701,9 +752,9 @@ PyObject* ActivePyModules::with_perf_counters(
   if (metadata) {
     std::lock_guard l2(metadata->lock);
     if (metadata->perf_counters.instances.count(path)) {
-      auto counter_instance = metadata->perf_counters.instances.at(path);
-      auto counter_type = metadata->perf_counters.types.at(path);
-      fct(counter_instance, counter_type, f);
+      auto& counter_instance = metadata->perf_counters.instances.at(path);
+      auto& counter_type = metadata->perf_counters.types.at(path);
+      fct(counter_instance, counter_type, metadata->perf_counters.stamps, f);
     } else {
       dout(4) << "Missing counter: '" << path << "' ("
         << svc_name << "." << svc_id << ")" << dendl;
@@ -728,10 +779,11 @@ PyObject* ActivePyModules::get_counter_python(
   auto extract_counters = [](
       PerfCounterInstance& counter_instance,
       PerfCounterType& counter_type,
+      const PerfCounterStamps& stamps,
       PyFormatter& f)
   {
     if (counter_type.type & PERFCOUNTER_LONGRUNAVG) {
-      const auto &avg_data = counter_instance.get_data_avg();
+      const auto &avg_data = counter_instance.get_data_avg(stamps);
       for (const auto &datapoint : avg_data) {
         f.open_array_section("datapoint");
         f.dump_float("t", datapoint.t);
@@ -740,7 +792,7 @@ PyObject* ActivePyModules::get_counter_python(
         f.close_section();
       }
     } else {
-      const auto &data = counter_instance.get_data();
+      const auto &data = counter_instance.get_data(stamps);
       for (const auto &datapoint : data) {
         f.open_array_section("datapoint");
         f.dump_float("t", datapoint.t);
@@ -760,17 +812,22 @@ PyObject* ActivePyModules::get_latest_counter_python(
   auto extract_latest_counters = [](
       PerfCounterInstance& counter_instance,
       PerfCounterType& counter_type,
+      const PerfCounterStamps& stamps,
       PyFormatter& f)
   {
     if (counter_type.type & PERFCOUNTER_LONGRUNAVG) {
-      const auto &datapoint = counter_instance.get_latest_data_avg();
-      f.dump_float("t", datapoint.t);
-      f.dump_unsigned("s", datapoint.s);
-      f.dump_unsigned("c", datapoint.c);
+      const auto datapoint = counter_instance.get_latest_data_avg(stamps);
+      if (datapoint) {
+        f.dump_float("t", datapoint->t);
+        f.dump_unsigned("s", datapoint->s);
+        f.dump_unsigned("c", datapoint->c);
+      }
     } else {
-      const auto &datapoint = counter_instance.get_latest_data();
-      f.dump_float("t", datapoint.t);
-      f.dump_unsigned("v", datapoint.v);
+      const auto datapoint = counter_instance.get_latest_data(stamps);
+      if (datapoint) {
+        f.dump_float("t", datapoint->t);
+        f.dump_unsigned("v", datapoint->v);
+      }
     }
   };
   return with_perf_counters(extract_latest_counters, svc_name, svc_id, path);
@@ -805,7 +862,7 @@ PyObject* ActivePyModules::get_perf_schema_python(
       f.open_object_section(ceph::to_string(key).c_str());
 
       std::lock_guard l(state->lock);
-      for (auto ctr_inst_iter : state->perf_counters.instances) {
+      for (const auto& ctr_inst_iter : state->perf_counters.instances) {
         const auto &counter_name = ctr_inst_iter.first;
 	f.open_object_section(counter_name.c_str());
 	auto type = state->perf_counters.types[counter_name];
@@ -827,6 +884,17 @@ PyObject* ActivePyModules::get_perf_schema_python(
   return f.get();
 }
 
+PyObject *ActivePyModules::get_perf_counters_prometheus_python(
+    int prio_limit,
+    const std::set<std::string> &services)
+{
+  PyThreadState *tstate = PyEval_SaveThread();
+  auto text = prometheus_perf_counters.render(daemon_state, prio_limit,
+					      services);
+  PyEval_RestoreThread(tstate);
+  return PyBytes_FromStringAndSize(text.data(), text.size());
+}
+
 PyObject *ActivePyModules::get_context()
 {
   PyThreadState *tstate = PyEval_SaveThread();
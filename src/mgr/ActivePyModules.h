@@ -30,6 +30,7 @@
 #include "DaemonState.h"
 #include "ClusterState.h"
 #include "OSDPerfMetricTypes.h"
+#include "PrometheusPerfCounters.h"
 
 class health_check_map_t;
 class DaemonServer;
@@ -57,6 +58,8 @@ private:
 
   map<std::string,ProgressEvent> progress_events;
 
+  PrometheusPerfCounters prometheus_perf_counters;
+
   mutable ceph::mutex lock = ceph::make_mutex("ActivePyModules::lock");
 
 public:
@@ -72,7 +75,8 @@ public:
   MonClient &get_monc() {return monc;}
   Objecter  &get_objecter() {return objecter;}
   Client    &get_client() {return client;}
-  PyObject *get_python(const std::string &what);
+  PyObject *get_python(const std::string &what,
+			PyDumpCache *cache = nullptr);
   PyObject *get_server_python(const std::string &hostname);
   PyObject *list_servers_python();
   PyObject *get_metadata_python(
@@ -90,12 +94,16 @@ public:
   PyObject *get_perf_schema_python(
      const std::string &svc_type,
      const std::string &svc_id);
+  PyObject *get_perf_counters_prometheus_python(
+    int prio_limit,
+    const std::set<std::string> &services);
   PyObject *get_context();
   PyObject *get_osdmap();
   PyObject *with_perf_counters(
       std::function<void(
         PerfCounterInstance& counter_instance,
         PerfCounterType& counter_type,
+        const PerfCounterStamps& stamps,
         PyFormatter& f)> fct,
       const std::string &svc_name,
       const std::string &svc_id,
@@ -42,6 +42,7 @@ typedef struct {
   PyObject_HEAD
   ActivePyModules *py_modules;
   ActivePyModule *this_module;
+  PyDumpCache *dump_cache;
 } BaseMgrModule;
 
 class MonCommandCompletion : public Context
@@ -360,7 +361,11 @@ ceph_state_get(BaseMgrModule *self, PyObject *args)
     return NULL;
   }
 
-  return self->py_modules->get_python(what);
+  PyDumpCache *cache = nullptr;
+  if (g_conf().get_val<bool>("mgr_module_dump_cache")) {
+    cache = self->dump_cache;
+  }
+  return self->py_modules->get_python(what, cache);
 }
 
 
@@ -626,6 +631,35 @@ get_perf_schema(BaseMgrModule *self, PyObject *args)
   return self->py_modules->get_perf_schema_python(type_str, svc_id);
 }
 
+static PyObject*
+get_perf_counters_prometheus(BaseMgrModule *self, PyObject *args)
+{
+  int prio_limit = 0;
+  PyObject *py_services = nullptr;
+  if (!PyArg_ParseTuple(args, "iO:get_perf_counters_prometheus",
+                        &prio_limit, &py_services)) {
+    return nullptr;
+  }
+  PyObject *seq = PySequence_Fast(py_services, "services must be a sequence");
+  if (!seq) {
+    return nullptr;
+  }
+  std::set<std::string> services;
+  for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i) {
+    auto [service, ok] = PyString_ToString(PySequence_Fast_GET_ITEM(seq, i));
+    if (!ok) {
+      Py_DECREF(seq);
+      PyErr_SetString(PyExc_TypeError, "services must be strings");
+      return nullptr;
+    }
+    services.insert(std::move(service));
+  }
+  Py_DECREF(seq);
+
+  return self->py_modules->get_perf_counters_prometheus_python(prio_limit,
+							       services);
+}
+
 static PyObject *
 ceph_get_osdmap(BaseMgrModule *self, PyObject *args)
 {
@@ -1100,6 +1134,10 @@ PyMethodDef BaseMgrModule_methods[] = {
   {"_ceph_get_perf_schema", (PyCFunction)get_perf_schema, METH_VARARGS,
     "Get the performance counter schema"},
 
+  {"_ceph_get_perf_counters_prometheus",
+    (PyCFunction)get_perf_counters_prometheus, METH_VARARGS,
+    "Get the latest performance counters in the prometheus text format"},
+
   {"_ceph_log", (PyCFunction)ceph_log, METH_VARARGS,
    "Emit a (local) log message"},
 
@@ -1182,15 +1220,26 @@ BaseMgrModule_init(BaseMgrModule *self, PyObject *args, PyObject *kwds)
         this_module_capsule, nullptr));
     ceph_assert(self->this_module);
 
+    delete self->dump_cache;
+    self->dump_cache = new PyDumpCache;
+
     return 0;
 }
 
+static void
+BaseMgrModule_dealloc(BaseMgrModule *self)
+{
+    delete self->dump_cache;
+    self->dump_cache = nullptr;
+    Py_TYPE(self)->tp_free(self);
+}
+
 PyTypeObject BaseMgrModuleType = {
   PyVarObject_HEAD_INIT(NULL, 0)
   "ceph_module.BaseMgrModule", /* tp_name */
   sizeof(BaseMgrModule),     /* tp_basicsize */
   0,                         /* tp_itemsize */
-  0,                         /* tp_dealloc */
+  (destructor)BaseMgrModule_dealloc, /* tp_dealloc */
   0,                         /* tp_print */
   0,                         /* tp_getattr */
   0,                         /* tp_setattr */
@@ -2380,6 +2380,15 @@ void DaemonServer::send_report()
       }
 
       cluster_state.with_osdmap([&](const OSDMap& osdmap) {
+	  if (g_conf().get_val<bool>("mgr_pgmap_digest_verify")) {
+	    pg_map.update_digest(osdmap);
+	    std::stringstream ss;
+	    if (!pg_map.check_digest(osdmap, &ss)) {
+	      derr << "pgmap digest differs from full recalculation: "
+		   << ss.str() << dendl;
+	      pg_map.invalidate_digest();
+	    }
+	  }
 	  // FIXME: no easy way to get mon features here.  this will do for
 	  // now, though, as long as we don't make a backward-incompat change.
 	  pg_map.encode_digest(osdmap, m->get_data(), CEPH_FEATURES_ALL);
@@ -2796,6 +2805,7 @@ const char** DaemonServer::get_tracked_conf_keys() const
 {
   static const char *KEYS[] = {
     "mgr_stats_threshold",
+    "mgr_stats_delta",
     "mgr_stats_period",
     nullptr
   };
@@ -2807,7 +2817,8 @@ void DaemonServer::handle_conf_change(const ConfigProxy& conf,
 				      const std::set <std::string> &changed)
 {
 
-  if (changed.count("mgr_stats_threshold") || changed.count("mgr_stats_period")) {
+  if (changed.count("mgr_stats_threshold") || changed.count("mgr_stats_period") ||
+      changed.count("mgr_stats_delta")) {
     dout(4) << "Updating stats threshold/period on "
             << daemon_connections.size() << " clients" << dendl;
     // Send a fresh MMgrConfigure to all clients, so that they can follow
@@ -2828,6 +2839,7 @@ void DaemonServer::_send_configure(ConnectionRef c)
   auto configure = make_message<MMgrConfigure>();
   configure->stats_period = g_conf().get_val<int64_t>("mgr_stats_period");
   configure->stats_threshold = g_conf().get_val<int64_t>("mgr_stats_threshold");
+  configure->stats_delta = g_conf().get_val<bool>("mgr_stats_delta");
 
   if (c->peer_is_osd()) {
     configure->osd_perf_metric_queries =
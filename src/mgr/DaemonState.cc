@@ -14,6 +14,7 @@
 #include "DaemonState.h"
 
 #include <experimental/iterator>
+#include <optional>
 
 #include "MgrSession.h"
 #include "include/stringify.h"
@@ -278,19 +279,37 @@ void DaemonPerfCounters::update(const MMgrReport& report)
   // Load any newly declared types
   for (const auto &t : report.declare_types) {
     types.insert(std::make_pair(t.path, t));
-    session->declared_types.insert(t.path);
+    session->declared_types.emplace(t.path, PerfCounterValue());
   }
   // Remove any old types
   for (const auto &t : report.undeclare_types) {
     session->declared_types.erase(t);
   }
 
-  const auto now = ceph_clock_now();
+  const auto seq = stamps.push(ceph_clock_now());
+  ++version;
 
   // Parse packed data according to declared set of types
   auto p = report.packed.cbegin();
-  DECODE_START(1, p);
-  for (const auto &t_path : session->declared_types) {
+  DECODE_START(2, p);
+  // with deltas, only the changed counters are in the report; the
+  // others keep the value the session last saw
+  uint32_t num_changed = 0;
+  ceph::buffer::list deltas;
+  if (struct_v >= 2) {
+    decode(num_changed, p);
+    decode(deltas, p);
+  }
+  ceph::buffer::ptr bp;
+  std::optional<ceph::buffer::ptr::const_iterator> q;
+  uint64_t idx = 0, next_idx = 0;
+  if (num_changed) {
+    deltas.c_str();  // the varint decoder wants one contiguous buffer
+    bp = deltas.front();
+    q.emplace(bp.cbegin());
+    denc_varint(next_idx, *q);
+  }
+  for (auto &[t_path, value] : session->declared_types) {
     const auto &t = types.at(t_path);
     auto instances_it = instances.find(t_path);
     // Always check the instance exists, as we don't prevent yet
@@ -299,29 +318,101 @@ void DaemonPerfCounters::update(const MMgrReport& report)
     if (instances_it == instances.end()) {
       instances_it = instances.insert({t_path, t.type}).first;
     }
-    uint64_t val = 0;
-    uint64_t avgcount = 0;
-    uint64_t avgcount2 = 0;
-
-    decode(val, p);
-    if (t.type & PERFCOUNTER_LONGRUNAVG) {
-      decode(avgcount, p);
-      decode(avgcount2, p);
-      instances_it->second.push_avg(now, val, avgcount);
+    const bool avg = t.type & PERFCOUNTER_LONGRUNAVG;
+    if (struct_v < 2) {
+      decode(value.v, p);
+      if (avg) {
+	decode(value.avgcount, p);
+	decode(value.avgcount2, p);
+      }
+    } else if (num_changed && idx == next_idx) {
+      value.decode_delta(avg, *q);
+      if (--num_changed) {
+	uint64_t gap;
+	denc_varint(gap, *q);
+	next_idx = idx + 1 + gap;
+      }
+    }
+    if (avg) {
+      instances_it->second.push_avg(seq, value.v, value.avgcount);
     } else {
-      instances_it->second.push(now, val);
+      instances_it->second.push(seq, value.v);
     }
+    ++idx;
+  }
+  if (num_changed) {
+    throw ceph::buffer::malformed_input("perf counter delta past declared types");
   }
   DECODE_FINISH(p);
 }
 
-void PerfCounterInstance::push(utime_t t, uint64_t const &v)
+void PerfCounterInstance::advance(uint64_t seq)
+{
+  // a missed report breaks the series, start over
+  if (num && seq != last + 1) {
+    num = 0;
+  }
+  last = seq;
+  if (num < capacity) {
+    ++num;
+  }
+}
+
+uint64_t PerfCounterInstance::get_first(const PerfCounterStamps& stamps) const
 {
-  buffer.push_back({t, v});
+  return std::max(last + 1 - num, stamps.get_first());
 }
 
-void PerfCounterInstance::push_avg(utime_t t, uint64_t const &s,
+void PerfCounterInstance::push(uint64_t seq, uint64_t const &v)
+{
+  advance(seq);
+  columns[seq % capacity] = v;
+}
+
+void PerfCounterInstance::push_avg(uint64_t seq, uint64_t const &s,
                                    uint64_t const &c)
 {
-  avg_buffer.push_back({t, s, c});
+  advance(seq);
+  columns[seq % capacity] = s;
+  columns[capacity + seq % capacity] = c;
+}
+
+std::vector<PerfCounterInstance::DataPoint>
+PerfCounterInstance::get_data(const PerfCounterStamps& stamps) const
+{
+  std::vector<DataPoint> r;
+  for (uint64_t i = get_first(stamps); num && i <= last; ++i) {
+    r.emplace_back(stamps.get(i), columns[i % capacity]);
+  }
+  return r;
+}
+
+boost::optional<PerfCounterInstance::DataPoint>
+PerfCounterInstance::get_latest_data(const PerfCounterStamps& stamps) const
+{
+  if (!num || get_first(stamps) > last) {
+    return boost::none;
+  }
+  return DataPoint(stamps.get(last), columns[last % capacity]);
+}
+
+std::vector<PerfCounterInstance::AvgDataPoint>
+PerfCounterInstance::get_data_avg(const PerfCounterStamps& stamps) const
+{
+  std::vector<AvgDataPoint> r;
+  for (uint64_t i = get_first(stamps); num && i <= last; ++i) {
+    r.emplace_back(stamps.get(i), columns[i % capacity],
+		   columns[capacity + i % capacity]);
+  }
+  return r;
+}
+
+boost::optional<PerfCounterInstance::AvgDataPoint>
+PerfCounterInstance::get_latest_data_avg(const PerfCounterStamps& stamps) const
+{
+  if (!num || get_first(stamps) > last) {
+    return boost::none;
+  }
+  return AvgDataPoint(stamps.get(last), columns[last % capacity],
+		      columns[capacity + last % capacity]);
 }
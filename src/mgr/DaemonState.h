@@ -14,11 +14,13 @@
 #ifndef DAEMON_STATE_H_
 #define DAEMON_STATE_H_
 
+#include <array>
 #include <map>
 #include <string>
 #include <memory>
 #include <set>
-#include <boost/circular_buffer.hpp>
+#include <vector>
+#include <boost/optional.hpp>
 
 #include "common/RWLock.h"
 #include "include/str_map.h"
@@ -33,6 +35,35 @@ namespace ceph {
   class Formatter;
 }
 
+// The times of the last reports from one daemon.  The history of each
+// of its counters is a column of values kept in the same slots, so a
+// report's timestamp is stored once rather than once per counter.
+class PerfCounterStamps
+{
+  public:
+  static constexpr unsigned capacity = 20;
+
+  /// record the time of a new report, return its sequence number
+  uint64_t push(utime_t t)
+  {
+    stamps[seq % capacity] = t;
+    return seq++;
+  }
+  /// sequence number of the oldest report still held
+  uint64_t get_first() const
+  {
+    return seq > capacity ? seq - capacity : 0;
+  }
+  utime_t get(uint64_t s) const
+  {
+    return stamps[s % capacity];
+  }
+
+  private:
+  std::array<utime_t, capacity> stamps;
+  uint64_t seq = 0;
+};
+
 // An instance of a performance counter type, within
 // a particular daemon.
 class PerfCounterInstance
@@ -58,38 +89,31 @@ class PerfCounterInstance
     {}
   };
 
-  boost::circular_buffer<DataPoint> buffer;
-  boost::circular_buffer<AvgDataPoint> avg_buffer;
+  static constexpr unsigned capacity = PerfCounterStamps::capacity;
+
+  // ring of the last values, followed by a ring of the counts for a
+  // long running average; report seq lands in slot seq % capacity
+  std::vector<uint64_t> columns;
+  uint64_t last = 0;   ///< sequence number of the newest value
+  unsigned num = 0;    ///< number of values held
 
-  uint64_t get_current() const;
+  void advance(uint64_t seq);
+  /// sequence number of the oldest value whose timestamp is still held
+  uint64_t get_first(const PerfCounterStamps& stamps) const;
 
   public:
-  const boost::circular_buffer<DataPoint> & get_data() const
-  {
-    return buffer;
-  }
-  const DataPoint& get_latest_data() const
-  {
-    return buffer.back();
-  }
-  const boost::circular_buffer<AvgDataPoint> & get_data_avg() const
-  {
-    return avg_buffer;
-  }
-  const AvgDataPoint& get_latest_data_avg() const
-  {
-    return avg_buffer.back();
-  }
-  void push(utime_t t, uint64_t const &v);
-  void push_avg(utime_t t, uint64_t const &s, uint64_t const &c);
+  std::vector<DataPoint> get_data(const PerfCounterStamps& stamps) const;
+  boost::optional<DataPoint> get_latest_data(
+    const PerfCounterStamps& stamps) const;
+  std::vector<AvgDataPoint> get_data_avg(const PerfCounterStamps& stamps) const;
+  boost::optional<AvgDataPoint> get_latest_data_avg(
+    const PerfCounterStamps& stamps) const;
+  void push(uint64_t seq, uint64_t const &v);
+  void push_avg(uint64_t seq, uint64_t const &s, uint64_t const &c);
 
   PerfCounterInstance(enum perfcounter_type_d type)
-  {
-    if (type & PERFCOUNTER_LONGRUNAVG)
-      avg_buffer = boost::circular_buffer<AvgDataPoint>(20);
-    else
-      buffer = boost::circular_buffer<DataPoint>(20);
-  };
+    : columns((type & PERFCOUNTER_LONGRUNAVG ? 2 : 1) * capacity)
+  {}
 };
 
 
@@ -107,12 +131,17 @@ class DaemonPerfCounters
   {}
 
   std::map<std::string, PerfCounterInstance> instances;
+  PerfCounterStamps stamps;
+
+  // bumped on every change, for whoever caches a rendering of them
+  uint64_t version = 0;
 
   void update(const MMgrReport& report);
 
   void clear()
   {
     instances.clear();
+    ++version;
   }
 };
 
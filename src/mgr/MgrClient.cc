@@ -135,6 +135,7 @@ void MgrClient::reconnect()
     session->con->mark_down();
     session.reset();
     stats_period = 0;
+    stats_delta = false;
     if (report_callback != nullptr) {
       timer.cancel_event(report_callback);
       report_callback = nullptr;
@@ -318,16 +319,21 @@ void MgrClient::_send_report()
       session->declared.erase(path);
     };
 
-    ENCODE_START(1, 1, report->packed);
+    // struct_v 2 carries only the counters that changed since the last
+    // report, see PerfCounterValue
+    uint32_t num_changed = 0;
+    ENCODE_START(stats_delta ? 2 : 1, stats_delta ? 2 : 1, report->packed);
 
     // Find counters that no longer exist, and undeclare them
     for (auto p = session->declared.begin(); p != session->declared.end(); ) {
-      const auto &path = *(p++);
+      const auto &path = (p++)->first;
       if (by_path.count(path) == 0) {
         undeclare(path);
       }
     }
 
+    uint64_t idx = 0, next_idx = 0;
+    ceph::buffer::list deltas;
     for (const auto &i : by_path) {
       auto& path = i.first;
       auto& data = *(i.second.data);
@@ -342,7 +348,8 @@ void MgrClient::_send_report()
         continue;
       }
 
-      if (session->declared.count(path) == 0) {
+      auto d = session->declared.find(path);
+      if (d == session->declared.end()) {
 	ldout(cct,20) << " declare " << path << dendl;
 	PerfCounterType type;
 	type.path = path;
@@ -356,21 +363,41 @@ void MgrClient::_send_report()
        type.priority = perf_counters.get_adjusted_priority(data.prio);
 	type.unit = data.unit;
 	report->declare_types.push_back(std::move(type));
-	session->declared.insert(path);
+	d = session->declared.emplace(path, PerfCounterValue()).first;
       }
 
-      encode(static_cast<uint64_t>(data.u64), report->packed);
-      if (data.type & PERFCOUNTER_LONGRUNAVG) {
-        encode(static_cast<uint64_t>(data.avgcount), report->packed);
-        encode(static_cast<uint64_t>(data.avgcount2), report->packed);
+      const bool avg = data.type & PERFCOUNTER_LONGRUNAVG;
+      PerfCounterValue value;
+      value.v = data.u64;
+      if (avg) {
+        value.avgcount = data.avgcount;
+        value.avgcount2 = data.avgcount2;
       }
+      if (!stats_delta) {
+        encode(value.v, report->packed);
+        if (avg) {
+          encode(value.avgcount, report->packed);
+          encode(value.avgcount2, report->packed);
+        }
+      } else if (value != d->second) {
+        value.encode_delta(d->second, idx - next_idx, avg, deltas);
+        next_idx = idx + 1;
+        ++num_changed;
+      }
+      d->second = value;
+      ++idx;
+    }
+    if (stats_delta) {
+      encode(num_changed, report->packed);
+      encode(deltas, report->packed);
     }
     ENCODE_FINISH(report->packed);
 
     ldout(cct, 20) << "sending " << session->declared.size() << " counters ("
                       "of possible " << by_path.size() << "), "
 		   << report->declare_types.size() << " new, "
-                   << report->undeclare_types.size() << " removed"
+                   << report->undeclare_types.size() << " removed, "
+                   << num_changed << " changed"
                    << dendl;
   });
 
@@ -436,6 +463,11 @@ bool MgrClient::handle_mgr_configure(ref_t<MMgrConfigure> m)
     stats_threshold = m->stats_threshold;
   }
 
+  if (stats_delta != m->stats_delta) {
+    ldout(cct, 4) << "stats_delta=" << m->stats_delta << dendl;
+    stats_delta = m->stats_delta;
+  }
+
   if (set_perf_queries_cb) {
     set_perf_queries_cb(m->osd_perf_metric_queries);
   }
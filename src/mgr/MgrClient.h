@@ -37,8 +37,9 @@ class MonMap;
 class MgrSessionState
 {
   public:
-  // Which performance counters have we already transmitted schema for?
-  std::set<std::string> declared;
+  // Which performance counters have we already transmitted schema for,
+  // and what did we last send for them?
+  std::map<std::string, PerfCounterValue> declared;
 
   // Our connection to the mgr
   ConnectionRef con;
@@ -69,6 +70,7 @@ protected:
 
   uint32_t stats_period = 0;
   uint32_t stats_threshold = 0;
+  bool stats_delta = false;
   SafeTimer timer;
 
   CommandTable<MgrCommand> command_table;
@@ -7,6 +7,7 @@
 #include "common/RefCountedObj.h"
 #include "common/entity_name.h"
 #include "msg/msg_types.h"
+#include "messages/MMgrReport.h"
 #include "MgrCap.h"
 
 
@@ -22,7 +23,8 @@ struct MgrSession : public RefCountedObject {
 
   MgrCap caps;
 
-  std::set<std::string> declared_types;
+  // declared perf counters and their last reported values
+  std::map<std::string, PerfCounterValue> declared_types;
 
   const entity_addr_t& get_peer_addr() const {
     return inst.addr;
@@ -0,0 +1,244 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#include "PrometheusPerfCounters.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <regex>
+#include <string_view>
+
+namespace {
+
+// the metric name of a counter path, as the prometheus module makes it
+std::string promethize(const std::string &path)
+{
+  // the same as promethize() in the prometheus module
+  std::string r;
+  r.reserve(path.size() + 8);
+  for (size_t i = 0; i < path.size(); ++i) {
+    const char c = path[i];
+    if (c == '.' || c == '/' || isspace(c)) {
+      r += '_';
+    } else if (c == ':' && i + 1 < path.size() && path[i + 1] == ':') {
+      r += '_';
+      ++i;
+    } else if (c == '+') {
+      r += "_plus";
+    } else {
+      r += c;
+    }
+  }
+  // hyphens usually turn into underscores, unless they are trailing
+  if (!r.empty() && r.back() == '-') {
+    r.pop_back();
+    r += "_minus";
+  } else {
+    std::replace(r.begin(), r.end(), '-', '_');
+  }
+  return "ceph_" + r;
+}
+
+std::string escape(std::string_view s, bool quote)
+{
+  std::string r;
+  r.reserve(s.size());
+  for (const char c : s) {
+    if (c == '\\') {
+      r += "\\\\";
+    } else if (c == '\n') {
+      r += "\\n";
+    } else if (c == '"' && quote) {
+      r += "\\\"";
+    } else {
+      r += c;
+    }
+  }
+  return r;
+}
+
+std::string label(const char *name, std::string_view value)
+{
+  return std::string(name) + "=\"" + escape(value, true) + "\"";
+}
+
+std::string format_value(enum perfcounter_type_d type, uint64_t v)
+{
+  if (type & PERFCOUNTER_TIME) {
+    // nanoseconds, shown as seconds
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%" PRIu64 ".%09" PRIu64,
+	     v / 1000000000ull, v % 1000000000ull);
+    return buf;
+  }
+  return std::to_string(v);
+}
+
+} // anonymous namespace
+
+unsigned PrometheusPerfCounters::get_metric(const std::string &name,
+					    const char *type,
+					    const std::string &desc)
+{
+  auto p = metrics.find(name);
+  if (p == metrics.end()) {
+    metric_t m;
+    m.id = metrics.size();
+    m.header = "\n# HELP " + name + " " + escape(desc, false) +
+      "\n# TYPE " + name + " " + type;
+    p = metrics.emplace(name, std::move(m)).first;
+  }
+  return p->second.id;
+}
+
+void PrometheusPerfCounters::add_sample(fragment_t *frag,
+					const std::string &name,
+					const char *type,
+					const std::string &desc,
+					const std::string &labels,
+					const std::string &value)
+{
+  sample_t s;
+  s.metric = get_metric(name, type, desc);
+  s.off = frag->text.size();
+  frag->text += '\n';
+  frag->text += name;
+  frag->text += '{';
+  frag->text += labels;
+  frag->text += "} ";
+  frag->text += value;
+  s.len = frag->text.size() - s.off;
+  frag->samples.push_back(s);
+}
+
+void PrometheusPerfCounters::render_daemon(const DaemonKey &key,
+					   const DaemonPerfCounters &counters,
+					   fragment_t *frag)
+{
+  static const std::regex rbd_mirror_path(
+    "^rbd_mirror_([^/]+)/(?:(?:([^/]+)/)?)(.*)\\.(replay(?:_bytes|_latency)?)$");
+
+  frag->version = counters.version;
+  frag->text.clear();
+  frag->samples.clear();
+  const std::string daemon_label = label("ceph_daemon", ceph::to_string(key));
+
+  for (const auto &[path, instance] : counters.instances) {
+    auto t = counters.types.find(path);
+    if (t == counters.types.end() || t->second.priority < frag->prio_limit) {
+      continue;
+    }
+    const auto &type = t->second;
+    const char *stattype;
+    switch (type.type & ~(PERFCOUNTER_TIME | PERFCOUNTER_U64)) {
+    case PERFCOUNTER_NONE:
+      stattype = "gauge";
+      break;
+    case PERFCOUNTER_LONGRUNAVG:
+    case PERFCOUNTER_COUNTER:
+      stattype = "counter";
+      break;
+    default:
+      // histograms are represented by the long running averages
+      continue;
+    }
+
+    std::string name = path;
+    std::string labels = daemon_label;
+    std::smatch m;
+    if (key.type == "rbd-mirror" &&
+	std::regex_match(path, m, rbd_mirror_path)) {
+      name = "rbd_mirror_" + m[4].str();
+      labels += "," + label("pool", m[1].str()) +
+	"," + label("namespace", m[2].str()) +
+	"," + label("image", m[3].str());
+    }
+
+    if (type.type & PERFCOUNTER_LONGRUNAVG) {
+      // a sum/count pair
+      auto d = instance.get_latest_data_avg(counters.stamps);
+      add_sample(frag, promethize(name + "_sum"), stattype,
+		 type.description + " Total", labels,
+		 format_value(type.type, d ? d->s : 0));
+      add_sample(frag, promethize(name + "_count"), "counter",
+		 type.description + " Count", labels,
+		 std::to_string(d ? d->c : 0));
+    } else {
+      auto d = instance.get_latest_data(counters.stamps);
+      add_sample(frag, promethize(name), stattype, type.description, labels,
+		 format_value(type.type, d ? d->v : 0));
+    }
+  }
+}
+
+std::string PrometheusPerfCounters::render(
+  DaemonStateIndex &daemon_state,
+  int prio_limit,
+  const std::set<std::string> &services)
+{
+  std::lock_guard l(lock);
+
+  auto daemons = daemon_state.get_all();
+  for (auto p = fragments.begin(); p != fragments.end(); ) {
+    if (daemons.count(p->first)) {
+      ++p;
+    } else {
+      p = fragments.erase(p);
+    }
+  }
+
+  // bring the fragments of the daemons that reported up to date
+  for (const auto &[key, state] : daemons) {
+    if (!services.count(key.type)) {
+      continue;
+    }
+    auto &frag = fragments[key];
+    std::lock_guard dl(state->lock);
+    if (frag.version != state->perf_counters.version ||
+	frag.prio_limit != prio_limit) {
+      frag.prio_limit = prio_limit;
+      render_daemon(key, state->perf_counters, &frag);
+    }
+  }
+
+  // group the samples by metric
+  std::vector<std::vector<std::string_view>> by_metric(metrics.size());
+  size_t len = 0;
+  for (const auto &[key, frag] : fragments) {
+    if (!services.count(key.type)) {
+      continue;
+    }
+    for (const auto &s : frag.samples) {
+      by_metric[s.metric].emplace_back(frag.text.data() + s.off, s.len);
+      len += s.len;
+    }
+  }
+  for (const auto &[name, m] : metrics) {
+    if (!by_metric[m.id].empty()) {
+      len += m.header.size();
+    }
+  }
+
+  std::string out;
+  out.reserve(len);
+  for (const auto &[name, m] : metrics) {
+    const auto &samples = by_metric[m.id];
+    if (samples.empty()) {
+      continue;
+    }
+    out += m.header;
+    for (const auto &s : samples) {
+      out += s;
+    }
+  }
+  return out;
+}
@@ -0,0 +1,79 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "DaemonState.h"
+
+/**
+ * Renders the perf counters of all daemons in the Prometheus text
+ * exposition format, with the metric names, labels and help texts the
+ * prometheus module uses.
+ *
+ * The samples of a daemon are rendered when its counters change and
+ * kept; a scrape only renders the daemons that reported since the
+ * previous one and then stitches the kept samples together, grouped by
+ * metric as the format requires.
+ */
+class PrometheusPerfCounters
+{
+public:
+  /**
+   * render the counters of priority prio_limit or higher of the
+   * daemons of the given service types
+   */
+  std::string render(DaemonStateIndex &daemon_state,
+		     int prio_limit,
+		     const std::set<std::string> &services);
+
+private:
+  struct metric_t {
+    unsigned id;
+    std::string header;   ///< HELP and TYPE lines
+  };
+
+  struct sample_t {
+    unsigned metric;
+    uint32_t off;
+    uint32_t len;
+  };
+
+  // the samples of one daemon, one line each, in one string
+  struct fragment_t {
+    uint64_t version = 0;
+    int prio_limit = 0;
+    std::string text;
+    std::vector<sample_t> samples;
+  };
+
+  ceph::mutex lock = ceph::make_mutex("PrometheusPerfCounters::lock");
+  std::map<std::string, metric_t> metrics;   ///< by exported name
+  std::map<DaemonKey, fragment_t> fragments;
+
+  unsigned get_metric(const std::string &name,
+		      const char *type,
+		      const std::string &desc);
+  void add_sample(fragment_t *frag,
+		  const std::string &name,
+		  const char *type,
+		  const std::string &desc,
+		  const std::string &labels,
+		  const std::string &value);
+  void render_daemon(const DaemonKey &key,
+		     const DaemonPerfCounters &counters,
+		     fragment_t *frag);
+};
@@ -125,3 +125,60 @@ void PyFormatter::finish_pending_streams()
   pending_streams.clear();
 }
 
+
+namespace {
+
+// copy the dicts and lists of a dump, sharing everything else
+PyObject *copy_containers(PyObject *o)
+{
+  if (PyDict_CheckExact(o)) {
+    PyObject *r = PyDict_New();
+    PyObject *k, *v;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(o, &pos, &k, &v)) {
+      PyObject *c = copy_containers(v);
+      PyDict_SetItem(r, k, c);
+      Py_DECREF(c);
+    }
+    return r;
+  } else if (PyList_CheckExact(o)) {
+    const Py_ssize_t n = PyList_GET_SIZE(o);
+    PyObject *r = PyList_New(n);
+    for (Py_ssize_t i = 0; i < n; ++i) {
+      PyList_SET_ITEM(r, i, copy_containers(PyList_GET_ITEM(o, i)));
+    }
+    return r;
+  } else {
+    Py_INCREF(o);
+    return o;
+  }
+}
+
+} // anonymous namespace
+
+PyDumpCache::~PyDumpCache()
+{
+  for (auto& [what, dump] : dumps) {
+    Py_DECREF(dump.second);
+  }
+}
+
+PyObject *PyDumpCache::get(const std::string& what, const version_t& v) const
+{
+  auto p = dumps.find(what);
+  if (p == dumps.end() || p->second.first != v) {
+    return nullptr;
+  }
+  return copy_containers(p->second.second);
+}
+
+PyObject *PyDumpCache::put(const std::string& what, const version_t& v,
+			   PyObject *dump)
+{
+  auto [p, inserted] = dumps.try_emplace(what, v, dump);
+  if (!inserted) {
+    Py_DECREF(p->second.second);
+    p->second = {v, dump};
+  }
+  return copy_containers(dump);
+}
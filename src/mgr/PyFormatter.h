@@ -26,6 +26,7 @@
 #include <sstream>
 #include <memory>
 #include <list>
+#include <map>
 
 #include "common/Formatter.h"
 #include "include/ceph_assert.h"
@@ -141,5 +142,34 @@ private:
 
 };
 
+/**
+ * The last Python dumps of versioned cluster state (maps and the like)
+ * handed out to one module, so that asking again for an unchanged
+ * object does not run its dump() and PyFormatter again.
+ *
+ * Modules may modify what they are given, so every caller gets its own
+ * copy of the dicts and lists of a dump; the leaves are immutable and
+ * shared.  Python objects cannot cross interpreters, so each module has
+ * a cache of its own, only to be used with that module's GIL held.
+ */
+class PyDumpCache
+{
+public:
+  typedef std::pair<uint64_t, uint64_t> version_t;
+
+  PyDumpCache() = default;
+  PyDumpCache(const PyDumpCache&) = delete;
+  PyDumpCache& operator=(const PyDumpCache&) = delete;
+  ~PyDumpCache();
+
+  /// a copy of the dump of what at version v, or nullptr
+  PyObject *get(const std::string& what, const version_t& v) const;
+  /// keep dump (a reference is stolen) of what at v, return a copy of it
+  PyObject *put(const std::string& what, const version_t& v, PyObject *dump);
+
+private:
+  std::map<std::string, std::pair<version_t, PyObject*>> dumps;
+};
+
 #endif
 
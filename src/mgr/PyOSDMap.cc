@@ -4,6 +4,7 @@
 #include "Mgr.h"
 
 #include "osd/OSDMap.h"
+#include "osd/OSDMapMapping.h"
 #include "common/errno.h"
 #include "common/version.h"
 #include "include/stringify.h"
@@ -148,13 +149,32 @@ static PyObject *osdmap_calc_pg_upmaps(BasePyOSDMap* self, PyObject *args)
 	   << " pools " << pools
 	   << dendl;
   PyThreadState *tstate = PyEval_SaveThread();
+  auto threads =
+    g_conf().get_val<uint64_t>("osd_calc_pg_upmaps_threads");
+  ThreadPool tp(g_ceph_context, "BasePyOSDMap::upmap_tp", "upmap_tp",
+		threads);
+  ParallelPGMapper mapper(g_ceph_context, &tp);
+  OSDMap::pg_batch_runner_t runner;
+  if (threads > 1) {
+    tp.start();
+    runner = mapper.get_runner(64);
+  }
+  OSDMap::upmap_calc_stats_t stats;
   int r = self->osdmap->calc_pg_upmaps(g_ceph_context,
 				 max_deviation,
 				 max_iterations,
 				 pools,
-				 incobj->inc);
+				 incobj->inc,
+				 runner,
+				 &stats);
+  if (threads > 1) {
+    tp.stop();
+  }
   PyEval_RestoreThread(tstate);
-  dout(10) << __func__ << " r = " << r << dendl;
+  dout(10) << __func__ << " r = " << r << " in " << stats.rounds
+	   << " rounds, stddev " << stats.start_stddev << " -> "
+	   << stats.end_stddev << " in " << stats.elapsed << "s"
+	   << (stats.timed_out ? " (out of time)" : "") << dendl;
   return PyInt_FromLong(r);
 }
 
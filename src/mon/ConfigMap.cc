@@ -101,13 +101,7 @@ void ConfigMap::dump(Formatter *f) const
   f->close_section();
 }
 
-std::map<std::string,std::string,std::less<>>
-ConfigMap::generate_entity_map(
-  const EntityName& name,
-  const map<std::string,std::string>& crush_location,
-  const CrushWrapper *crush,
-  const std::string& device_class,
-  std::map<std::string,pair<std::string,const MaskedOption*>> *src)
+vector<pair<string,Section*>> ConfigMap::get_sections(const EntityName& name)
 {
   // global, then by type, then by name prefix component(s), then name.
   // name prefix components are .-separated,
@@ -130,7 +124,18 @@ ConfigMap::generate_entity_map(
       sections.push_back(make_pair(tname, &q->second));
     }
   }
-  std::map<std::string,std::string,std::less<>> out;
+  return sections;
+}
+
+ConfigMap::entity_map_t ConfigMap::generate_entity_map(
+  const EntityName& name,
+  const map<std::string,std::string>& crush_location,
+  const CrushWrapper *crush,
+  const std::string& device_class,
+  std::map<std::string,pair<std::string,const MaskedOption*>> *src)
+{
+  auto sections = get_sections(name);
+  entity_map_t out;
   MaskedOption *prev = nullptr;
   for (auto s : sections) {
     for (auto& i : s.second->options) {
@@ -164,6 +169,38 @@ ConfigMap::generate_entity_map(
   return out;
 }
 
+const ConfigMap::entity_map_t& ConfigMap::get_entity_map(
+  const EntityName& name,
+  const map<std::string,std::string>& crush_location,
+  const CrushWrapper *crush,
+  const std::string& device_class)
+{
+  // the result only depends on the sections found for the name, not on
+  // the name itself
+  std::string key = name.get_type_name();
+  for (auto& s : get_sections(name)) {
+    key += '\0';
+    key += s.first;
+  }
+  key += '\n';
+  for (auto& [type, value] : crush_location) {
+    key += type;
+    key += '=';
+    key += value;
+    key += '\0';
+  }
+  key += '\n';
+  key += device_class;
+
+  auto p = entity_map_cache.find(key);
+  if (p == entity_map_cache.end()) {
+    p = entity_map_cache.emplace(
+      std::move(key),
+      generate_entity_map(name, crush_location, crush, device_class)).first;
+  }
+  return p->second;
+}
+
 bool ConfigMap::parse_mask(
   const std::string& who,
   std::string *section,
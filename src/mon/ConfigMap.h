@@ -96,10 +96,15 @@ struct Section {
 };
 
 struct ConfigMap {
+  typedef std::map<std::string,std::string,std::less<>> entity_map_t;
+
   Section global;
   std::map<std::string,Section> by_type;
   std::map<std::string,Section> by_id;
 
+  /// get_entity_map() results, by what they depend on
+  std::map<std::string,entity_map_t> entity_map_cache;
+
   Section *find_section(const std::string& name) {
     if (name == "global") {
       return &global;
@@ -118,19 +123,39 @@ struct ConfigMap {
     global.clear();
     by_type.clear();
     by_id.clear();
+    entity_map_cache.clear();
   }
   void dump(Formatter *f) const;
-  std::map<std::string,std::string,std::less<>> generate_entity_map(
+  entity_map_t generate_entity_map(
     const EntityName& name,
     const map<std::string,std::string>& crush_location,
     const CrushWrapper *crush,
     const std::string& device_class,
     std::map<std::string,pair<std::string,const MaskedOption*>> *src=0);
 
+  /**
+   * generate_entity_map(), resolved once for all the entities with the
+   * same type, sections, crush location and device class (e.g., the osds
+   * of a host with the same class), until the cache is cleared.  It must
+   * be when the sections or the crush map change.
+   */
+  const entity_map_t& get_entity_map(
+    const EntityName& name,
+    const map<std::string,std::string>& crush_location,
+    const CrushWrapper *crush,
+    const std::string& device_class);
+  void clear_entity_map_cache() {
+    entity_map_cache.clear();
+  }
+
   static bool parse_mask(
     const std::string& in,
     std::string *section,
     OptionMask *mask);
+
+private:
+  /// sections applying to name, from global to name
+  vector<pair<string,Section*>> get_sections(const EntityName& name);
 };
 
 
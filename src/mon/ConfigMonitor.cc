@@ -419,13 +419,14 @@ void ConfigMonitor::handle_get_config(MonOpRequestRef op)
   const OSDMap& osdmap = mon->osdmon()->osdmap;
   map<string,string> crush_location;
   osdmap.crush->get_full_location(m->host, &crush_location);
-  auto out = config_map.generate_entity_map(
+  check_crush_version();
+  auto out = config_map.get_entity_map(
     m->name,
     crush_location,
     osdmap.crush.get(),
     m->device_class);
   dout(20) << " config is " << out << dendl;
-  m->get_connection()->send_message(new MConfig{std::move(out)});
+  m->get_connection()->send_message(new MConfig{out});
 }
 
 bool ConfigMonitor::prepare_update(MonOpRequestRef op)
@@ -759,7 +760,8 @@ void ConfigMonitor::load_config()
     const OSDMap& osdmap = mon->osdmon()->osdmap;
     map<string,string> crush_location;
     osdmap.crush->get_full_location(g_conf()->host, &crush_location);
-    auto out = config_map.generate_entity_map(
+    check_crush_version();
+    auto& out = config_map.get_entity_map(
       g_conf()->name,
       crush_location,
       osdmap.crush.get(),
@@ -798,6 +800,19 @@ void ConfigMonitor::load_changeset(version_t v, ConfigChangeSet *ch)
   }
 }
 
+void ConfigMonitor::check_crush_version()
+{
+  // the cached entity maps depend on the crush locations and types
+  const OSDMap& osdmap = mon->osdmon()->osdmap;
+  if (osdmap.get_crush_version() != cached_crush_version) {
+    dout(20) << __func__ << " crush version " << osdmap.get_crush_version()
+	     << ", clearing " << config_map.entity_map_cache.size()
+	     << " cached entity maps" << dendl;
+    config_map.clear_entity_map_cache();
+    cached_crush_version = osdmap.get_crush_version();
+  }
+}
+
 bool ConfigMonitor::refresh_config(MonSession *s)
 {
   const OSDMap& osdmap = mon->osdmon()->osdmap;
@@ -819,7 +834,8 @@ bool ConfigMonitor::refresh_config(MonSession *s)
 
   dout(20) << __func__ << " " << s->entity_name << " crush " << crush_location
 	   << " device_class " << device_class << dendl;
-  auto out = config_map.generate_entity_map(
+  check_crush_version();
+  auto& out = config_map.get_entity_map(
     s->entity_name,
     crush_location,
     osdmap.crush.get(),
@@ -831,7 +847,7 @@ bool ConfigMonitor::refresh_config(MonSession *s)
   }
 
   dout(20) << __func__ << " " << out << dendl;
-  s->last_config = std::move(out);
+  s->last_config = out;
   s->any_config = true;
   return true;
 }
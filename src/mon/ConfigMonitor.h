@@ -19,6 +19,10 @@ class ConfigMonitor : public PaxosService
 
   map<string,bufferlist> current;
 
+  /// crush version of the entity maps cached by config_map
+  uint32_t cached_crush_version = 0;
+  void check_crush_version();
+
 public:
   ConfigMonitor(Monitor *m, Paxos *p, const string& service_name);
 
@@ -0,0 +1,267 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "LogChunkStore.h"
+
+#include "common/Clock.h"
+#include "common/debug.h"
+#include "compressor/Compressor.h"
+
+#define dout_subsys ceph_subsys_mon
+#undef dout_prefix
+#define dout_prefix *_dout << "log_chunks "
+
+const std::string LogChunkStore::PREFIX = "logm_chunks";
+
+bool LogChunkStore::chunk_meta_t::has(const std::string& channel,
+				      clog_type level) const
+{
+  for (auto& [c, by_prio] : counts) {
+    if (channel != "*" && c != channel) {
+      continue;
+    }
+    for (auto& [prio, n] : by_prio) {
+      if (prio >= level && n > 0) {
+	return true;
+      }
+    }
+  }
+  return false;
+}
+
+void LogChunkStore::chunk_meta_t::encode(ceph::buffer::list& bl) const
+{
+  using ceph::encode;
+  ENCODE_START(1, 1, bl);
+  encode(first_seq, bl);
+  encode(last_seq, bl);
+  encode(counts, bl);
+  ENCODE_FINISH(bl);
+}
+
+void LogChunkStore::chunk_meta_t::decode(ceph::buffer::list::const_iterator& p)
+{
+  using ceph::decode;
+  DECODE_START(1, p);
+  decode(first_seq, p);
+  decode(last_seq, p);
+  decode(counts, p);
+  DECODE_FINISH(p);
+}
+
+std::string LogChunkStore::meta_key(uint64_t id)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "m_%016llx", (unsigned long long)id);
+  return buf;
+}
+
+std::string LogChunkStore::data_key(uint64_t id)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "d_%016llx", (unsigned long long)id);
+  return buf;
+}
+
+void LogChunkStore::init(MonitorDBStore *s)
+{
+  store = s;
+  chunks.clear();
+  uncommitted.clear();
+  open.clear();
+  open_meta = chunk_meta_t();
+  open_stamp = utime_t();
+  next_id = 1;
+  last_seq = 0;
+
+  auto it = store->get_iterator(PREFIX);
+  for (it->lower_bound("m_"); it->valid(); it->next()) {
+    auto key = it->key();
+    if (key.compare(0, 2, "m_") != 0) {
+      break;
+    }
+    uint64_t id = strtoull(key.c_str() + 2, nullptr, 16);
+    auto bl = it->value();
+    auto p = bl.cbegin();
+    chunk_meta_t meta;
+    try {
+      meta.decode(p);
+    } catch (ceph::buffer::error& e) {
+      derr << __func__ << " unable to decode chunk " << id << ": "
+	   << e.what() << dendl;
+      continue;
+    }
+    last_seq = std::max(last_seq, meta.last_seq);
+    next_id = std::max(next_id, id + 1);
+    chunks.emplace(id, std::move(meta));
+  }
+  dout(10) << __func__ << " " << chunks.size() << " chunks, last seq "
+	   << last_seq << dendl;
+}
+
+void LogChunkStore::add(uint64_t seq, const LogEntry& e)
+{
+  if (open.empty()) {
+    open_meta.first_seq = seq;
+    open_stamp = ceph_clock_now();
+  }
+  open_meta.last_seq = seq;
+  open_meta.add(e);
+  open.emplace_back(seq, e);
+  last_seq = seq;
+}
+
+uint64_t LogChunkStore::flush(size_t min_entries, unsigned max_chunks,
+			      MonitorDBStore::TransactionRef t)
+{
+  if (open.empty() || open.size() < min_entries) {
+    return 0;
+  }
+
+  ceph::buffer::list raw;
+  using ceph::encode;
+  encode((uint32_t)open.size(), raw);
+  for (auto& [seq, e] : open) {
+    encode(seq, raw);
+    e.encode(raw, CEPH_FEATURES_ALL);
+  }
+
+  auto alg = g_conf().get_val<std::string>("mon_log_chunk_compression");
+  ceph::buffer::list payload;
+  if (alg != "none") {
+    auto compressor = Compressor::create(g_ceph_context, alg);
+    if (!compressor || compressor->compress(raw, payload) < 0) {
+      dout(1) << __func__ << " unable to compress with " << alg
+	      << ", writing uncompressed" << dendl;
+      payload.clear();
+      alg = "none";
+    }
+  }
+  if (alg == "none") {
+    payload = raw;
+  }
+
+  ceph::buffer::list data;
+  ENCODE_START(1, 1, data);
+  encode(alg, data);
+  encode((uint32_t)raw.length(), data);
+  encode(payload, data);
+  ENCODE_FINISH(data);
+
+  ceph::buffer::list meta;
+  open_meta.encode(meta);
+
+  uint64_t id = next_id++;
+  t->put(PREFIX, data_key(id), data);
+  t->put(PREFIX, meta_key(id), meta);
+  dout(10) << __func__ << " chunk " << id << " seq " << open_meta.first_seq
+	   << "~" << open_meta.last_seq << " " << open.size() << " entries, "
+	   << raw.length() << " -> " << payload.length() << " bytes ("
+	   << alg << ")" << dendl;
+  chunks.emplace(id, std::move(open_meta));
+  uncommitted.emplace(id, std::move(open));
+  open_meta = chunk_meta_t();
+  open.clear();
+  open_stamp = utime_t();
+
+  while (chunks.size() > std::max(max_chunks, 1u)) {
+    auto oldest = chunks.begin()->first;
+    dout(10) << __func__ << " trimming chunk " << oldest << dendl;
+    t->erase(PREFIX, data_key(oldest));
+    t->erase(PREFIX, meta_key(oldest));
+    uncommitted.erase(oldest);
+    chunks.erase(chunks.begin());
+  }
+  return id;
+}
+
+void LogChunkStore::committed(uint64_t id)
+{
+  uncommitted.erase(id);
+}
+
+void LogChunkStore::read_chunk(uint64_t id, entries_t *entries) const
+{
+  ceph::buffer::list data;
+  if (store->get(PREFIX, data_key(id), data) < 0) {
+    // trimmed
+    return;
+  }
+  try {
+    auto p = data.cbegin();
+    std::string alg;
+    uint32_t raw_len;
+    ceph::buffer::list payload;
+    DECODE_START(1, p);
+    decode(alg, p);
+    decode(raw_len, p);
+    decode(payload, p);
+    DECODE_FINISH(p);
+
+    ceph::buffer::list raw;
+    if (alg == "none") {
+      raw = std::move(payload);
+    } else {
+      auto compressor = Compressor::create(g_ceph_context, alg);
+      if (!compressor) {
+	derr << __func__ << " chunk " << id << " compressed with " << alg
+	     << ", which is not available" << dendl;
+	return;
+      }
+      if (compressor->decompress(payload, raw) < 0 ||
+	  raw.length() != raw_len) {
+	derr << __func__ << " unable to decompress chunk " << id << dendl;
+	return;
+      }
+    }
+
+    auto q = raw.cbegin();
+    uint32_t n;
+    decode(n, q);
+    entries->resize(n);
+    for (auto& [seq, e] : *entries) {
+      decode(seq, q);
+      e.decode(q);
+    }
+  } catch (ceph::buffer::error& e) {
+    derr << __func__ << " unable to decode chunk " << id << ": "
+	 << e.what() << dendl;
+    entries->clear();
+  }
+}
+
+void LogChunkStore::find(const entries_t& entries,
+			 const std::string& channel, clog_type level,
+			 size_t num, std::map<uint64_t,LogEntry> *out)
+{
+  for (auto p = entries.rbegin();
+       p != entries.rend() && out->size() < num;
+       ++p) {
+    if ((channel == "*" || p->second.channel == channel) &&
+	p->second.prio >= level) {
+      out->emplace(p->first, p->second);
+    }
+  }
+}
+
+void LogChunkStore::get_last(const std::string& channel, clog_type level,
+			     size_t num,
+			     std::map<uint64_t,LogEntry> *out) const
+{
+  find(open, channel, level, num, out);
+  for (auto p = chunks.rbegin();
+       p != chunks.rend() && out->size() < num;
+       ++p) {
+    if (!p->second.has(channel, level)) {
+      continue;
+    }
+    auto u = uncommitted.find(p->first);
+    if (u != uncommitted.end()) {
+      find(u->second, channel, level, num, out);
+    } else {
+      entries_t entries;
+      read_chunk(p->first, &entries);
+      find(entries, channel, level, num, out);
+    }
+  }
+}
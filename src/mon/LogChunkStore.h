@@ -0,0 +1,107 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common/LogEntry.h"
+#include "mon/MonitorDBStore.h"
+
+/**
+ * LogChunkStore
+ *
+ * A history of the cluster log that each monitor keeps in its own store,
+ * outside of paxos.  Entries are appended as they are committed, along
+ * with their LogSummary sequence number, and written in compressed
+ * chunks under their own prefix.  Every chunk comes with the number of
+ * its entries per channel and priority; this index is kept in memory so
+ * that looking for the last entries of a channel and level only reads
+ * the chunks that hold some.
+ *
+ * The caller writes the transactions returned by flush() and reports
+ * their commit, until which the chunks are served from memory.
+ */
+class LogChunkStore {
+public:
+  static const std::string PREFIX;
+
+  /// read the index of the stored chunks
+  void init(MonitorDBStore *store);
+
+  uint64_t get_last_seq() const {
+    return last_seq;
+  }
+  size_t get_num_chunks() const {
+    return chunks.size();
+  }
+  /// when the first entry of the open chunk was added, if it has any
+  utime_t get_open_stamp() const {
+    return open_stamp;
+  }
+
+  /// append an entry, seq being its sequence number in the LogSummary
+  void add(uint64_t seq, const LogEntry& e);
+
+  /**
+   * write the open chunk, and trim the oldest ones
+   *
+   * @param min_entries write the chunk if it has at least that many entries
+   * @param max_chunks number of chunks to keep
+   * @param t transaction to write to
+   * @return id of the chunk written, or 0 if none was
+   */
+  uint64_t flush(size_t min_entries, unsigned max_chunks,
+		 MonitorDBStore::TransactionRef t);
+
+  /// the transaction of chunk id is committed
+  void committed(uint64_t id);
+
+  /**
+   * find the last entries of a channel
+   *
+   * @param channel channel, or "*" for all
+   * @param level lowest priority wanted
+   * @param num number of entries wanted
+   * @param out [out] entries found, by sequence number
+   */
+  void get_last(const std::string& channel, clog_type level, size_t num,
+		std::map<uint64_t,LogEntry> *out) const;
+
+private:
+  typedef std::vector<std::pair<uint64_t,LogEntry>> entries_t;
+
+  struct chunk_meta_t {
+    uint64_t first_seq = 0;
+    uint64_t last_seq = 0;
+    /// channel -> priority -> number of entries
+    std::map<std::string,std::map<int32_t,uint32_t>> counts;
+
+    void add(const LogEntry& e) {
+      counts[e.channel][e.prio]++;
+    }
+    bool has(const std::string& channel, clog_type level) const;
+
+    void encode(ceph::buffer::list& bl) const;
+    void decode(ceph::buffer::list::const_iterator& p);
+  };
+
+  MonitorDBStore *store = nullptr;
+  uint64_t last_seq = 0;
+  uint64_t next_id = 1;
+  std::map<uint64_t,chunk_meta_t> chunks;  ///< by id
+  std::map<uint64_t,entries_t> uncommitted;  ///< by id
+  chunk_meta_t open_meta;
+  entries_t open;                          ///< not written yet
+  utime_t open_stamp;
+
+  static std::string meta_key(uint64_t id);
+  static std::string data_key(uint64_t id);
+
+  void read_chunk(uint64_t id, entries_t *entries) const;
+  static void find(const entries_t& entries,
+		   const std::string& channel, clog_type level, size_t num,
+		   std::map<uint64_t,LogEntry> *out);
+};
@@ -52,6 +52,9 @@ ostream& operator<<(ostream &out, const LogMonitor &pm)
 
 void LogMonitor::tick() 
 {
+  // write what has waited too long for its chunk to fill up
+  flush_log_chunks(false);
+
   if (!is_active()) return;
 
   dout(10) << *this << dendl;
@@ -169,11 +172,16 @@ void LogMonitor::update_from_paxos(bool *need_bootstrap)
       }
 
       summary.add(le);
+      if (g_conf().get_val<bool>("mon_log_chunks") &&
+	  summary.seq > log_chunks.get_last_seq()) {
+	log_chunks.add(summary.seq, le);
+      }
     }
 
     summary.version++;
     summary.prune(g_conf()->mon_log_max_summary);
   }
+  flush_log_chunks(false);
 
   dout(15) << __func__ << " logging for "
            << channel_blog.size() << " channels" << dendl;
@@ -207,6 +215,39 @@ void LogMonitor::update_from_paxos(bool *need_bootstrap)
   check_subs();
 }
 
+void LogMonitor::flush_log_chunks(bool force)
+{
+  size_t min_entries = g_conf().get_val<uint64_t>("mon_log_chunk_entries");
+  if (force) {
+    min_entries = 1;
+  } else if (!log_chunks.get_open_stamp().is_zero()) {
+    auto max_age =
+      g_conf().get_val<std::chrono::seconds>("mon_log_chunk_max_age").count();
+    if (ceph_clock_now() - log_chunks.get_open_stamp() >= utime_t(max_age, 0)) {
+      min_entries = 1;
+    }
+  }
+  auto t(std::make_shared<MonitorDBStore::Transaction>());
+  uint64_t id = log_chunks.flush(
+    min_entries,
+    g_conf().get_val<uint64_t>("mon_log_max_chunks"),
+    t);
+  if (!id) {
+    return;
+  }
+  // not part of paxos: the entries are served from memory until the
+  // chunk is written
+  mon->store->queue_transaction(t, new C_MonContext{mon, [this, id](int r) {
+	std::lock_guard l(mon->lock);
+	if (r < 0) {
+	  derr << "unable to write log chunk " << id << ": "
+	       << cpp_strerror(r) << dendl;
+	  return;
+	}
+	log_chunks.committed(id);
+      }});
+}
+
 void LogMonitor::create_pending()
 {
   pending_log.clear();
@@ -442,87 +483,43 @@ bool LogMonitor::preprocess_command(MonOpRequestRef op)
       channel = CLOG_CHANNEL_DEFAULT;
     }
 
-    // We'll apply this twice, once while counting out lines
-    // and once while outputting them.
-    auto match = [level](const LogEntry &entry) {
-      return entry.prio >= level;
-    };
-
-    // Decrement operation that sets to container end when hitting rbegin
-    ostringstream ss;
-    if (channel == "*") {
-      list<LogEntry> full_tail;
-      summary.build_ordered_tail(&full_tail);
-      derr << "full " << full_tail << dendl;
-      auto rp = full_tail.rbegin();
-      for (; num > 0 && rp != full_tail.rend(); ++rp) {
-	if (match(*rp)) {
-	  num--;
+    // the last num matching entries, from the chunks, and from the
+    // summary for those logged before the chunks were
+    map<uint64_t,LogEntry> last;
+    if (num > 0) {
+      log_chunks.get_last(channel, level, num, &last);
+    }
+    auto add_tail = [&](const list<pair<uint64_t,LogEntry>>& tail) {
+      size_t n = 0;
+      for (auto rp = tail.rbegin();
+	   rp != tail.rend() && n < (size_t)num;
+	   ++rp) {
+	if (rp->second.prio >= level) {
+	  last.insert(*rp);
+	  ++n;
 	}
       }
-      if (rp == full_tail.rend()) {
-	--rp;
-      }
-
-      // Decrement a reverse iterator such that going past rbegin()
-      // sets it to rend().  This is for writing a for() loop that
-      // goes up to (and including) rbegin()
-      auto dec = [&rp, &full_tail] () {
-        if (rp == full_tail.rbegin()) {
-          rp = full_tail.rend();
-        } else {
-          --rp;
-        }
-      };
-
-      // Move forward to the end of the container (decrement the reverse
-      // iterator).
-      for (; rp != full_tail.rend(); dec()) {
-	if (!match(*rp)) {
-	  continue;
-	}
-	if (f) {
-	  f->dump_object("entry", *rp);
-	} else {
-	  ss << *rp << "\n";
-	}
+    };
+    if (channel == "*") {
+      for (auto& p : summary.tail_by_channel) {
+	add_tail(p.second);
       }
     } else {
       auto p = summary.tail_by_channel.find(channel);
       if (p != summary.tail_by_channel.end()) {
-	auto rp = p->second.rbegin();
-	for (; num > 0 && rp != p->second.rend(); ++rp) {
-	  if (match(rp->second)) {
-	    num--;
-	  }
-	}
-	if (rp == p->second.rend()) {
-	  --rp;
-	}
+	add_tail(p->second);
+      }
+    }
+    while (last.size() > (size_t)std::max<int64_t>(num, 0)) {
+      last.erase(last.begin());
+    }
 
-        // Decrement a reverse iterator such that going past rbegin()
-        // sets it to rend().  This is for writing a for() loop that
-        // goes up to (and including) rbegin()
-        auto dec = [&rp, &p] () {
-          if (rp == p->second.rbegin()) {
-            rp = p->second.rend();
-          } else {
-            --rp;
-          }
-        };
-
-        // Move forward to the end of the container (decrement the reverse
-        // iterator).
-	for (; rp != p->second.rend(); dec()) {
-	  if (!match(rp->second)) {
-	    continue;
-	  }
-	  if (f) {
-	    f->dump_object("entry", rp->second);
-	  } else {
-	    ss << rp->second << "\n";
-	  }
-	}
+    ostringstream ss;
+    for (auto& p : last) {
+      if (f) {
+	f->dump_object("entry", p.second);
+      } else {
+	ss << p.second << "\n";
       }
     }
     if (f) {
@@ -20,6 +20,7 @@
 
 #include "include/types.h"
 #include "PaxosService.h"
+#include "LogChunkStore.h"
 
 #include "common/config_fwd.h"
 #include "common/LogEntry.h"
@@ -40,6 +41,7 @@ class LogMonitor : public PaxosService,
 private:
   multimap<utime_t,LogEntry> pending_log;
   LogSummary pending_summary, summary;
+  LogChunkStore log_chunks;  ///< local history, beyond the summary
 
   struct log_channel_info {
 
@@ -150,6 +152,8 @@ private:
     return true;
   }
 
+  void flush_log_chunks(bool force);
+
   struct C_Log;
 
   bool preprocess_command(MonOpRequestRef op);
@@ -165,6 +169,7 @@ private:
     generic_dout(10) << "LogMonitor::init" << dendl;
     g_conf().add_observer(this);
     update_log_channels();
+    log_chunks.init(mon->store);
   }
   
   void tick() override;  // check state, take actions
@@ -181,6 +186,8 @@ private:
   int sub_name_to_id(const string& n);
 
   void on_shutdown() override {
+    // the store writes queued transactions before it closes
+    flush_log_chunks(true);
     g_conf().remove_observer(this);
   }
 
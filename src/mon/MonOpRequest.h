@@ -83,6 +83,8 @@ private:
   ConnectionRef con;
   bool forwarded_to_leader;
   op_type_t op_type;
+  /// read-only, may be answered shortly past the end of the lease
+  bool lease_read = false;
 
   MonOpRequest(Message *req, OpTracker *tracker) :
     TrackedOp(tracker,
@@ -114,6 +116,7 @@ private:
       f->dump_bool("src_is_mon", is_src_mon());
       f->dump_stream("source") << request->get_source_inst();
       f->dump_bool("forwarded_to_leader", forwarded_to_leader);
+      f->dump_bool("lease_read", lease_read);
       f->close_section();
     }
   }
@@ -174,6 +177,13 @@ public:
     set_op_type(OP_TYPE_COMMAND);
   }
 
+  void set_lease_read() {
+    lease_read = true;
+  }
+  bool is_lease_read() const {
+    return lease_read;
+  }
+
   op_type_t get_op_type() {
     return op_type;
   }
@@ -698,6 +698,10 @@ int Monitor::preinit()
         "ewon", PerfCountersBuilder::PRIO_INTERESTING);
     pcb.add_u64_counter(l_mon_election_lose, "election_lose", "Elections lost",
         "elst", PerfCountersBuilder::PRIO_INTERESTING);
+    pcb.add_u64_counter(l_mon_osd_state_changes, "osd_state_changes",
+        "OSD boots and markdowns committed");
+    pcb.add_u64_counter(l_mon_osd_state_epochs_saved, "osd_state_epochs_saved",
+        "OSD boots and markdowns committed with others in the same epoch");
     logger = pcb.create_perf_counters();
     cct->get_perfcounters_collection()->add(logger);
   }
@@ -791,6 +795,11 @@ int Monitor::preinit()
     if (clear_store) {
       set<string> sync_prefixes = get_sync_targets_names();
       store->clear(sync_prefixes);
+      // nothing left to resume a sync from
+      auto t(std::make_shared<MonitorDBStore::Transaction>());
+      t->erase("mon_sync", "last_key");
+      t->erase("mon_sync", "start_version");
+      store->apply_transaction(t);
     }
   }
 
@@ -1426,6 +1435,9 @@ void Monitor::sync_reset_requester()
   sync_cookie = 0;
   sync_full = false;
   sync_start_version = 0;
+  sync_resume_key = pair<string,string>();
+  sync_chunks_pending = 0;
+  sync_chunk_wanted = false;
 }
 
 void Monitor::sync_reset_provider()
@@ -1446,8 +1458,14 @@ void Monitor::sync_start(entity_addrvec_t &addrs, bool full)
   sync_reset_provider();
 
   sync_full = full;
-
-  if (sync_full) {
+  sync_resume_key = pair<string,string>();
+  version_t resume_version = 0;
+
+  if (sync_full &&
+      sync_get_resume_point(&sync_resume_key, &resume_version)) {
+    dout(10) << __func__ << " resuming sync after key " << sync_resume_key
+	     << " from version " << resume_version << dendl;
+  } else if (sync_full) {
     // stash key state, and mark that we are syncing
     auto t(std::make_shared<MonitorDBStore::Transaction>());
     sync_stash_critical_state(t);
@@ -1457,6 +1475,8 @@ void Monitor::sync_start(entity_addrvec_t &addrs, bool full)
     dout(10) << __func__ << " marking sync in progress, storing sync_last_committed_floor "
 	     << sync_last_committed_floor << dendl;
     t->put("mon_sync", "last_committed_floor", sync_last_committed_floor);
+    t->erase("mon_sync", "last_key");
+    t->erase("mon_sync", "start_version");
 
     store->apply_transaction(t);
 
@@ -1482,11 +1502,36 @@ void Monitor::sync_start(entity_addrvec_t &addrs, bool full)
   sync_reset_timeout();
 
   MMonSync *m = new MMonSync(sync_full ? MMonSync::OP_GET_COOKIE_FULL : MMonSync::OP_GET_COOKIE_RECENT);
-  if (!sync_full)
+  if (!sync_full) {
     m->last_committed = paxos->get_version();
+  } else if (resume_version) {
+    m->last_committed = resume_version;
+    m->last_key = sync_resume_key;
+  }
   messenger->send_to_mon(m, sync_provider);
 }
 
+bool Monitor::sync_get_resume_point(pair<string,string> *key,
+				    version_t *version)
+{
+  if (!g_conf().get_val<bool>("mon_sync_resume") ||
+      !store->exists("mon_sync", "in_sync") ||
+      !store->exists("mon_sync", "last_key") ||
+      store->get("mon_sync", "force_sync") > 0) {
+    return false;
+  }
+  *version = store->get("mon_sync", "start_version");
+  if (*version == 0) {
+    return false;
+  }
+  bufferlist bl;
+  int err = store->get("mon_sync", "last_key", bl);
+  ceph_assert(err == 0);
+  auto p = bl.cbegin();
+  decode(*key, p);
+  return true;
+}
+
 void Monitor::sync_stash_critical_state(MonitorDBStore::TransactionRef t)
 {
   dout(10) << __func__ << dendl;
@@ -1631,6 +1676,16 @@ void Monitor::handle_sync_get_cookie(MonOpRequestRef op)
     // full scan
     sync_targets = get_sync_targets_names();
     sp.last_committed = paxos->get_version();
+    if (!m->last_key.first.empty() &&
+	m->last_committed >= paxos->get_first_committed() &&
+	m->last_committed <= paxos->get_version()) {
+      // resume an interrupted sync.  the keys up to last_key are
+      // older than ours; replaying paxos from the version they were
+      // read at brings them up to date.
+      sp.last_committed = m->last_committed;
+      sp.last_key = m->last_key;
+      dout(10) << __func__ << " resuming after key " << sp.last_key << dendl;
+    }
     sp.synchronizer = store->get_synchronizer(sp.last_key, sync_targets);
     sp.full = true;
     dout(10) << __func__ << " will sync prefixes " << sync_targets << dendl;
@@ -1642,6 +1697,7 @@ void Monitor::handle_sync_get_cookie(MonOpRequestRef op)
 
   MMonSync *reply = new MMonSync(MMonSync::OP_COOKIE, sp.cookie);
   reply->last_committed = sp.last_committed;
+  reply->last_key = sp.last_key;
   m->get_connection()->send_message(reply);
 }
 
@@ -1731,6 +1787,29 @@ void Monitor::handle_sync_cookie(MonOpRequestRef op)
   sync_cookie = m->cookie;
   sync_start_version = m->last_committed;
 
+  if (sync_full) {
+    if (sync_resume_key != pair<string,string>() &&
+	m->last_key != sync_resume_key) {
+      // the provider could not resume (or does not know how to), so we
+      // start over
+      dout(1) << __func__ << " provider did not resume after "
+	      << sync_resume_key << ", clearing store" << dendl;
+      // clear() does not go through the commit queue; let the chunks
+      // of the previous attempt land first
+      lock.unlock();
+      store->flush();
+      lock.lock();
+      set<string> targets = get_sync_targets_names();
+      store->clear(targets);
+      paxos->init();
+    }
+    // until our first chunk commits there is nothing to resume after
+    auto t(std::make_shared<MonitorDBStore::Transaction>());
+    t->put("mon_sync", "start_version", sync_start_version);
+    t->erase("mon_sync", "last_key");
+    store->apply_transaction(t);
+  }
+
   sync_reset_timeout();
   sync_get_next_chunk();
 
@@ -1769,6 +1848,12 @@ void Monitor::handle_sync_chunk(MonOpRequestRef op)
 
   auto tx(std::make_shared<MonitorDBStore::Transaction>());
   tx->append_from_encoded(m->chunk_bl);
+  if (sync_full && !m->last_key.first.empty()) {
+    // where to resume if we are interrupted
+    bufferlist bl;
+    encode(m->last_key, bl);
+    tx->put("mon_sync", "last_key", bl);
+  }
 
   dout(30) << __func__ << " tx dump:\n";
   JSONFormatter f(true);
@@ -1776,6 +1861,30 @@ void Monitor::handle_sync_chunk(MonOpRequestRef op)
   f.flush(*_dout);
   *_dout << dendl;
 
+  const auto max_pending =
+    g_conf().get_val<int64_t>("mon_sync_max_pending_chunks");
+  if (sync_full && m->op == MMonSync::OP_CHUNK && max_pending > 0) {
+    // fetch the next chunk while this one is written.  the store
+    // commits in order, and the last chunk is applied synchronously
+    // behind the queued ones.
+    ++sync_chunks_pending;
+    store->queue_transaction(
+      tx,
+      new C_MonContext{this, [this, cookie=sync_cookie](int) {
+	  std::lock_guard l(lock);
+	  sync_chunk_committed(cookie);
+	}});
+    sync_reset_timeout();
+    if (sync_chunks_pending < max_pending) {
+      sync_get_next_chunk();
+    } else {
+      dout(20) << __func__ << " " << sync_chunks_pending
+	       << " chunks pending, waiting for a commit" << dendl;
+      sync_chunk_wanted = true;
+    }
+    return;
+  }
+
   store->apply_transaction(tx);
 
   ceph_assert(g_conf()->mon_sync_requester_kill_at != 6);
@@ -1805,6 +1914,23 @@ void Monitor::handle_sync_chunk(MonOpRequestRef op)
   }
 }
 
+void Monitor::sync_chunk_committed(uint64_t cookie)
+{
+  if (!is_synchronizing() || cookie != sync_cookie) {
+    dout(20) << __func__ << " cookie " << cookie << " is stale" << dendl;
+    return;
+  }
+  ceph_assert(sync_chunks_pending > 0);
+  --sync_chunks_pending;
+  dout(20) << __func__ << " " << sync_chunks_pending << " chunks pending"
+	   << dendl;
+  ceph_assert(g_conf()->mon_sync_requester_kill_at != 6);
+  if (sync_chunk_wanted) {
+    sync_chunk_wanted = false;
+    sync_get_next_chunk();
+  }
+}
+
 void Monitor::handle_sync_no_cookie(MonOpRequestRef op)
 {
   dout(10) << __func__ << dendl;
@@ -2037,6 +2163,13 @@ void Monitor::handle_probe_reply(MonOpRequestRef op)
 	     << sync_last_committed_floor << ", ignoring"
 	     << dendl;
   } else {
+    if (store->exists("mon_sync", "in_sync")) {
+      dout(10) << " an interrupted sync left the store inconsistent"
+	       << dendl;
+      cancel_probe_timeout();
+      sync_start(other, true);
+      return;
+    }
     if (paxos->get_version() < m->paxos_first_version &&
 	m->paxos_first_version > 1) {  // no need to sync if we're 0 and they start at 1.
       dout(10) << " peer paxos first versions [" << m->paxos_first_version
@@ -3385,6 +3518,10 @@ void Monitor::handle_command(MonOpRequestRef op)
       << "entity='" << session->entity_name << "' "
       << "cmd=" << m->cmd << ": dispatch";
 
+  if (!cmd_is_rw) {
+    op->set_lease_read();
+  }
+
   if (mon_cmd->is_mgr()) {
     const auto& hdr = m->get_header();
     uint64_t size = hdr.front_len + hdr.middle_len + hdr.data_len;
@@ -5107,7 +5244,10 @@ void Monitor::handle_subscribe(MonOpRequestRef op)
       std::lock_guard l(session_map_lock);
       session_map.add_update_sub(s, p->first, p->second.start,
 				 p->second.flags & CEPH_SUBSCRIBE_ONETIME,
-				 m->get_connection()->has_feature(CEPH_FEATURE_INCSUBOSDMAP));
+				 m->get_connection()->has_feature(CEPH_FEATURE_INCSUBOSDMAP),
+				 // osds store every epoch
+				 (p->second.flags & CEPH_SUBSCRIBE_RANGE_INC) &&
+				 !s->name.is_osd());
     }
 
     if (p->first.compare(0, 6, "mdsmap") == 0 || p->first.compare(0, 5, "fsmap") == 0) {
@@ -5182,8 +5322,12 @@ void Monitor::handle_get_version(MonOpRequestRef op)
 
   if (svc) {
     if (!svc->is_readable()) {
-      svc->wait_for_readable(op, new C_RetryMessage(this, op));
-      goto out;
+      if (!svc->is_lease_readable()) {
+	svc->wait_for_readable(op, new C_RetryMessage(this, op));
+	goto out;
+      }
+      dout(10) << " lease expired, answering with v"
+	       << svc->get_last_committed() << dendl;
     }
 
     MMonGetVersionReply *reply = new MMonGetVersionReply();
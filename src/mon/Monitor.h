@@ -93,6 +93,8 @@ enum {
   l_mon_election_call,
   l_mon_election_win,
   l_mon_election_lose,
+  l_mon_osd_state_changes,
+  l_mon_osd_state_epochs_saved,
   l_mon_last,
 };
 
@@ -322,6 +324,9 @@ private:
   bool sync_full;                ///< true if we are a full sync, false for recent catch-up
   version_t sync_start_version;  ///< last_committed at sync start
   Context *sync_timeout_event;   ///< timeout event
+  pair<string,string> sync_resume_key; ///< key we asked to resume after
+  int sync_chunks_pending = 0;   ///< chunks queued but not yet committed
+  bool sync_chunk_wanted = false; ///< next chunk waits for a commit
 
   /**
    * floor for sync source
@@ -408,6 +413,27 @@ private:
    */
   void sync_stash_critical_state(MonitorDBStore::TransactionRef tx);
 
+  /**
+   * find where an interrupted full sync left off
+   *
+   * A full sync records the last key it committed along with each chunk.
+   * If the sync is interrupted, e.g. because the provider went away, we
+   * ask the next provider to go on after that key and to replay paxos
+   * from the version the sync started at, instead of starting over with
+   * an empty store.  (On restart the store is still cleared, since the
+   * services cannot be initialized from a partial store.)
+   *
+   * @param key [out] last key committed
+   * @param version [out] paxos version the sync started at
+   * @returns true if the sync can be resumed
+   */
+  bool sync_get_resume_point(pair<string,string> *key, version_t *version);
+
+  /**
+   * a pipelined chunk was committed to the store
+   */
+  void sync_chunk_committed(uint64_t cookie);
+
   /**
    * reset the sync timeout
    *
@@ -17,7 +17,9 @@
 #include "include/buffer.h"
 #include <set>
 #include <map>
+#include <deque>
 #include <string>
+#include <vector>
 #include <boost/scoped_ptr.hpp>
 #include <sstream>
 #include <fstream>
@@ -26,14 +28,27 @@
 #include "include/ceph_assert.h"
 #include "common/Formatter.h"
 #include "common/Finisher.h"
+#include "common/Thread.h"
+#include "common/ceph_mutex.h"
 #include "common/errno.h"
 #include "common/debug.h"
+#include "common/perf_counters.h"
 #include "common/safe_io.h"
 #include "common/blkdev.h"
 #include "common/PriorityCache.h"
 
 #define dout_context g_ceph_context
 
+enum {
+  l_monstore_first = 456500,
+  l_monstore_commit,
+  l_monstore_commit_txns,
+  l_monstore_commit_bytes,
+  l_monstore_commit_lat,
+  l_monstore_commit_lat_hist,
+  l_monstore_last,
+};
+
 class MonitorDBStore
 {
   string path;
@@ -48,6 +63,8 @@ class MonitorDBStore
 
   bool is_open;
 
+  PerfCounters *logger = nullptr;
+
  public:
 
   string get_devname() {
@@ -293,47 +310,156 @@ class MonitorDBStore
     }
   };
 
-  int apply_transaction(MonitorDBStore::TransactionRef t) {
-    KeyValueDB::Transaction dbt = db->get_transaction();
+private:
+  /*
+   * Group commit.  Transactions are written by commit_thread: everything
+   * queued while the previous write was in progress goes to the store as
+   * a single KV transaction with a single sync, up to
+   * mon_store_group_commit_max_bytes at a time.  Completions of queued
+   * transactions run in order on io_work, so that a callback taking the
+   * monitor lock never holds up the writes.
+   */
+  struct QueuedTransaction {
+    TransactionRef t;
+    Context *oncommit = nullptr;  ///< for queue_transaction
+    int *result = nullptr;        ///< for a waiting apply_transaction
+    bool *done = nullptr;
+  };
 
-    if (do_dump) {
-      if (!g_conf()->mon_debug_dump_json) {
-        bufferlist bl;
-        t->encode(bl);
-        bl.write_fd(dump_fd_binary);
-      } else {
-        t->dump(&dump_fmt, true);
-        dump_fmt.flush(dump_fd_json);
-        dump_fd_json.flush();
+  ceph::mutex commit_lock = ceph::make_mutex("MonitorDBStore::commit_lock");
+  ceph::condition_variable commit_cond;       ///< work for commit_thread
+  ceph::condition_variable commit_done_cond;  ///< a batch was written
+  std::deque<QueuedTransaction> commit_queue;
+  bool committing = false;
+  bool commit_stop = false;
+
+  class CommitThread : public Thread {
+    MonitorDBStore *store;
+  public:
+    explicit CommitThread(MonitorDBStore *s) : store(s) {}
+    void *entry() override {
+      store->commit_entry();
+      return nullptr;
+    }
+  } commit_thread;
+
+  void commit_entry() {
+    std::unique_lock l(commit_lock);
+    while (true) {
+      if (commit_queue.empty()) {
+	if (commit_stop) {
+	  break;
+	}
+	commit_cond.wait(l);
+	continue;
+      }
+      const uint64_t max_bytes =
+	g_conf().get_val<Option::size_t>("mon_store_group_commit_max_bytes");
+      std::vector<QueuedTransaction> batch;
+      uint64_t bytes = 0;
+      bool delay = false;
+      while (!commit_queue.empty() &&
+	     (batch.empty() ||
+	      bytes + commit_queue.front().t->bytes <= max_bytes)) {
+	bytes += commit_queue.front().t->bytes;
+	delay |= commit_queue.front().oncommit != nullptr;
+	batch.push_back(std::move(commit_queue.front()));
+	commit_queue.pop_front();
       }
+      committing = true;
+      l.unlock();
+
+      if (delay) {
+	maybe_inject_delay();
+      }
+      int r = _apply_transactions(batch);
+
+      l.lock();
+      committing = false;
+      for (auto& q : batch) {
+	if (q.oncommit) {
+	  io_work.queue(q.oncommit, r);
+	} else {
+	  *q.result = r;
+	  *q.done = true;
+	}
+      }
+      commit_done_cond.notify_all();
     }
+  }
+
+  void maybe_inject_delay() {
+    /* Transactions are written one batch at a time, so we can safely
+     * sleep prior to writing a batch as it won't break the model.
+     */
+    double delay_prob = g_conf()->mon_inject_transaction_delay_probability;
+    if (delay_prob && (rand() % 10000 < delay_prob * 10000.0)) {
+      utime_t delay;
+      double delay_max = g_conf()->mon_inject_transaction_delay_max;
+      delay.set_from_double(delay_max * (double)(rand() % 10000) / 10000.0);
+      lsubdout(g_ceph_context, mon, 1)
+	<< "apply_transaction will be delayed for " << delay
+	<< " seconds" << dendl;
+      delay.sleep();
+    }
+  }
 
+  int _apply_transactions(const std::vector<QueuedTransaction>& batch) {
+    KeyValueDB::Transaction dbt = db->get_transaction();
     list<pair<string, pair<string,string> > > compact;
-    for (list<Op>::const_iterator it = t->ops.begin();
-	 it != t->ops.end();
-	 ++it) {
-      const Op& op = *it;
-      switch (op.type) {
-      case Transaction::OP_PUT:
-	dbt->set(op.prefix, op.key, op.bl);
-	break;
-      case Transaction::OP_ERASE:
-	dbt->rmkey(op.prefix, op.key);
-	break;
-      case Transaction::OP_ERASE_RANGE:
-	dbt->rm_range_keys(op.prefix, op.key, op.endkey);
-	break;
-      case Transaction::OP_COMPACT:
-	compact.push_back(make_pair(op.prefix, make_pair(op.key, op.endkey)));
-	break;
-      default:
-	derr << __func__ << " unknown op type " << op.type << dendl;
-	ceph_abort();
-	break;
+    uint64_t bytes = 0;
+
+    for (auto& q : batch) {
+      const TransactionRef& t = q.t;
+      bytes += t->bytes;
+      if (do_dump) {
+	if (!g_conf()->mon_debug_dump_json) {
+	  bufferlist bl;
+	  t->encode(bl);
+	  bl.write_fd(dump_fd_binary);
+	} else {
+	  t->dump(&dump_fmt, true);
+	  dump_fmt.flush(dump_fd_json);
+	  dump_fd_json.flush();
+	}
+      }
+
+      for (list<Op>::const_iterator it = t->ops.begin();
+	   it != t->ops.end();
+	   ++it) {
+	const Op& op = *it;
+	switch (op.type) {
+	case Transaction::OP_PUT:
+	  dbt->set(op.prefix, op.key, op.bl);
+	  break;
+	case Transaction::OP_ERASE:
+	  dbt->rmkey(op.prefix, op.key);
+	  break;
+	case Transaction::OP_ERASE_RANGE:
+	  dbt->rm_range_keys(op.prefix, op.key, op.endkey);
+	  break;
+	case Transaction::OP_COMPACT:
+	  compact.push_back(make_pair(op.prefix, make_pair(op.key, op.endkey)));
+	  break;
+	default:
+	  derr << __func__ << " unknown op type " << op.type << dendl;
+	  ceph_abort();
+	  break;
+	}
       }
     }
+    auto start = ceph::mono_clock::now();
     int r = db->submit_transaction_sync(dbt);
     if (r >= 0) {
+      if (logger) {
+	auto lat = ceph::mono_clock::now() - start;
+	logger->inc(l_monstore_commit);
+	logger->inc(l_monstore_commit_txns, batch.size());
+	logger->inc(l_monstore_commit_bytes, bytes);
+	logger->tinc(l_monstore_commit_lat, lat);
+	logger->hinc(l_monstore_commit_lat_hist,
+		     std::chrono::nanoseconds(lat).count(), batch.size());
+      }
       while (!compact.empty()) {
 	if (compact.front().second.first == string() &&
 	    compact.front().second.second == string())
@@ -348,37 +474,88 @@ class MonitorDBStore
     return r;
   }
 
-  struct C_DoTransaction : public Context {
-    MonitorDBStore *store;
-    MonitorDBStore::TransactionRef t;
-    Context *oncommit;
-    C_DoTransaction(MonitorDBStore *s, MonitorDBStore::TransactionRef t,
-		    Context *f)
-      : store(s), t(t), oncommit(f)
-    {}
-    void finish(int r) override {
-      /* The store serializes writes.  Each transaction is handled
-       * sequentially by the io_work Finisher.  If a transaction takes longer
-       * to apply its state to permanent storage, then no other transaction
-       * will be handled meanwhile.
-       *
-       * We will now randomly inject random delays.  We can safely sleep prior
-       * to applying the transaction as it won't break the model.
-       */
-      double delay_prob = g_conf()->mon_inject_transaction_delay_probability;
-      if (delay_prob && (rand() % 10000 < delay_prob * 10000.0)) {
-        utime_t delay;
-        double delay_max = g_conf()->mon_inject_transaction_delay_max;
-        delay.set_from_double(delay_max * (double)(rand() % 10000) / 10000.0);
-        lsubdout(g_ceph_context, mon, 1)
-          << "apply_transaction will be delayed for " << delay
-          << " seconds" << dendl;
-        delay.sleep();
-      }
-      int ret = store->apply_transaction(t);
-      oncommit->complete(ret);
+  void start_commit_thread() {
+    {
+      std::lock_guard l(commit_lock);
+      commit_stop = false;
     }
-  };
+    commit_thread.create("monstore_commit");
+  }
+
+  void stop_commit_thread() {
+    if (!commit_thread.is_started()) {
+      return;
+    }
+    {
+      std::lock_guard l(commit_lock);
+      commit_stop = true;
+      commit_cond.notify_all();
+    }
+    commit_thread.join();
+  }
+
+  void create_logger() {
+    PerfCountersBuilder b(g_ceph_context, "monstore",
+			  l_monstore_first, l_monstore_last);
+    // latency of a batch, by the number of transactions in it
+    PerfHistogramCommon::axis_config_d lat_axis{
+      "Latency (usec)",
+      PerfHistogramCommon::SCALE_LOG2,
+      0,
+      100000,  ///< 100usec
+      32,
+    };
+    PerfHistogramCommon::axis_config_d txns_axis{
+      "Transactions",
+      PerfHistogramCommon::SCALE_LOG2,
+      0,
+      1,
+      12,
+    };
+    b.set_prio_default(PerfCountersBuilder::PRIO_USEFUL);
+    b.add_u64_counter(l_monstore_commit, "commit",
+		      "Writes to the store (each a batch of transactions)");
+    b.add_u64_counter(l_monstore_commit_txns, "commit_txns",
+		      "Transactions written");
+    b.add_u64_counter(l_monstore_commit_bytes, "commit_bytes",
+		      "Bytes written", NULL, 0, UNIT_BYTES);
+    b.add_time_avg(l_monstore_commit_lat, "commit_lat",
+		   "Latency of a write to the store, including its sync");
+    b.add_u64_counter_histogram(
+      l_monstore_commit_lat_hist, "commit_lat_histogram",
+      lat_axis, txns_axis,
+      "Histogram of write latency (in usec) vs transactions per write");
+    logger = b.create_perf_counters();
+    g_ceph_context->get_perfcounters_collection()->add(logger);
+  }
+
+  void destroy_logger() {
+    if (logger) {
+      g_ceph_context->get_perfcounters_collection()->remove(logger);
+      delete logger;
+      logger = nullptr;
+    }
+  }
+
+public:
+  /**
+   * apply transaction
+   *
+   * Write a transaction and wait for it to be committed.  It may share
+   * the write with transactions queued meanwhile.
+   */
+  int apply_transaction(MonitorDBStore::TransactionRef t) {
+    if (!commit_thread.is_started()) {
+      return _apply_transactions({QueuedTransaction{t}});
+    }
+    int r = 0;
+    bool done = false;
+    std::unique_lock l(commit_lock);
+    commit_queue.push_back(QueuedTransaction{t, nullptr, &r, &done});
+    commit_cond.notify_all();
+    commit_done_cond.wait(l, [&done] { return done; });
+    return r;
+  }
 
   /**
    * queue transaction
@@ -388,13 +565,21 @@ class MonitorDBStore
    */
   void queue_transaction(MonitorDBStore::TransactionRef t,
 			 Context *oncommit) {
-    io_work.queue(new C_DoTransaction(this, t, oncommit));
+    std::lock_guard l(commit_lock);
+    commit_queue.push_back(QueuedTransaction{t, oncommit});
+    commit_cond.notify_all();
   }
 
   /**
    * block and flush all io activity
    */
   void flush() {
+    {
+      std::unique_lock l(commit_lock);
+      commit_done_cond.wait(l, [this] {
+	return commit_queue.empty() && !committing;
+      });
+    }
     io_work.wait_for_empty();
   }
 
@@ -688,7 +873,9 @@ class MonitorDBStore
           PerfCountersBuilder::PRIO_USEFUL - PerfCountersBuilder::PRIO_DEBUGONLY);
     }
 
+    create_logger();
     io_work.start();
+    start_commit_thread();
     is_open = true;
     return 0;
   }
@@ -707,14 +894,18 @@ class MonitorDBStore
     r = db->create_and_open(out);
     if (r < 0)
       return r;
+    create_logger();
     io_work.start();
+    start_commit_thread();
     is_open = true;
     return 0;
   }
 
   void close() {
     // there should be no work queued!
+    stop_commit_thread();
     io_work.stop();
+    destroy_logger();
     is_open = false;
     db.reset(NULL);
   }
@@ -794,7 +985,8 @@ class MonitorDBStore
       dump_fd_binary(-1),
       dump_fmt(true),
       io_work(g_ceph_context, "monstore", "fn_monstore"),
-      is_open(false) {
+      is_open(false),
+      commit_thread(this) {
   }
   ~MonitorDBStore() {
     ceph_assert(!is_open);
@@ -770,6 +770,16 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     err = osdmap.apply_incremental(inc);
     ceph_assert(err == 0);
 
+    // remember it so that the next mapping job only has to remap what
+    // it changed; crush or full map changes need a full remap anyway
+    if (g_conf().get_val<bool>("mon_osd_mapping_incremental") &&
+	!inc.fullmap.length() && !inc.crush.length() &&
+	mapping_incs.size() < 64) {
+      mapping_incs.push_back(inc);
+    } else {
+      mapping_incs.clear();
+    }
+
     if (!t)
       t.reset(new MonitorDBStore::Transaction);
 
@@ -811,6 +821,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
 
 	osdmap = OSDMap();
 	osdmap.decode(orig_full_bl);
+	mapping_incs.clear();
 
 	dout(20) << __func__ << " canonical full osdmap:\n";
 	JSONFormatter jf(true);
@@ -971,10 +982,18 @@ void OSDMonitor::start_mapping()
   }
   if (!osdmap.get_pools().empty()) {
     auto fin = new C_UpdateCreatingPGs(this, osdmap.get_epoch());
+    // drop the incrementals the mapping already reflects
+    while (!mapping_incs.empty() &&
+	   mapping_incs.front().epoch <= mapping.get_epoch()) {
+      mapping_incs.pop_front();
+    }
     mapping_job = mapping.start_update(osdmap, mapper,
-				       g_conf()->mon_osd_mapping_pgs_per_chunk);
+				       g_conf()->mon_osd_mapping_pgs_per_chunk,
+				       mapping_incs);
     dout(10) << __func__ << " started mapping job " << mapping_job.get()
-	     << " at " << fin->start << dendl;
+	     << " at " << fin->start << ", remapping "
+	     << mapping.get_last_update_pgs() << " pgs ("
+	     << mapping.get_last_update_fraction() * 100.0 << "%)" << dendl;
     mapping_job->set_finish_event(fin);
   } else {
     dout(10) << __func__ << " no pools, no mapping job" << dendl;
@@ -1062,6 +1081,7 @@ void OSDMonitor::create_pending()
   pending_metadata.clear();
   pending_metadata_rm.clear();
   pending_pseudo_purged_snaps.clear();
+  pending_state_changes = 0;
 
   dout(10) << "create_pending e " << pending_inc.epoch << dendl;
 
@@ -1477,6 +1497,13 @@ void OSDMonitor::encode_pending(MonitorDBStore::TransactionRef t)
             << pending_inc.epoch << dendl;
   }
 
+  if (pending_state_changes) {
+    dout(10) << __func__ << " " << pending_state_changes
+	     << " osd boots and markdowns" << dendl;
+    mon->logger->inc(l_mon_osd_state_changes, pending_state_changes);
+    mon->logger->inc(l_mon_osd_state_epochs_saved, pending_state_changes - 1);
+  }
+
   // finalize up pending_inc
   pending_inc.modified = ceph_clock_now();
 
@@ -2701,7 +2728,36 @@ bool OSDMonitor::should_propose(double& delay)
     return true;
   }
 
-  return PaxosService::should_propose(delay);
+  if (!PaxosService::should_propose(delay)) {
+    return false;
+  }
+
+  double left = get_own_delay(ceph_clock_now());
+  if (left > delay) {
+    dout(10) << __func__ << " " << pending_state_changes
+	     << " osd boots and markdowns pending, waiting " << left
+	     << "s for more" << dendl;
+    delay = left;
+  }
+  return true;
+}
+
+double OSDMonitor::get_own_delay(utime_t now)
+{
+  // give the other osds of a failing or rebooting host or rack a chance
+  // to go in the same epoch
+  if (!pending_state_changes) {
+    return 0.0;
+  }
+  double window = g_conf().get_val<double>("mon_osd_state_batch_window");
+  return window - (double)(now - pending_state_change_stamp);
+}
+
+void OSDMonitor::note_state_change()
+{
+  if (!pending_state_changes++) {
+    pending_state_change_stamp = ceph_clock_now();
+  }
 }
 
 
@@ -2922,6 +2978,7 @@ bool OSDMonitor::prepare_mark_me_down(MonOpRequestRef op)
 
   mon->clog->info() << "osd." << target_osd << " marked itself down";
   pending_inc.new_state[target_osd] = CEPH_OSD_UP;
+  note_state_change();
   if (m->request_ack)
     wait_for_finished_proposal(op, new C_AckMarkedDown(this, op));
   return true;
@@ -3154,6 +3211,7 @@ bool OSDMonitor::check_failure(utime_t now, int target_osd, failure_info_t& fi)
     dout(1) << " we have enough reporters to mark osd." << target_osd
 	    << " down" << dendl;
     pending_inc.new_state[target_osd] = CEPH_OSD_UP;
+    note_state_change();
 
     mon->clog->info() << "osd." << target_osd << " failed ("
 		      << osdmap.crush->get_full_location_ordered_string(
@@ -3179,6 +3237,7 @@ void OSDMonitor::force_failure(int target_osd, int by)
 
   dout(1) << " we're forcing failure of osd." << target_osd << dendl;
   pending_inc.new_state[target_osd] = CEPH_OSD_UP;
+  note_state_change();
   if (!pending_inc.new_xinfo.count(target_osd)) {
     pending_inc.new_xinfo[target_osd] = osdmap.osd_xinfo[target_osd];
   }
@@ -3461,6 +3520,7 @@ bool OSDMonitor::prepare_boot(MonOpRequestRef op)
 	(pending_inc.new_state[from] & CEPH_OSD_UP) == 0) {
       // mark previous guy down
       pending_inc.new_state[from] = CEPH_OSD_UP;
+      note_state_change();
     }
     wait_for_finished_proposal(op, new C_RetryMessage(this, op));
   } else if (pending_inc.new_up_client.count(from)) {
@@ -3471,6 +3531,7 @@ bool OSDMonitor::prepare_boot(MonOpRequestRef op)
   } else {
     // mark new guy up.
     pending_inc.new_up_client[from] = m->get_orig_source_addrs();
+    note_state_change();
     pending_inc.new_up_cluster[from] = m->cluster_addrs;
     pending_inc.new_hb_back_up[from] = m->hb_back_addrs;
     pending_inc.new_hb_front_up[from] = m->hb_front_addrs;
@@ -4340,7 +4401,8 @@ void OSDMonitor::send_incremental(MonOpRequestRef op, epoch_t first)
 void OSDMonitor::send_incremental(epoch_t first,
 				  MonSession *session,
 				  bool onetime,
-				  MonOpRequestRef req)
+				  MonOpRequestRef req,
+				  bool range)
 {
   dout(5) << "send_incremental [" << first << ".." << osdmap.get_epoch() << "]"
 	  << " to " << session->name << dendl;
@@ -4381,6 +4443,34 @@ void OSDMonitor::send_incremental(epoch_t first,
     first++;
   }
 
+  // far behind: one delta from the peer's map to the latest instead of
+  // one incremental per epoch
+  const epoch_t min_range =
+    g_conf().get_val<uint64_t>("mon_osd_range_incremental_min_epochs");
+  if (range && min_range > 0 && first > get_first_committed() &&
+      first + min_range <= osdmap.get_epoch() + 1) {
+    bufferlist bl;
+    int err = get_range_incremental(first - 1, osdmap.get_epoch(), features,
+				    bl);
+    if (err == 0) {
+      MOSDMap *m = new MOSDMap(osdmap.get_fsid(), features);
+      m->oldest_map = get_first_committed();
+      m->newest_map = osdmap.get_epoch();
+      m->range_incremental_maps[osdmap.get_epoch()] = bl;
+      dout(20) << "send_incremental range " << first - 1 << ".."
+	       << osdmap.get_epoch() << " " << bl.length() << " bytes" << dendl;
+      if (req) {
+	mon->send_reply(req, m);
+      } else {
+	session->con->send_message(m);
+      }
+      session->osd_epoch = osdmap.get_epoch();
+      return;
+    }
+    dout(10) << __func__ << " failed to build range incremental from "
+	     << first - 1 << ": " << cpp_strerror(err) << dendl;
+  }
+
   while (first <= osdmap.get_epoch()) {
     epoch_t last = std::min<epoch_t>(first + g_conf()->osd_map_message_max - 1,
 				     osdmap.get_epoch());
@@ -4485,6 +4575,46 @@ int OSDMonitor::get_inc(version_t ver, OSDMap::Incremental& inc)
   return 0;
 }
 
+int OSDMonitor::get_range_incremental(version_t base, version_t ver,
+				      uint64_t features, bufferlist& bl)
+{
+  // epochs are 32 bits, so the range keys never collide with the
+  // per-epoch ones
+  uint64_t significant_features = OSDMap::get_significant_features(features);
+  osdmap_key_t key = {(base << 32) | ver, significant_features};
+  if (inc_osd_cache.lookup(key, &bl)) {
+    return 0;
+  }
+  bufferlist from_bl, to_bl;
+  int err = get_version_full(base, features, from_bl);
+  if (err < 0) {
+    return err;
+  }
+  err = get_version_full(ver, features, to_bl);
+  if (err < 0) {
+    return err;
+  }
+  // reencode the base canonically so that the peer can reproduce it
+  // byte for byte from the map it has
+  OSDMap from;
+  from.decode(from_bl);
+  OSDMap::RangeIncremental ri;
+  ri.fsid = from.get_fsid();
+  ri.base = base;
+  ri.epoch = ver;
+  ri.base_features = features & from.get_encoding_features();
+  from_bl.clear();
+  from.encode(from_bl, ri.base_features | CEPH_FEATURE_RESERVED);
+  ri.build(from_bl, to_bl);
+  dout(10) << __func__ << " " << base << ".." << ver << " delta "
+	   << ri.delta.length() << " bytes, full map " << to_bl.length()
+	   << " bytes" << dendl;
+  bl.clear();
+  encode(ri, bl);
+  inc_osd_cache.add_bytes(key, bl);
+  return 0;
+}
+
 int OSDMonitor::get_full_from_pinned_map(version_t ver, bufferlist& bl)
 {
   dout(10) << __func__ << " ver " << ver << dendl;
@@ -4668,7 +4798,8 @@ void OSDMonitor::check_osdmap_sub(Subscription *sub)
 	   << (sub->onetime ? " (onetime)":" (ongoing)") << dendl;
   if (sub->next <= osdmap.get_epoch()) {
     if (sub->next >= 1)
-      send_incremental(sub->next, sub->session, sub->incremental_onetime);
+      send_incremental(sub->next, sub->session, sub->incremental_onetime,
+		       MonOpRequestRef(), sub->range_incremental);
     else
       sub->session->con->send_message(build_latest_full(sub->session->con_features));
     if (sub->onetime)
@@ -5130,6 +5261,7 @@ bool OSDMonitor::handle_osd_timeouts(const utime_t &now,
 	derr << "no beacon from osd." << i << " since " << t->second
 	     << ", " << diff << " seconds ago.  marking down" << dendl;
 	pending_inc.new_state[i] = CEPH_OSD_UP;
+	note_state_change();
 	new_down = true;
       }
     }
@@ -226,6 +226,8 @@ public:
   set<int>             pending_metadata_rm;
   map<int, failure_info_t> failure_info;
   map<int,utime_t>    down_pending_out;  // osd down -> out
+  unsigned pending_state_changes = 0;  ///< boots and markdowns in pending_inc
+  utime_t pending_state_change_stamp;  ///< when the first one was prepared
   bool priority_convert = false;
   map<int64_t,set<snapid_t>> pending_pseudo_purged_snaps;
   std::shared_ptr<PriorityCache::PriCache> rocksdb_binned_kv_cache = nullptr;
@@ -393,6 +395,8 @@ private:
   ParallelPGMapper mapper;                        ///< for background pg work
   OSDMapMapping mapping;                          ///< pg <-> osd mappings
   unique_ptr<ParallelPGMapper::Job> mapping_job;  ///< background mapping job
+  /// incrementals applied since mapping's epoch, for an incremental remap
+  std::list<OSDMap::Incremental> mapping_incs;
   void start_mapping();
 
   void update_logger();
@@ -401,6 +405,8 @@ private:
   bool preprocess_query(MonOpRequestRef op) override;  // true if processed.
   bool prepare_update(MonOpRequestRef op) override;
   bool should_propose(double &delay) override;
+  double get_own_delay(utime_t now) override;
+  void note_state_change();
 
   version_t get_trim_to() const override;
 
@@ -417,8 +423,10 @@ private:
 public:
   // @param req an optional op request, if the osdmaps are replies to it. so
   //            @c Monitor::send_reply() can mark_event with it.
+  // @param range whether the peer takes range incrementals
   void send_incremental(epoch_t first, MonSession *session, bool onetime,
-			MonOpRequestRef req = MonOpRequestRef());
+			MonOpRequestRef req = MonOpRequestRef(),
+			bool range = false);
 
 private:
   void print_utilization(ostream &out, Formatter *f, bool tree) const;
@@ -744,6 +752,10 @@ public:
   int get_version_full(version_t ver, bufferlist& bl) override;
   int get_inc(version_t ver, OSDMap::Incremental& inc);
   int get_full_from_pinned_map(version_t ver, bufferlist& bl);
+  /// get the OSDMap::RangeIncremental from base to ver, cached in
+  /// inc_osd_cache
+  int get_range_incremental(version_t base, version_t ver, uint64_t features,
+			    bufferlist& bl);
 
   epoch_t blacklist(const entity_addrvec_t& av, utime_t until);
   epoch_t blacklist(entity_addr_t a, utime_t until);
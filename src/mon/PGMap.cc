@@ -1013,6 +1013,12 @@ int64_t PGMap::get_rule_avail(const OSDMap& osdmap, int ruleno) const
   if (r < 0) {
     return r;
   }
+  return _get_rule_avail(osdmap, wm);
+}
+
+int64_t PGMap::_get_rule_avail(const OSDMap& osdmap,
+			       const map<int,float>& wm) const
+{
   if (wm.empty()) {
     return 0;
   }
@@ -1156,8 +1162,10 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
     auto pg_stat_iter = pg_stat.find(update_pg);
     pool_stat_t &pool_sum_ref = pg_pool_sum[update_pool];
     if (pg_stat_iter == pg_stat.end()) {
+      note_pg_purged_snaps(update_pg, nullptr, &update_stat);
       pg_stat.insert(make_pair(update_pg, update_stat));
     } else {
+      note_pg_purged_snaps(update_pg, &pg_stat_iter->second, &update_stat);
       stat_pg_sub(update_pg, pg_stat_iter->second);
       pool_sum_ref.sub(pg_stat_iter->second);
       pg_stat_iter->second = update_stat;
@@ -1208,6 +1216,7 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
     auto s = pg_stat.find(removed_pg);
     bool pool_erased = false;
     if (s != pg_stat.end()) {
+      note_pg_purged_snaps(removed_pg, &s->second, nullptr);
       pool_erased = stat_pg_sub(removed_pg, s->second);
       pg_stat.erase(s);
       if (pool_erased) {
@@ -1279,6 +1288,8 @@ void PGMap::calc_stats()
   pg_sum = pool_stat_t();
   osd_sum = osd_stat_t();
   osd_sum_by_class.clear();
+  num_osd_by_class.clear();
+  purged_snaps_all_dirty = true;
   num_pg_by_state.clear();
   num_pg_by_pool_state.clear();
   num_pg_by_osd.clear();
@@ -1439,33 +1450,97 @@ bool PGMap::stat_pg_sub(const pg_t &pgid, const pg_stat_t &s,
 
 void PGMap::calc_purged_snaps()
 {
-  purged_snaps.clear();
+  _calc_purged_snaps(&purged_snaps);
+  purged_snaps_dirty.clear();
+  purged_snaps_all_dirty = false;
+}
+
+void PGMap::_calc_purged_snaps(
+  mempool::pgmap::map<int64_t,interval_set<snapid_t>> *snaps) const
+{
+  snaps->clear();
   set<int64_t> unknown;
   for (auto& i : pg_stat) {
     if (i.second.state == 0) {
       unknown.insert(i.first.pool());
-      purged_snaps.erase(i.first.pool());
+      snaps->erase(i.first.pool());
       continue;
     } else if (unknown.count(i.first.pool())) {
       continue;
     }
-    auto j = purged_snaps.find(i.first.pool());
-    if (j == purged_snaps.end()) {
+    auto j = snaps->find(i.first.pool());
+    if (j == snaps->end()) {
       // base case
-      purged_snaps[i.first.pool()] = i.second.purged_snaps;
+      (*snaps)[i.first.pool()] = i.second.purged_snaps;
     } else {
       j->second.intersection_of(i.second.purged_snaps);
     }
   }
 }
 
+bool PGMap::_calc_pool_purged_snaps(const OSDMap& osdmap, int64_t pool)
+{
+  // look the pgs up by id rather than scanning all pg stats; this misses
+  // pgs beyond pg_num (e.g., in the middle of a merge), which the count
+  // tells us about
+  purged_snaps.erase(pool);
+  auto n = num_pg_by_pool.find(pool);
+  int64_t expected = n == num_pg_by_pool.end() ? 0 : n->second;
+  const pg_pool_t *pi = osdmap.get_pg_pool(pool);
+  if (!pi) {
+    return expected == 0;
+  }
+  interval_set<snapid_t> snaps;
+  int64_t found = 0;
+  for (unsigned ps = 0; ps < pi->get_pg_num() && found < expected; ++ps) {
+    auto i = pg_stat.find(pg_t(ps, pool));
+    if (i == pg_stat.end()) {
+      continue;
+    }
+    if (i->second.state == 0) {
+      return true;
+    }
+    if (found++ == 0) {
+      snaps = i->second.purged_snaps;
+    } else {
+      snaps.intersection_of(i->second.purged_snaps);
+    }
+  }
+  if (found != expected) {
+    return false;
+  }
+  if (found > 0) {
+    purged_snaps[pool] = std::move(snaps);
+  }
+  return true;
+}
+
 void PGMap::calc_osd_sum_by_class(const OSDMap& osdmap)
 {
-  osd_sum_by_class.clear();
+  // remember the class of every osd, including those we have no stats
+  // for yet, so that stat_osd_add() can keep the sums up to date
+  osd_class.clear();
+  num_osd_by_class.clear();
+  for (int osd = 0; osd < osdmap.get_max_osd(); ++osd) {
+    const char *class_name = osdmap.crush->get_item_class(osd);
+    if (class_name) {
+      osd_class[osd] = class_name;
+      if (osd_stat.count(osd))
+	++num_osd_by_class[class_name];
+    }
+  }
+  _calc_osd_sum_by_class(osdmap, &osd_sum_by_class);
+}
+
+void PGMap::_calc_osd_sum_by_class(
+  const OSDMap& osdmap,
+  mempool::pgmap::map<std::string,osd_stat_t> *sums) const
+{
+  sums->clear();
   for (auto& i : osd_stat) {
     const char *class_name = osdmap.crush->get_item_class(i.first);
     if (class_name) {
-      osd_sum_by_class[class_name].add(i.second);
+      (*sums)[class_name].add(i.second);
     }
   }
 }
@@ -1474,6 +1549,13 @@ void PGMap::stat_osd_add(int osd, const osd_stat_t &s)
 {
   num_osd++;
   osd_sum.add(s);
+  if (digest_osdmap_epoch) {
+    auto c = osd_class.find(osd);
+    if (c != osd_class.end()) {
+      osd_sum_by_class[c->second].add(s);
+      ++num_osd_by_class[c->second];
+    }
+  }
   if (osd >= (int)osd_last_seq.size()) {
     osd_last_seq.resize(osd + 1);
   }
@@ -1484,16 +1566,110 @@ void PGMap::stat_osd_sub(int osd, const osd_stat_t &s)
 {
   num_osd--;
   osd_sum.sub(s);
+  if (digest_osdmap_epoch) {
+    auto c = osd_class.find(osd);
+    if (c != osd_class.end()) {
+      if (--num_osd_by_class[c->second] == 0) {
+	num_osd_by_class.erase(c->second);
+	osd_sum_by_class.erase(c->second);
+      } else {
+	osd_sum_by_class[c->second].sub(s);
+      }
+    }
+  }
   ceph_assert(osd < (int)osd_last_seq.size());
   osd_last_seq[osd] = 0;
 }
 
+void PGMap::update_digest(const OSDMap& osdmap)
+{
+  if (osdmap.get_epoch() != digest_osdmap_epoch) {
+    // device classes or rules may have changed
+    calc_osd_sum_by_class(osdmap);
+    rule_osd_weights.clear();
+    digest_osdmap_epoch = osdmap.get_epoch();
+  }
+
+  // osd fullness changes with every report, the osds of a rule do not
+  avail_space_by_rule.clear();
+  for (auto& p : osdmap.get_pools()) {
+    int64_t pool_id = p.first;
+    if ((pool_id < 0) || (pg_pool_sum.count(pool_id) == 0))
+      continue;
+    int ruleno = osdmap.crush->find_rule(p.second.get_crush_rule(),
+					 p.second.get_type(),
+					 p.second.get_size());
+    if (avail_space_by_rule.count(ruleno))
+      continue;
+    auto w = rule_osd_weights.find(ruleno);
+    if (w == rule_osd_weights.end()) {
+      map<int,float> wm;
+      int r = osdmap.crush->get_rule_weight_osd_map(ruleno, &wm);
+      if (r < 0) {
+	avail_space_by_rule[ruleno] = r;
+	continue;
+      }
+      w = rule_osd_weights.emplace(ruleno, std::move(wm)).first;
+    }
+    avail_space_by_rule[ruleno] = _get_rule_avail(osdmap, w->second);
+  }
+
+  if (purged_snaps_all_dirty) {
+    calc_purged_snaps();
+  } else if (!purged_snaps_dirty.empty()) {
+    for (auto pool : purged_snaps_dirty) {
+      if (!_calc_pool_purged_snaps(osdmap, pool)) {
+	calc_purged_snaps();
+	break;
+      }
+    }
+    purged_snaps_dirty.clear();
+  }
+}
+
+bool PGMap::check_digest(const OSDMap& osdmap, std::ostream *ss) const
+{
+  bool ok = true;
+  std::map<int,int64_t> avail;
+  get_rules_avail(osdmap, &avail);
+  if (avail != avail_space_by_rule) {
+    if (ss)
+      *ss << "avail_space_by_rule " << avail_space_by_rule
+	  << " != " << avail << "; ";
+    ok = false;
+  }
+  mempool::pgmap::map<std::string,osd_stat_t> by_class;
+  _calc_osd_sum_by_class(osdmap, &by_class);
+  if (by_class != osd_sum_by_class) {
+    if (ss) {
+      *ss << "osd_sum_by_class differs for";
+      for (auto& i : by_class) {
+	auto j = osd_sum_by_class.find(i.first);
+	if (j == osd_sum_by_class.end() || j->second != i.second)
+	  *ss << " " << i.first;
+      }
+      for (auto& i : osd_sum_by_class) {
+	if (!by_class.count(i.first))
+	  *ss << " " << i.first;
+      }
+      *ss << "; ";
+    }
+    ok = false;
+  }
+  mempool::pgmap::map<int64_t,interval_set<snapid_t>> snaps;
+  _calc_purged_snaps(&snaps);
+  if (snaps != purged_snaps) {
+    if (ss)
+      *ss << "purged_snaps " << purged_snaps << " != " << snaps << "; ";
+    ok = false;
+  }
+  return ok;
+}
+
 void PGMap::encode_digest(const OSDMap& osdmap,
 			  bufferlist& bl, uint64_t features)
 {
-  get_rules_avail(osdmap, &avail_space_by_rule);
-  calc_osd_sum_by_class(osdmap);
-  calc_purged_snaps();
+  update_digest(osdmap);
   PGMapDigest::encode(bl, features);
 }
 
@@ -348,6 +348,34 @@ public:
                              const int64_t pool,
                              const pool_stat_t& old_pool_sum);
 
+  // digest caches (soft state), maintained by update_digest()
+  epoch_t digest_osdmap_epoch = 0;  ///< osdmap the caches are valid for
+  mempool::pgmap::unordered_map<int32_t,std::string> osd_class;
+  mempool::pgmap::map<std::string,int32_t> num_osd_by_class;
+  std::map<int,std::map<int,float>> rule_osd_weights;
+  /// pools whose purged_snaps are out of date
+  mempool::pgmap::set<int64_t> purged_snaps_dirty;
+  bool purged_snaps_all_dirty = true;
+
+  void note_pg_purged_snaps(const pg_t& pgid, const pg_stat_t *old_stat,
+			    const pg_stat_t *new_stat) {
+    if (purged_snaps_all_dirty)
+      return;
+    if (!old_stat || !new_stat ||
+	(old_stat->state == 0) != (new_stat->state == 0) ||
+	!(old_stat->purged_snaps == new_stat->purged_snaps)) {
+      purged_snaps_dirty.insert(pgid.pool());
+    }
+  }
+  void _calc_osd_sum_by_class(
+    const OSDMap& osdmap,
+    mempool::pgmap::map<std::string,osd_stat_t> *sums) const;
+  void _calc_purged_snaps(
+    mempool::pgmap::map<int64_t,interval_set<snapid_t>> *snaps) const;
+  bool _calc_pool_purged_snaps(const OSDMap& osdmap, int64_t pool);
+  int64_t _get_rule_avail(const OSDMap& osdmap,
+			  const std::map<int,float>& wm) const;
+
  public:
 
   mempool::pgmap::set<pg_t> creating_pgs;
@@ -432,6 +460,27 @@ public:
   void encode(ceph::buffer::list &bl, uint64_t features=-1) const;
   void decode(ceph::buffer::list::const_iterator &bl);
 
+  /**
+   * bring the digest fields up to date
+   *
+   * Pool and osd sums are kept up to date as stats are applied.  Sums by
+   * device class, rule availability and purged snaps are updated here,
+   * incrementally as long as the osdmap epoch stays the same.
+   */
+  void update_digest(const OSDMap& osdmap);
+  /**
+   * compare the digest fields with a full recalculation
+   *
+   * @param ss where to describe the differences, or nullptr
+   * @return true if they match
+   */
+  bool check_digest(const OSDMap& osdmap, std::ostream *ss) const;
+  /// have the next update_digest() recalculate everything
+  void invalidate_digest() {
+    digest_osdmap_epoch = 0;
+    purged_snaps_all_dirty = true;
+  }
+
   /// encode subset of our data to a PGMapDigest
   void encode_digest(const OSDMap& osdmap,
 		     ceph::buffer::list& bl, uint64_t features);
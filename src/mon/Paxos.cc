@@ -15,6 +15,7 @@
 #include <sstream>
 #include "Paxos.h"
 #include "Monitor.h"
+#include "PaxosService.h"
 #include "messages/MMonPaxos.h"
 
 #include "mon/mon_types.h"
@@ -124,6 +125,11 @@ void Paxos::init_logger()
   pcb.add_u64_avg(l_paxos_share_state_bytes, "share_state_bytes", "Data in shared state", NULL, 0, unit_t(UNIT_BYTES));
   pcb.add_u64_counter(l_paxos_new_pn, "new_pn", "New proposal number queries");
   pcb.add_time_avg(l_paxos_new_pn_latency, "new_pn_latency", "New proposal number getting latency");
+  pcb.add_u64_counter(l_paxos_propose, "propose", "Rounds started by the leader");
+  pcb.add_u64_avg(l_paxos_propose_values, "propose_values", "Proposals sharing a round");
+  pcb.add_u64_counter(l_paxos_propose_piggyback, "propose_piggyback", "Service proposals that joined a round ahead of their timer");
+  pcb.add_time_avg(l_paxos_round_latency, "round_latency", "Latency from starting a round to committing it");
+  pcb.add_u64_counter(l_paxos_lease_read, "lease_read", "Read-only requests answered after the lease ran out");
   logger = pcb.create_perf_counters();
   g_ceph_context->get_perfcounters_collection()->add(logger);
 }
@@ -1061,6 +1067,8 @@ void Paxos::commit_proposal()
   ceph_assert(mon->is_leader());
   ceph_assert(is_refresh());
 
+  logger->tinc(l_paxos_round_latency,
+	       to_timespan(ceph::coarse_mono_clock::now() - propose_start_stamp));
   finish_contexts(g_ceph_context, committing_finishers);
 }
 
@@ -1490,6 +1498,28 @@ bool Paxos::is_readable(version_t v)
   return ret;
 }
 
+bool Paxos::is_lease_readable(version_t v)
+{
+  double max_staleness =
+    g_conf().get_val<double>("mon_lease_read_max_staleness");
+  if (max_staleness <= 0 || v > last_committed)
+    return false;
+  auto now = ceph::real_clock::now();
+  bool ret =
+    mon->is_peon() &&
+    (is_active() || is_updating() || is_writing()) &&
+    last_committed > 0 &&
+    now < lease_expire + ceph::make_timespan(max_staleness);
+  dout(5) << __func__ << " = " << (int)ret
+	  << " - now=" << now
+	  << " lease_expire=" << lease_expire
+	  << " has v" << v << " lc " << last_committed
+	  << dendl;
+  if (ret)
+    logger->inc(l_paxos_lease_read);
+  return ret;
+}
+
 bool Paxos::read(version_t v, bufferlist &bl)
 {
   if (!get_store()->get(get_name(), v, bl))
@@ -1528,6 +1558,19 @@ void Paxos::propose_pending()
 
   cancel_events();
 
+  if (g_conf().get_val<bool>("paxos_batch_services")) {
+    // services that are only holding back a change for their proposal
+    // timer join this round rather than starting one of their own
+    bool was_plugged = plugged;
+    plugged = true;
+    for (auto& svc : mon->paxos_service) {
+      if (svc->piggyback_pending()) {
+	logger->inc(l_paxos_propose_piggyback);
+      }
+    }
+    plugged = was_plugged;
+  }
+
   bufferlist bl;
   pending_proposal->encode(bl);
 
@@ -1541,6 +1584,9 @@ void Paxos::propose_pending()
 
   pending_proposal.reset();
 
+  logger->inc(l_paxos_propose);
+  logger->inc(l_paxos_propose_values, pending_finishers.size());
+  propose_start_stamp = ceph::coarse_mono_clock::now();
   committing_finishers.swap(pending_finishers);
   state = STATE_UPDATING;
   begin(bl);
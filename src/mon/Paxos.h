@@ -156,6 +156,11 @@ enum {
   l_paxos_share_state_bytes,
   l_paxos_new_pn,
   l_paxos_new_pn_latency,
+  l_paxos_propose,
+  l_paxos_propose_values,
+  l_paxos_propose_piggyback,
+  l_paxos_round_latency,
+  l_paxos_lease_read,
   l_paxos_last,
 };
 
@@ -873,6 +878,8 @@ private:
 
 
   utime_t commit_start_stamp;
+  /// when the leader started the round in flight
+  ceph::coarse_mono_time propose_start_stamp;
   friend struct C_Committed;
 
   /**
@@ -1253,6 +1260,18 @@ public:
    * @return 'true' if the version is readable; 'false' otherwise.
    */
   bool is_readable(version_t seen=0);
+  /**
+   * Check if a given version may be read past the end of our lease.
+   *
+   * A peon whose lease ran out less than mon_lease_read_max_staleness
+   * seconds ago may still answer read-only requests from its store:
+   * no value can have been committed without it before the lease ran
+   * out, so what it returns is at most about that old.
+   *
+   * @param seen The version we want to check if it is readable.
+   * @return 'true' if the version is readable; 'false' otherwise.
+   */
+  bool is_lease_readable(version_t seen=0);
   /**
    * Read version @e v and store its value in @e bl
    *
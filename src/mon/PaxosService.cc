@@ -65,9 +65,15 @@ bool PaxosService::dispatch(MonOpRequestRef op)
 
   // make sure our map is readable and up to date
   if (!is_readable(m->version)) {
-    dout(10) << " waiting for paxos -> readable (v" << m->version << ")" << dendl;
-    wait_for_readable(op, new C_RetryMessage(this, op), m->version);
-    return true;
+    if (op->is_lease_read() && is_lease_readable(m->version)) {
+      dout(10) << " lease expired, answering read from v"
+	       << get_last_committed() << dendl;
+      op->mark_event(service_name + ":lease_read");
+    } else {
+      dout(10) << " waiting for paxos -> readable (v" << m->version << ")" << dendl;
+      wait_for_readable(op, new C_RetryMessage(this, op), m->version);
+      return true;
+    }
   }
 
   // preprocess
@@ -247,6 +253,28 @@ void PaxosService::propose_pending()
   paxos->trigger_propose();
 }
 
+bool PaxosService::piggyback_pending()
+{
+  if (!proposal_timer || !have_pending || !is_active() ||
+      !mon->is_leader()) {
+    return false;
+  }
+  // the generic damping is moot with a round starting anyway, but a
+  // service may be holding its value back for reasons of its own
+  double delay = 0.0;
+  if (!should_propose(delay)) {
+    return false;
+  }
+  double own_delay = get_own_delay(ceph_clock_now());
+  if (own_delay > 0) {
+    dout(10) << __func__ << " still holding for " << own_delay << "s" << dendl;
+    return false;
+  }
+  dout(10) << __func__ << dendl;
+  propose_pending();
+  return true;
+}
+
 bool PaxosService::should_stash_full()
 {
   version_t latest_full = get_version_latest_full();
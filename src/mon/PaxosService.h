@@ -235,6 +235,17 @@ public:
    */
   void propose_pending();
 
+  /**
+   * Propose our pending value now if we were only waiting for the
+   * proposal timer to do so, letting it ride along with a Paxos round
+   * that is about to start anyway.  We keep waiting while
+   * get_own_delay() is not over.
+   *
+   * @pre Paxos is plugged
+   * @returns true if our value was added to the pending proposal
+   */
+  bool piggyback_pending();
+
   /**
    * Let others request us to propose.
    *
@@ -379,6 +390,19 @@ public:
    */
   virtual bool should_propose(double &delay);
 
+  /**
+   * How much longer we want to hold our pending value for reasons of our
+   * own, on top of the damping of the generic should_propose() policy.
+   * Unlike the damping, this still applies when a Paxos round is about
+   * to start anyway.
+   *
+   * @param now the current time
+   * @returns the time left to wait; 0 or less if none
+   */
+  virtual double get_own_delay(utime_t now) {
+    return 0.0;
+  }
+
   /**
    * force an immediate propose.
    *
@@ -547,6 +571,19 @@ public:
     return is_active() && have_pending;
   }
 
+  /**
+   * Check if a read-only request may be answered although we are not
+   * readable, because our lease ran out only a short while ago.
+   *
+   * @see Paxos::is_lease_readable
+   */
+  bool is_lease_readable(version_t ver = 0) const {
+    if (ver > get_last_committed() ||
+	get_last_committed() == 0)
+      return false;
+    return paxos->is_lease_readable(0);
+  }
+
   /**
    * Wait for a proposal to finish.
    *
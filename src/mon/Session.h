@@ -39,9 +39,11 @@ struct Subscription {
   version_t next;
   bool onetime;
   bool incremental_onetime;  // has CEPH_FEATURE_INCSUBOSDMAP
+  bool range_incremental;    // CEPH_SUBSCRIBE_RANGE_INC
   
   Subscription(MonSession *s, const std::string& t) : session(s), type(t), type_item(this),
-						 next(0), onetime(false), incremental_onetime(false) {}
+						 next(0), onetime(false), incremental_onetime(false),
+						 range_incremental(false) {}
 };
 
 struct MonSession : public RefCountedObject {
@@ -222,7 +224,8 @@ struct MonSessionMap {
     return s;
   }
 
-  void add_update_sub(MonSession *s, const std::string& what, version_t start, bool onetime, bool incremental_onetime) {
+  void add_update_sub(MonSession *s, const std::string& what, version_t start, bool onetime, bool incremental_onetime,
+		      bool range_incremental = false) {
     Subscription *sub = 0;
     if (s->sub_map.count(what)) {
       sub = s->sub_map[what];
@@ -237,6 +240,7 @@ struct MonSessionMap {
     sub->next = start;
     sub->onetime = onetime;
     sub->incremental_onetime = onetime && incremental_onetime;
+    sub->range_incremental = range_incremental;
   }
 
   void remove_sub(Subscription *sub) {
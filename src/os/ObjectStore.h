@@ -111,6 +111,18 @@ public:
    */
   virtual const PerfCounters* get_perf_counters() const = 0;
 
+  /**
+   * Fetch the running totals behind the commit latency of
+   * get_cur_stats(): the number of commits and the time they took, in
+   * ns.  Unlike get_cur_stats() this does not move its window, so that
+   * other users can keep their own.
+   *
+   * @returns {0, 0} if not tracked
+   */
+  virtual std::pair<uint64_t, uint64_t> get_commit_latency_totals() const {
+    return {0, 0};
+  }
+
   /**
    * a collection also orders transactions
    *
@@ -468,6 +480,37 @@ public:
      ceph::buffer::list& bl,
      uint32_t op_flags = 0) = 0;
 
+  /**
+   * read_crc32c -- read a byte range of data from an object and
+   * accumulate its crc32c
+   *
+   * Equivalent to read() followed by bl.crc32c(*crc), but a store that
+   * keeps its own crc32c checksums may verify the data against them
+   * and derive the result from the stored values instead of hashing
+   * the data a second time.
+   *
+   * @param cid collection for object
+   * @param oid oid of object
+   * @param offset location offset of first byte to be read
+   * @param len number of bytes to be read
+   * @param crc in: initial crc value, out: crc32c over the bytes read
+   * @param op_flags is CEPH_OSD_OP_FLAG_*
+   * @returns number of bytes read on success, or negative error code on failure.
+   */
+   virtual int read_crc32c(
+     CollectionHandle &c,
+     const ghobject_t& oid,
+     uint64_t offset,
+     size_t len,
+     uint32_t *crc,
+     uint32_t op_flags = 0) {
+     ceph::buffer::list bl;
+     int r = read(c, oid, offset, len, bl, op_flags);
+     if (r > 0)
+       *crc = bl.crc32c(*crc);
+     return r;
+   }
+
   /**
    * fiemap -- get extent std::map of data of an object
    *
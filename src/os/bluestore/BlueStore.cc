@@ -9351,6 +9351,139 @@ int BlueStore::read(
   return r;
 }
 
+int BlueStore::read_crc32c(
+  CollectionHandle &c_,
+  const ghobject_t& oid,
+  uint64_t offset,
+  size_t length,
+  uint32_t *crc,
+  uint32_t op_flags)
+{
+  Collection *c = static_cast<Collection *>(c_.get());
+  dout(15) << __func__ << " " << c->get_cid() << " " << oid
+	   << " 0x" << std::hex << offset << "~" << length << std::dec
+	   << dendl;
+  if (!c->exists)
+    return -ENOENT;
+
+  int r;
+  {
+    std::shared_lock l(c->lock);
+    OnodeRef o = c->get_onode(oid, false);
+    if (!o || !o->exists) {
+      return -ENOENT;
+    }
+    if (offset == length && offset == 0)
+      length = o->onode.size;
+
+    // the read verifies the data against the blob checksums, after
+    // which the stored values describe it as well as the data does
+    bufferlist bl;
+    r = _do_read(c, o, offset, length, bl, op_flags);
+    if (r == -EIO) {
+      logger->inc(l_bluestore_read_eio);
+    }
+    if (r > 0) {
+      *crc = _crc32c_from_csum(o, offset, bl, *crc);
+    }
+  }
+  if (r >= 0 && _debug_data_eio(oid)) {
+    r = -EIO;
+    derr << __func__ << " " << c->cid << " " << oid << " INJECT EIO" << dendl;
+  }
+  dout(10) << __func__ << " " << c->get_cid() << " " << oid
+	   << " 0x" << std::hex << offset << "~" << length
+	   << " crc 0x" << *crc << std::dec
+	   << " = " << r << dendl;
+  return r;
+}
+
+/*
+ * crc32c(x, zeros(len)) is linear in x, so shifting many crcs by the
+ * same length only takes four table lookups each once the images of
+ * the 32 basis vectors are known.
+ */
+struct crc32c_zeros_table_t {
+  uint32_t t[4][256];
+  explicit crc32c_zeros_table_t(unsigned len) {
+    uint32_t basis[32];
+    for (unsigned i = 0; i < 32; ++i) {
+      basis[i] = ceph_crc32c(1u << i, nullptr, len);
+    }
+    for (unsigned k = 0; k < 4; ++k) {
+      for (unsigned b = 0; b < 256; ++b) {
+	uint32_t v = 0;
+	for (unsigned bit = 0; bit < 8; ++bit) {
+	  if (b & (1u << bit)) {
+	    v ^= basis[k * 8 + bit];
+	  }
+	}
+	t[k][b] = v;
+      }
+    }
+  }
+  uint32_t operator()(uint32_t crc) const {
+    return t[0][crc & 0xff] ^ t[1][(crc >> 8) & 0xff] ^
+      t[2][(crc >> 16) & 0xff] ^ t[3][crc >> 24];
+  }
+};
+
+uint32_t BlueStore::_crc32c_from_csum(
+  OnodeRef& o,
+  uint64_t offset,
+  const bufferlist& bl,
+  uint32_t crc)
+{
+  if (cct->_conf->bluestore_ignore_data_csum) {
+    // nothing was verified, the stored values are not to be trusted
+    return bl.crc32c(crc);
+  }
+  const uint64_t end = offset + bl.length();
+  uint64_t pos = offset;
+  uint64_t from_csum = 0;
+  std::optional<crc32c_zeros_table_t> shift;
+  unsigned shift_len = 0;
+  auto lp = o->extent_map.seek_lextent(offset);
+  while (pos < end) {
+    if (lp == o->extent_map.extent_map.end() || lp->logical_offset >= end) {
+      // trailing hole reads back as zeros
+      crc = ceph_crc32c(crc, nullptr, end - pos);
+      break;
+    }
+    if (lp->logical_offset > pos) {
+      crc = ceph_crc32c(crc, nullptr, lp->logical_offset - pos);
+      pos = lp->logical_offset;
+    }
+    uint64_t x_end = std::min<uint64_t>(end, lp->logical_end());
+    uint64_t l = x_end - pos;
+    uint64_t b_off = lp->blob_offset + (pos - lp->logical_offset);
+    const bluestore_blob_t& blob = lp->blob->get_blob();
+    uint64_t chunk = blob.get_csum_chunk_size();
+    if (blob.csum_type == Checksummer::CSUM_CRC32C &&
+	!blob.is_compressed() &&
+	b_off % chunk == 0 && l % chunk == 0) {
+      if (!shift || shift_len != chunk) {
+	shift.emplace(chunk);
+	shift_len = chunk;
+      }
+      // each stored item is crc32c(-1, chunk); rebase it onto crc
+      for (uint64_t i = b_off / chunk; i < (b_off + l) / chunk; ++i) {
+	crc = (uint32_t)blob.get_csum_item(i) ^ (*shift)(crc ^ -1);
+      }
+      from_csum += l;
+    } else {
+      bufferlist t;
+      t.substr_of(bl, pos - offset, l);
+      crc = t.crc32c(crc);
+    }
+    pos = x_end;
+    ++lp;
+  }
+  dout(20) << __func__ << " 0x" << std::hex << offset << "~" << bl.length()
+	   << " 0x" << from_csum << " from stored csums" << std::dec << dendl;
+  return crc;
+}
+
 void BlueStore::_read_cache(
   OnodeRef o,
   uint64_t offset,
@@ -2565,7 +2565,20 @@ public:
     bufferlist& bl,
     uint32_t op_flags = 0) override;
 
+  int read_crc32c(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    uint32_t *crc,
+    uint32_t op_flags = 0) override;
+
 private:
+  uint32_t _crc32c_from_csum(
+    OnodeRef& o,
+    uint64_t offset,
+    const bufferlist& bl,
+    uint32_t crc);
 
   // --------------------------------------------------------
   // intermediate data structures used while reading
@@ -2778,6 +2791,9 @@ public:
   const PerfCounters* get_perf_counters() const override {
     return logger;
   }
+  std::pair<uint64_t, uint64_t> get_commit_latency_totals() const override {
+    return logger->get_tavg_ns(l_bluestore_commit_lat);
+  }
 
   int queue_transactions(
     CollectionHandle& ch,
@@ -142,6 +142,9 @@ public:
   const PerfCounters* get_perf_counters() const override {
     return logger;
   }
+  std::pair<uint64_t, uint64_t> get_commit_latency_totals() const override {
+    return logger->get_tavg_ns(l_filestore_journal_latency);
+  }
 
 private:
   string internal_name;         ///< internal name, used to name the perfcounter instance
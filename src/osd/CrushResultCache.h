@@ -0,0 +1,183 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "include/mempool.h"
+#include "osd_types.h"
+
+/**
+ * CrushResultCache
+ *
+ * Memo of raw CRUSH output (before nonexistent osds are dropped) keyed by
+ * (pool, placement seed).  The placement seed of a pg only depends on
+ * ps mod pgp_num, so a pool gets a flat table of pgp_num rows, each
+ * holding the output length and up to size osds.  The table is
+ * allocated on first use.
+ *
+ * An OSDMap holds a const cache built for its pools.  The cache of the
+ * next epoch reuses the tables of the previous one as long as the
+ * inputs to CRUSH are unchanged: the crush map, osd weights and
+ * max_osd for the whole map, and the rule, type, size and pgp_num of
+ * each pool (see pool_table_t::matches).  Maps of a lineage thus share
+ * the tables, and a steady state lookup does not run CRUSH at all.
+ *
+ * Lookups take no lock.  A row is filled once: the first thread to
+ * claim it computes the mapping and publishes it with a release store
+ * of its header; a thread that finds the row being filled computes the
+ * mapping itself without storing it.
+ */
+class CrushResultCache {
+public:
+  struct stats_t {
+    std::atomic<uint64_t> hit = {0};
+    std::atomic<uint64_t> miss = {0};
+  };
+
+  class pool_table_t {
+    // row header: 0 empty, -1 being filled, else 1 + number of osds
+    static constexpr int32_t EMPTY = 0;
+    static constexpr int32_t BUSY = -1;
+    typedef mempool::osdmap::vector<std::atomic<int32_t>> rows_t;
+
+    const int crush_rule;
+    const int type;
+    const unsigned size;
+    const unsigned pgp_num;
+    const bool hashpspool;
+    std::atomic<rows_t*> rows = {nullptr};
+
+    std::atomic<int32_t> *get_row(unsigned row, bool create) {
+      rows_t *r = rows.load(std::memory_order_acquire);
+      if (!r) {
+	if (!create)
+	  return nullptr;
+	rows_t *n = new rows_t((size_t)pgp_num * (size + 1));
+	if (rows.compare_exchange_strong(r, n, std::memory_order_acq_rel)) {
+	  r = n;
+	} else {
+	  delete n;   // r now holds the winner
+	}
+      }
+      return &(*r)[(size_t)row * (size + 1)];
+    }
+
+  public:
+    explicit pool_table_t(const pg_pool_t& pool)
+      : crush_rule(pool.get_crush_rule()),
+	type(pool.get_type()),
+	size(pool.get_size()),
+	pgp_num(pool.get_pgp_num()),
+	hashpspool(pool.has_flag(pg_pool_t::FLAG_HASHPSPOOL)) {}
+    pool_table_t(const pool_table_t&) = delete;
+    pool_table_t& operator=(const pool_table_t&) = delete;
+    ~pool_table_t() {
+      delete rows.load();
+    }
+
+    /// true if the crush mapping of pool is the one cached here
+    bool matches(const pg_pool_t& pool) const {
+      return crush_rule == pool.get_crush_rule() &&
+	type == (int)pool.get_type() &&
+	size == pool.get_size() &&
+	pgp_num == pool.get_pgp_num() &&
+	hashpspool == pool.has_flag(pg_pool_t::FLAG_HASHPSPOOL);
+    }
+    size_t memory_usage() const {
+      rows_t *r = rows.load(std::memory_order_acquire);
+      return r ? r->size() * sizeof(int32_t) : 0;
+    }
+
+    bool lookup(unsigned row, std::vector<int> *osds) {
+      auto *p = get_row(row, false);
+      if (!p)
+	return false;
+      int32_t h = p[0].load(std::memory_order_acquire);
+      if (h <= EMPTY)
+	return false;
+      osds->resize(h - 1);
+      for (int32_t i = 1; i < h; ++i)
+	(*osds)[i - 1] = p[i].load(std::memory_order_relaxed);
+      return true;
+    }
+    /// claim an empty row; the caller must then publish() it
+    bool claim(unsigned row) {
+      int32_t expected = EMPTY;
+      return get_row(row, true)[0].compare_exchange_strong(
+	expected, BUSY, std::memory_order_acquire);
+    }
+    void publish(unsigned row, const std::vector<int>& osds) {
+      auto *p = get_row(row, false);
+      size_t n = std::min<size_t>(osds.size(), size);
+      for (size_t i = 0; i < n; ++i)
+	p[i + 1].store(osds[i], std::memory_order_relaxed);
+      p[0].store(n + 1, std::memory_order_release);
+    }
+  };
+
+  /**
+   * build a cache for pools
+   *
+   * @param prev cache of a map with the same crush map, osd weights and
+   *             max_osd whose still valid tables are shared, or nullptr
+   */
+  CrushResultCache(const mempool::osdmap::map<int64_t,pg_pool_t>& pools,
+		   const CrushResultCache *prev,
+		   std::shared_ptr<stats_t> stats)
+    : stats(stats ? std::move(stats) : std::make_shared<stats_t>()) {
+    for (auto& [id, pool] : pools) {
+      if (prev) {
+	auto p = prev->tables.find(id);
+	if (p != prev->tables.end() && p->second->matches(pool)) {
+	  tables.emplace(id, p->second);
+	  continue;
+	}
+      }
+      tables.emplace(id, std::make_shared<pool_table_t>(pool));
+    }
+  }
+
+  const std::shared_ptr<stats_t>& get_stats() const {
+    return stats;
+  }
+  size_t memory_usage() const {
+    size_t r = 0;
+    for (auto& t : tables)
+      r += t.second->memory_usage();
+    return r;
+  }
+
+  /**
+   * the table for the given pool, or nullptr if pool was changed
+   * behind the cache's back
+   */
+  pool_table_t *get_table(int64_t poolid, const pg_pool_t& pool) const {
+    auto p = tables.find(poolid);
+    if (p == tables.end() || !p->second->matches(pool))
+      return nullptr;
+    return p->second.get();
+  }
+  void count(bool hit) const {
+    (hit ? stats->hit : stats->miss).fetch_add(1, std::memory_order_relaxed);
+  }
+
+private:
+  std::map<int64_t, std::shared_ptr<pool_table_t>> tables;
+  std::shared_ptr<stats_t> stats;
+};
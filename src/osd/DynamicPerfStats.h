@@ -11,11 +11,100 @@
 #include "osd/OpRequest.h"
 
 class DynamicPerfStats {
+public:
+  /**
+   * The counters of one query, by key.
+   *
+   * With max_keys set, at most max_keys keys are tracked, using the
+   * space-saving algorithm: every key has a weight, the number of ops
+   * seen for it, and a key that does not fit takes the place of the
+   * lightest one, starting from its weight.  The heaviest keys are kept,
+   * with the counters of the ops seen since they got their place.
+   */
+  class QueryCounters {
+  public:
+    struct Entry {
+      PerformanceCounters counters;
+      uint64_t weight = 0;
+    };
+    typedef std::map<OSDPerfMetricKey, Entry> Entries;
+
+    QueryCounters() = default;
+    QueryCounters(QueryCounters&&) = default;
+    QueryCounters& operator=(QueryCounters&&) = default;
+    // by_weight points into entries
+    QueryCounters(const QueryCounters&) = delete;
+    QueryCounters& operator=(const QueryCounters&) = delete;
+
+    Entries &get_entries() {
+      return entries;
+    }
+    const Entries &get_entries() const {
+      return entries;
+    }
+
+    /// add weight to key, making room for it if needed
+    PerformanceCounters *get(const OSDPerfMetricKey &key, uint64_t weight,
+                             uint64_t max_keys) {
+      auto it = entries.find(key);
+      if (it != entries.end()) {
+        if (max_keys) {
+          by_weight.erase({it->second.weight, &it->first});
+        }
+        it->second.weight += weight;
+        if (max_keys) {
+          by_weight.emplace(it->second.weight, &it->first);
+        }
+        return &it->second.counters;
+      }
+
+      uint64_t base = 0;
+      if (max_keys && entries.size() >= max_keys) {
+        auto lightest = by_weight.begin();
+        base = lightest->first;
+        auto victim = entries.find(*lightest->second);
+        by_weight.erase(lightest);
+        entries.erase(victim);
+      }
+      it = entries.emplace(key, Entry()).first;
+      it->second.weight = base + weight;
+      if (max_keys) {
+        by_weight.emplace(it->second.weight, &it->first);
+      }
+      return &it->second.counters;
+    }
+
+    /// start or stop limiting the number of keys
+    void set_max_keys(uint64_t old_max_keys, uint64_t max_keys) {
+      if (!max_keys) {
+        by_weight.clear();
+        return;
+      }
+      if (!old_max_keys) {
+        for (auto &[key, entry] : entries) {
+          by_weight.emplace(entry.weight, &key);
+        }
+      }
+      while (entries.size() > max_keys) {
+        auto lightest = by_weight.begin();
+        auto victim = entries.find(*lightest->second);
+        by_weight.erase(lightest);
+        entries.erase(victim);
+      }
+    }
+
+  private:
+    Entries entries;
+    std::set<std::pair<uint64_t, const OSDPerfMetricKey*>> by_weight;
+  };
+
 public:
   DynamicPerfStats() {
   }
 
-  DynamicPerfStats(const std::list<OSDPerfMetricQuery> &queries) {
+  DynamicPerfStats(const std::list<OSDPerfMetricQuery> &queries,
+                   uint64_t max_keys = 0)
+    : max_keys(max_keys) {
     for (auto &query : queries) {
       data[query];
     }
@@ -24,9 +113,10 @@ public:
   void merge(const DynamicPerfStats &dps) {
     for (auto &query_it : dps.data) {
       auto &query = query_it.first;
-      for (auto &key_it : query_it.second) {
+      for (auto &key_it : query_it.second.get_entries()) {
         auto &key = key_it.first;
-        auto counter_it = key_it.second.begin();
+        auto &entry = key_it.second;
+        auto counter_it = entry.counters.begin();
         auto update_counter_fnc =
             [&counter_it](const PerformanceCounterDescriptor &d,
                           PerformanceCounter *c) {
@@ -35,19 +125,26 @@ public:
               counter_it++;
             };
 
-        ceph_assert(key_it.second.size() >= data[query][key].size());
-        query.update_counters(update_counter_fnc, &data[query][key]);
+        auto counters = data[query].get(key, entry.weight, max_keys);
+        ceph_assert(entry.counters.size() >= counters->size());
+        query.update_counters(update_counter_fnc, counters);
       }
     }
   }
 
-  void set_queries(const std::list<OSDPerfMetricQuery> &queries) {
-    std::map<OSDPerfMetricQuery,
-             std::map<OSDPerfMetricKey, PerformanceCounters>> new_data;
+  void set_queries(const std::list<OSDPerfMetricQuery> &queries,
+                   uint64_t new_max_keys) {
+    std::map<OSDPerfMetricQuery, QueryCounters> new_data;
     for (auto &query : queries) {
       std::swap(new_data[query], data[query]);
     }
     std::swap(data, new_data);
+    if (new_max_keys != max_keys) {
+      for (auto &it : data) {
+        it.second.set_max_keys(max_keys, new_max_keys);
+      }
+      max_keys = new_max_keys;
+    }
   }
 
   bool is_enabled() {
@@ -163,7 +260,8 @@ public:
       auto &query = it.first;
       OSDPerfMetricKey key;
       if (query.get_key(get_subkey_fnc, &key)) {
-        query.update_counters(update_counter_fnc, &it.second[key]);
+        query.update_counters(update_counter_fnc,
+                              it.second.get(key, 1, max_keys));
       }
     }
   }
@@ -178,7 +276,7 @@ public:
         continue;
       }
       auto &query_limits = limit_it->second;
-      auto &counters = it.second;
+      auto &counters = it.second.get_entries();
       auto &report = (*reports)[query];
 
       query.get_performance_counter_descriptors(
@@ -190,7 +288,7 @@ public:
       if (!is_limited(query_limits, counters.size())) {
         for (auto &it_counters : counters) {
           auto &bl = report.group_packed_performance_counters[it_counters.first];
-          query.pack_counters(it_counters.second, &bl);
+          query.pack_counters(it_counters.second.counters, &bl);
         }
         continue;
       }
@@ -213,21 +311,20 @@ public:
         // probability, and return [0, max_count) as the result.
 
         ceph_assert(limit.max_count < counters.size());
-        typedef std::map<OSDPerfMetricKey, PerformanceCounters>::iterator
-            Iterator;
+        typedef QueryCounters::Entries::iterator Iterator;
         std::vector<Iterator> counter_iterators;
         counter_iterators.reserve(limit.max_count);
 
         Iterator it_counters = counters.begin();
         uint64_t wsum = 0;
         for (size_t i = 0; i < limit.max_count; i++) {
-          wsum += it_counters->second[index].first;
+          wsum += it_counters->second.counters[index].first;
           counter_iterators.push_back(it_counters++);
         }
         for (; it_counters != counters.end(); it_counters++) {
-          wsum += it_counters->second[index].first;
+          wsum += it_counters->second.counters[index].first;
           if (ceph::util::generate_random_number(0, wsum) <=
-              it_counters->second[index].first) {
+              it_counters->second.counters[index].first) {
             auto i = ceph::util::generate_random_number(0, limit.max_count - 1);
             counter_iterators[i] = it_counters;
           }
@@ -237,7 +334,7 @@ public:
           auto &bl =
               report.group_packed_performance_counters[it_counters->first];
           if (bl.length() == 0) {
-            query.pack_counters(it_counters->second, &bl);
+            query.pack_counters(it_counters->second.counters, &bl);
           }
         }
       }
@@ -260,8 +357,8 @@ private:
     return true;
   }
 
-  std::map<OSDPerfMetricQuery,
-           std::map<OSDPerfMetricKey, PerformanceCounters>> data;
+  uint64_t max_keys = 0;
+  std::map<OSDPerfMetricQuery, QueryCounters> data;
 };
 
 #endif // DYNAMIC_PERF_STATS_H
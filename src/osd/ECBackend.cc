@@ -25,6 +25,7 @@
 #include "ECMsgTypes.h"
 
 #include "PrimaryLogPG.h"
+#include "ECReadCache.h"
 
 #define dout_context cct
 #define dout_subsys ceph_subsys_osd
@@ -406,9 +407,13 @@ void ECBackend::handle_recovery_push_reply(
   if (!recovery_ops.count(op.soid))
     return;
   RecoveryOp &rop = recovery_ops[op.soid];
-  ceph_assert(rop.waiting_on_pushes.count(from));
-  rop.waiting_on_pushes.erase(from);
-  continue_recovery_op(rop, m);
+  auto i = rop.waiting_on_pushes.find(from);
+  ceph_assert(i != rop.waiting_on_pushes.end());
+  rop.waiting_on_pushes.erase(i);
+  // with a pipelined recovery the read of the next chunk may still be
+  // in flight; its completion will pick the op up again
+  if (rop.state == RecoveryOp::WRITING)
+    continue_recovery_op(rop, m);
 }
 
 void ECBackend::handle_recovery_read_complete(
@@ -662,10 +667,10 @@ void ECBackend::continue_recovery_op(
 	    op.hoid);
       }
       op.returned_data.clear();
-      op.waiting_on_pushes = op.missing_on;
+      op.waiting_on_pushes.insert(op.missing_on.begin(), op.missing_on.end());
       op.recovery_progress = after_progress;
-      dout(10) << __func__ << ": READING return " << op << dendl;
-      return;
+      dout(10) << __func__ << ": READING continue " << op << dendl;
+      continue;
     }
     case RecoveryOp::WRITING: {
       if (op.waiting_on_pushes.empty()) {
@@ -698,7 +703,14 @@ void ECBackend::continue_recovery_op(
 	  dout(10) << __func__ << ": WRITING continue " << op << dendl;
 	  continue;
 	}
+      } else if (!op.recovery_progress.data_complete &&
+		 op.chunks_in_flight() < get_recovery_pipeline_depth()) {
+	// start reading the next chunk while the replicas apply this one
+	op.state = RecoveryOp::IDLE;
+	dout(10) << __func__ << ": WRITING pipeline " << op << dendl;
+	continue;
       }
+      dout(10) << __func__ << ": WRITING return " << op << dendl;
       return;
     }
     // should never be called once complete
@@ -1847,6 +1859,20 @@ void ECBackend::start_rmw(Op *op, PGTransactionUPtr &&t)
     },
     get_parent()->get_dpp());
 
+  ECReadCache *read_cache = get_parent()->get_ec_read_cache();
+  if (read_cache->enabled()) {
+    // hash_infos covers every object the transaction touches, including
+    // clone/rename sources
+    for (auto &&i : op->plan.hash_infos) {
+      read_cache->invalidate(i.first);
+    }
+    get_parent()->get_logger()->set(
+      l_osd_ec_read_cache_bytes, read_cache->get_bytes());
+  }
+  // reads already in flight must not populate the cache with data
+  // this write is about to change
+  ++read_cache_gen;
+
   dout(10) << __func__ << ": " << *op << dendl;
 
   waiting_state.push_back(*op);
@@ -2195,17 +2221,20 @@ void ECBackend::objects_read_async(
     list<pair<boost::tuple<uint64_t, uint64_t, uint32_t>,
 	      pair<bufferlist*, Context*> > > to_read;
     unique_ptr<Context> on_complete;
+    std::optional<uint64_t> fill_read_cache; ///< read_cache_gen at start
     cb(const cb&) = delete;
     cb(cb &&) = default;
     cb(ECBackend *ec,
        const hobject_t &hoid,
        const list<pair<boost::tuple<uint64_t, uint64_t, uint32_t>,
                   pair<bufferlist*, Context*> > > &to_read,
-       Context *on_complete)
+       Context *on_complete,
+       std::optional<uint64_t> fill_read_cache)
       : ec(ec),
 	hoid(hoid),
 	to_read(to_read),
-	on_complete(on_complete) {}
+	on_complete(on_complete),
+	fill_read_cache(fill_read_cache) {}
     void operator()(map<hobject_t,pair<int, extent_map> > &&results) {
       auto dpp = ec->get_parent()->get_dpp();
       ldpp_dout(dpp, 20) << "objects_read_async_cb: got: " << results
@@ -2214,6 +2243,14 @@ void ECBackend::objects_read_async(
 			 << dendl;
 
       auto &got = results[hoid];
+      if (fill_read_cache && *fill_read_cache == ec->read_cache_gen &&
+	  got.first >= 0) {
+	ECReadCache *read_cache = ec->get_parent()->get_ec_read_cache();
+	read_cache->insert(
+	  hoid, ec->get_parent()->get_interval_start_epoch(), got.second);
+	ec->get_parent()->get_logger()->set(
+	  l_osd_ec_read_cache_bytes, read_cache->get_bytes());
+      }
 
       int r = 0;
       for (auto &&read: to_read) {
@@ -2259,6 +2296,43 @@ void ECBackend::objects_read_async(
       to_read.clear();
     }
   };
+  ECReadCache *read_cache = get_parent()->get_ec_read_cache();
+  if (es.empty() || !read_cache->enabled()) {
+    objects_read_and_reconstruct(
+      reads,
+      fast_read,
+      make_gen_lambda_context<
+	map<hobject_t,pair<int, extent_map> > &&, cb>(
+	  cb(this,
+	     hoid,
+	     to_read,
+	     on_complete,
+	     std::nullopt)));
+    return;
+  }
+
+  extent_map cached;
+  if (read_cache->lookup(
+	hoid, get_parent()->get_interval_start_epoch(), es, &cached)) {
+    dout(20) << __func__ << ": " << hoid << " " << es
+	     << " served from read cache" << dendl;
+    get_parent()->get_logger()->inc(l_osd_ec_read_cache_hit);
+    // complete in order with any reads still in flight
+    in_progress_client_reads.emplace_back(
+      1,
+      make_gen_lambda_context<
+	map<hobject_t,pair<int, extent_map> > &&, cb>(
+	  cb(this,
+	     hoid,
+	     to_read,
+	     on_complete,
+	     std::nullopt)));
+    in_progress_client_reads.back().complete_object(
+      hoid, 0, std::move(cached));
+    kick_reads();
+    return;
+  }
+  get_parent()->get_logger()->inc(l_osd_ec_read_cache_miss);
   objects_read_and_reconstruct(
     reads,
     fast_read,
@@ -2267,7 +2341,8 @@ void ECBackend::objects_read_async(
 	cb(this,
 	   hoid,
 	   to_read,
-	   on_complete)));
+	   on_complete,
+	   read_cache_gen)));
 }
 
 struct CallClientContexts :
@@ -2485,21 +2560,35 @@ int ECBackend::be_deep_scrub(
   if (stride % sinfo.get_chunk_size())
     stride += sinfo.get_chunk_size() - (stride % sinfo.get_chunk_size());
 
+  uint32_t crc = pos.data_hash.digest();
   bufferlist bl;
-  r = store->read(
-    ch,
-    ghobject_t(
-      poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
-    pos.data_pos,
-    stride, bl,
-    fadvise_flags);
+  if (cct->_conf.get_val<bool>("osd_deep_scrub_store_crc")) {
+    r = store->read_crc32c(
+      ch,
+      ghobject_t(
+	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+      pos.data_pos,
+      stride, &crc,
+      fadvise_flags);
+  } else {
+    r = store->read(
+      ch,
+      ghobject_t(
+	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+      pos.data_pos,
+      stride, bl,
+      fadvise_flags);
+    if (r > 0) {
+      crc = bl.crc32c(crc);
+    }
+  }
   if (r < 0) {
     dout(20) << __func__ << "  " << poid << " got "
 	     << r << " on read, read_error" << dendl;
     o.read_error = true;
     return 0;
   }
-  if (bl.length() % sinfo.get_chunk_size()) {
+  if (r % sinfo.get_chunk_size()) {
     dout(20) << __func__ << "  " << poid << " got "
 	     << r << " on read, not chunk size " << sinfo.get_chunk_size() << " aligned"
 	     << dendl;
@@ -2507,7 +2596,7 @@ int ECBackend::be_deep_scrub(
     return 0;
   }
   if (r > 0) {
-    pos.data_hash << bl;
+    pos.data_hash = bufferhash(crc);
   }
   pos.data_pos += r;
   if (r == (int)stride) {
@@ -168,6 +168,8 @@ public:
     }
   };
   list<ClientAsyncReadStatus> in_progress_client_reads;
+  /// bumped whenever a write enters the pipeline, see objects_read_async
+  uint64_t read_cache_gen = 0;
   void objects_read_async(
     const hobject_t &hoid,
     const list<pair<boost::tuple<uint64_t, uint64_t, uint32_t>,
@@ -208,6 +210,11 @@ private:
 			sinfo.get_stripe_width());
   }
 
+  uint64_t get_recovery_pipeline_depth() const {
+    return std::max<uint64_t>(
+      1, cct->_conf.get_val<uint64_t>("osd_ec_recovery_pipeline_depth"));
+  }
+
   void get_want_to_read_shards(set<int> *want_to_read) const {
     const vector<int> &chunk_mapping = ec_impl->get_chunk_mapping();
     for (int i = 0; i < (int)ec_impl->get_data_chunk_count(); ++i) {
@@ -282,11 +289,20 @@ private:
     map<string, bufferlist> xattrs;
     ECUtil::HashInfoRef hinfo;
     ObjectContextRef obc;
-    set<pg_shard_t> waiting_on_pushes;
+    // one entry per shard per chunk pushed and not yet acked
+    multiset<pg_shard_t> waiting_on_pushes;
 
     // valid in state READING
     pair<uint64_t, uint64_t> extent_requested;
 
+    // number of chunks whose pushes are not yet acked by every shard
+    unsigned chunks_in_flight() const {
+      unsigned ret = 0;
+      for (auto &&i : missing_on)
+	ret = std::max<unsigned>(ret, waiting_on_pushes.count(i));
+      return ret;
+    }
+
     void dump(Formatter *f) const;
 
     RecoveryOp() : state(IDLE) {}
@@ -0,0 +1,116 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "ECReadCache.h"
+#include "include/mempool.h"
+
+ECReadCache::~ECReadCache()
+{
+  clear();
+}
+
+void ECReadCache::_remove(std::unordered_map<hobject_t, entry_t>::iterator i)
+{
+  lru.erase(lru_list_t::s_iterator_to(i->second));
+  ceph_assert(bytes >= i->second.bytes);
+  bytes -= i->second.bytes;
+  entries.erase(i);
+}
+
+void ECReadCache::_trim(uint64_t target)
+{
+  while (bytes > target && !lru.empty()) {
+    _remove(entries.find(lru.back().hoid));
+  }
+}
+
+void ECReadCache::set_max_bytes(uint64_t max)
+{
+  std::lock_guard l(lock);
+  max_bytes = max;
+  _trim(max_bytes);
+}
+
+bool ECReadCache::lookup(
+  const hobject_t &hoid,
+  epoch_t interval,
+  const extent_set &want,
+  extent_map *out)
+{
+  std::lock_guard l(lock);
+  auto i = entries.find(hoid);
+  if (i == entries.end())
+    return false;
+  if (i->second.interval != interval) {
+    _remove(i);
+    return false;
+  }
+  if (!want.subset_of(i->second.data.get_interval_set()))
+    return false;
+  for (auto &&extent : want) {
+    out->insert(i->second.data.intersect(extent.first, extent.second));
+  }
+  lru.erase(lru_list_t::s_iterator_to(i->second));
+  lru.push_front(i->second);
+  return true;
+}
+
+void ECReadCache::insert(
+  const hobject_t &hoid,
+  epoch_t interval,
+  const extent_map &data)
+{
+  std::lock_guard l(lock);
+  if (max_bytes == 0 || data.empty())
+    return;
+  auto [i, inserted] = entries.try_emplace(hoid);
+  entry_t &e = i->second;
+  if (inserted) {
+    e.hoid = hoid;
+  } else {
+    lru.erase(lru_list_t::s_iterator_to(e));
+    if (e.interval != interval) {
+      e.data.clear();
+    }
+  }
+  e.interval = interval;
+  for (auto &&extent : data) {
+    bufferlist bl = extent.get_val();
+    bl.reassign_to_mempool(mempool::mempool_osd);
+    e.data.insert(extent.get_off(), extent.get_len(), std::move(bl));
+  }
+  bytes -= e.bytes;
+  e.bytes = e.data.get_interval_set().size();
+  bytes += e.bytes;
+  lru.push_front(e);
+  if (e.bytes > max_bytes) {
+    _remove(i);
+    return;
+  }
+  _trim(max_bytes);
+}
+
+void ECReadCache::invalidate(const hobject_t &hoid)
+{
+  std::lock_guard l(lock);
+  auto i = entries.find(hoid);
+  if (i != entries.end())
+    _remove(i);
+}
+
+void ECReadCache::clear()
+{
+  std::lock_guard l(lock);
+  lru.clear();
+  entries.clear();
+  bytes = 0;
+}
@@ -0,0 +1,108 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef EC_READ_CACHE_H
+#define EC_READ_CACHE_H
+
+#include <unordered_map>
+#include <boost/intrusive/list.hpp>
+#include "common/ceph_mutex.h"
+#include "common/hobject.h"
+#include "include/types.h"
+#include "ExtentCache.h"
+
+/**
+   ECReadCache
+
+   Cache of reconstructed, stripe aligned object data on an erasure
+   coded primary, shared by all of the PGs of an OSD.  ExtentCache only
+   ever holds extents pinned by in-progress writes; this one holds the
+   result of completed client reads so that a read-hot object does not
+   have to fetch k shards for every read.
+
+   Entries are tagged with the start epoch of the interval during which
+   they were read.  Any write done by another primary implies an
+   interval change for us, so a lookup from a different interval is a
+   miss and drops the entry.  Writes done by this primary invalidate the
+   objects they touch when they enter the write pipeline (see
+   ECBackend::start_rmw()).
+
+   The cache is bounded by osd_ec_read_cache_size and evicts whole
+   objects in LRU order.  A size of 0 disables it.
+ */
+class ECReadCache {
+  struct entry_t {
+    hobject_t hoid;
+    epoch_t interval = 0;
+    extent_map data;
+    uint64_t bytes = 0;
+    boost::intrusive::list_member_hook<> lru_item;
+  };
+  typedef boost::intrusive::list<
+    entry_t,
+    boost::intrusive::member_hook<
+      entry_t,
+      boost::intrusive::list_member_hook<>,
+      &entry_t::lru_item> > lru_list_t;
+
+  mutable ceph::mutex lock = ceph::make_mutex("ECReadCache::lock");
+  std::unordered_map<hobject_t, entry_t> entries;
+  lru_list_t lru;   ///< front is most recently used
+  uint64_t max_bytes = 0;
+  uint64_t bytes = 0;
+
+  void _remove(std::unordered_map<hobject_t, entry_t>::iterator i);
+  void _trim(uint64_t target);
+
+public:
+  explicit ECReadCache(uint64_t max_bytes = 0) : max_bytes(max_bytes) {}
+  ~ECReadCache();
+
+  void set_max_bytes(uint64_t max);
+  bool enabled() const {
+    std::lock_guard l(lock);
+    return max_bytes > 0;
+  }
+
+  /**
+   * Look up the stripe aligned extents in want for hoid
+   *
+   * @return true and fill out if every extent of want is cached
+   */
+  bool lookup(
+    const hobject_t &hoid,
+    epoch_t interval,
+    const extent_set &want,
+    extent_map *out);
+
+  /// Add reconstructed extents read during interval to the cache
+  void insert(
+    const hobject_t &hoid,
+    epoch_t interval,
+    const extent_map &data);
+
+  /// Drop anything cached for hoid
+  void invalidate(const hobject_t &hoid);
+
+  void clear();
+
+  uint64_t get_bytes() const {
+    std::lock_guard l(lock);
+    return bytes;
+  }
+  size_t get_num_objects() const {
+    std::lock_guard l(lock);
+    return entries.size();
+  }
+};
+
+#endif
@@ -43,6 +43,7 @@
 
 #include "OSD.h"
 #include "OSDMap.h"
+#include "OSDMapSnapshot.h"
 #include "Watch.h"
 #include "osdc/Objecter.h"
 
@@ -238,6 +239,7 @@ OSDService::OSDService(OSD *osd) :
   max_oldest_map(0),
   scrubs_local(0),
   scrubs_remote(0),
+  scrub_throttle(cct),
   agent_valid_iterator(false),
   agent_ops(0),
   flush_mode_high_count(0),
@@ -267,11 +269,14 @@ OSDService::OSDService(OSD *osd) :
   map_cache(cct, cct->_conf->osd_map_cache_size),
   map_bl_cache(cct->_conf->osd_map_cache_size),
   map_bl_inc_cache(cct->_conf->osd_map_cache_size),
+  ec_read_cache(cct->_conf.get_val<Option::size_t>("osd_ec_read_cache_size")),
   cur_state(NONE),
   cur_ratio(0), physical_ratio(0),
   boot_epoch(0), up_epoch(0), bind_epoch(0)
 {
   objecter->init();
+  // we share the osdmap subscription and must see every epoch
+  objecter->unset_range_incremental();
 
   for (int i = 0; i < m_objecter_finishers; i++) {
     ostringstream str;
@@ -1282,6 +1287,9 @@ void OSDService::dump_scrub_reservations(Formatter *f)
   f->dump_int("scrubs_local", scrubs_local);
   f->dump_int("scrubs_remote", scrubs_remote);
   f->dump_int("osd_max_scrubs", cct->_conf->osd_max_scrubs);
+  f->open_object_section("scrub_throttle");
+  scrub_throttle.dump(f);
+  f->close_section();
 }
 
 void OSDService::retrieve_epochs(epoch_t *_boot_epoch, epoch_t *_up_epoch,
@@ -1543,6 +1551,9 @@ OSDMapRef OSDService::_add_map(OSDMap *o)
 {
   epoch_t e = o->get_epoch();
 
+  if (cct->_conf.get_val<bool>("osd_map_crush_cache")) {
+    o->enable_crush_cache();
+  }
   if (cct->_conf->osd_map_dedup) {
     // Dedup against an existing map at a nearby epoch
     OSDMapRef for_dedup = map_cache.lower_bound(e);
@@ -3362,7 +3373,12 @@ int OSD::init()
     r = -EINVAL;
     goto out;
   }
-  osdmap = get_map(superblock.current_epoch);
+  if (cct->_conf.get_val<bool>("osd_map_snapshot")) {
+    osdmap = load_map_snapshot(superblock.current_epoch);
+  }
+  if (!osdmap) {
+    osdmap = get_map(superblock.current_epoch);
+  }
 
   // make sure we don't have legacy pgs deleting
   {
@@ -4160,6 +4176,11 @@ int OSD::shutdown()
   cct->_conf.remove_observer(this);
   osd_lock.lock();
 
+  if (cct->_conf.get_val<bool>("osd_map_snapshot") &&
+      superblock.current_epoch > 0) {
+    write_map_snapshot();
+  }
+
   service.meta_ch.reset();
 
   dout(10) << "syncing store" << dendl;
@@ -4334,6 +4355,65 @@ int OSD::read_superblock()
   return 0;
 }
 
+std::string OSD::get_map_snapshot_path() const
+{
+  return cct->_conf->osd_data + "/osdmap_snapshot";
+}
+
+OSDMapRef OSD::load_map_snapshot(epoch_t e)
+{
+  OSDMapSnapshot snap;
+  string path = get_map_snapshot_path();
+  int r = snap.open(path);
+  if (r < 0) {
+    if (r != -ENOENT) {
+      derr << __func__ << " unable to open " << path << ": "
+	   << cpp_strerror(r) << dendl;
+    }
+    return OSDMapRef();
+  }
+  if (snap.get_epoch() != e ||
+      snap.get_fsid() != superblock.cluster_fsid) {
+    dout(10) << __func__ << " " << path << " has e" << snap.get_epoch()
+	     << " fsid " << snap.get_fsid() << ", want e" << e << dendl;
+    return OSDMapRef();
+  }
+  // the map is decoded from the mapped file, and the cached map bl keeps
+  // referring to it
+  bufferlist bl = snap.get_map_bl();
+  OSDMap *map = new OSDMap;
+  try {
+    map->decode(bl);
+  } catch (const buffer::error& err) {
+    derr << __func__ << " unable to decode map in " << path << ": "
+	 << err.what() << dendl;
+    delete map;
+    return OSDMapRef();
+  }
+  dout(1) << __func__ << " loaded e" << e << " from " << path << dendl;
+  service.add_map_bl(e, bl);
+  return service.add_map(map);
+}
+
+void OSD::write_map_snapshot()
+{
+  epoch_t e = superblock.current_epoch;
+  bufferlist bl;
+  OSDMapRef map = service.try_get_map(e);
+  if (!map || !service.get_map_bl(e, bl)) {
+    derr << __func__ << " unable to load e" << e << dendl;
+    return;
+  }
+  string path = get_map_snapshot_path();
+  int r = OSDMapSnapshot::write(path, *map, bl, nullptr);
+  if (r < 0) {
+    derr << __func__ << " unable to write " << path << ": "
+	 << cpp_strerror(r) << dendl;
+    return;
+  }
+  dout(10) << __func__ << " wrote e" << e << " to " << path << dendl;
+}
+
 void OSD::clear_temp_objects()
 {
   dout(10) << __func__ << dendl;
@@ -5808,6 +5888,14 @@ void OSD::tick_without_osd_lock()
   logger->set(l_osd_cached_crc_adjusted, buffer::get_cached_crc_adjusted());
   logger->set(l_osd_missed_crc, buffer::get_missed_crc());
 
+  // not get_cur_stats(), whose window is the one reported to the mgr
+  service.scrub_throttle.update(
+    service.scrub_throttle.get_store_commit_latency(
+      store->get_commit_latency_totals()));
+  logger->set(l_osd_scrub_throttle_level, service.scrub_throttle.get_level());
+  logger->set(l_osd_client_op_p99_lat,
+	      service.scrub_throttle.get_client_p99_ns());
+
   // refresh osd stats
   struct store_statfs_t stbuf;
   osd_alert_list_t alerts;
@@ -7310,11 +7398,12 @@ double OSD::scrub_sleep_time(bool must_scrub)
   }
   utime_t now = ceph_clock_now();
   if (scrub_time_permit(now)) {
-    return cct->_conf->osd_scrub_sleep;
+    return service.scrub_throttle.get_sleep(cct->_conf->osd_scrub_sleep);
   }
   double normal_sleep = cct->_conf->osd_scrub_sleep;
   double extended_sleep = cct->_conf->osd_scrub_extended_sleep;
-  return std::max(extended_sleep, normal_sleep);
+  return service.scrub_throttle.get_sleep(
+    std::max(extended_sleep, normal_sleep));
 }
 
 bool OSD::scrub_time_permit(utime_t now)
@@ -7775,6 +7864,13 @@ void OSD::handle_osd_map(MOSDMap *m)
   if (!is_preboot())
     service.objecter->handle_osd_map(m);
 
+  // we store every epoch, so a range incremental is of no use to us
+  if (!m->range_incremental_maps.empty()) {
+    dout(10) << __func__ << " ignoring " << m->range_incremental_maps.size()
+	     << " range incrementals" << dendl;
+    m->range_incremental_maps.clear();
+  }
+
   epoch_t first = m->get_first();
   epoch_t last = m->get_last();
   dout(3) << "handle_osd_map epochs [" << first << "," << last << "], i have "
@@ -9696,6 +9792,7 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_object_clean_region_max_num_intervals",
     "osd_scrub_min_interval",
     "osd_scrub_max_interval",
+    "osd_ec_read_cache_size",
     NULL
   };
   return KEYS;
@@ -9716,6 +9813,11 @@ void OSD::handle_conf_change(const ConfigProxy& conf,
   if (changed.count("osd_max_trimming_pgs")) {
     service.snap_reserver.set_max(cct->_conf->osd_max_trimming_pgs);
   }
+  if (changed.count("osd_ec_read_cache_size")) {
+    service.ec_read_cache.set_max_bytes(
+      cct->_conf.get_val<Option::size_t>("osd_ec_read_cache_size"));
+    logger->set(l_osd_ec_read_cache_bytes, service.ec_read_cache.get_bytes());
+  }
   if (changed.count("osd_op_complaint_time") ||
       changed.count("osd_op_log_threshold")) {
     op_tracker.set_complaint_and_threshold(cct->_conf->osd_op_complaint_time,
@@ -10068,13 +10170,14 @@ void OSD::get_perf_reports(
     std::map<OSDPerfMetricQuery, OSDPerfMetricReport> *reports) {
   std::vector<PGRef> pgs;
   _get_pgs(&pgs);
-  DynamicPerfStats dps;
+  const auto max_keys = cct->_conf.get_val<uint64_t>("osd_perf_metric_max_keys");
+  DynamicPerfStats dps(m_perf_queries, max_keys);
   for (auto& pg : pgs) {
     // m_perf_queries can be modified only in set_perf_queries by mgr client
     // request, and it is protected by by mgr client's lock, which is held
     // when set_perf_queries/get_perf_reports are called, so we may not hold
     // m_perf_queries_lock here.
-    DynamicPerfStats pg_dps(m_perf_queries);
+    DynamicPerfStats pg_dps(m_perf_queries, max_keys);
     pg->lock();
     pg->get_dynamic_perf_stats(&pg_dps);
     pg->unlock();
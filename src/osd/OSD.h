@@ -35,6 +35,8 @@
 #include "auth/KeyRing.h"
 
 #include "osd/ClassHandler.h"
+#include "osd/ECReadCache.h"
+#include "osd/ScrubThrottle.h"
 
 #include "include/CompatSet.h"
 
@@ -274,6 +276,9 @@ private:
   int scrubs_remote;
 
 public:
+  /// scales scrub chunks and sleeps with client and device latency
+  ScrubThrottle scrub_throttle;
+
   struct ScrubJob {
     CephContext* cct;
     /// pg to be scrubbed
@@ -676,6 +681,9 @@ public:
   SimpleLRU<epoch_t, bufferlist> map_bl_cache;
   SimpleLRU<epoch_t, bufferlist> map_bl_inc_cache;
 
+  // reconstructed erasure coded data, shared by all primary PGs
+  ECReadCache ec_read_cache;
+
   /// final pg_num values for recently deleted pools
   map<int64_t,int> deleted_pool_pg_nums;
 
@@ -1235,6 +1243,11 @@ private:
   void write_superblock(ObjectStore::Transaction& t);
   int read_superblock();
 
+  // -- osdmap snapshot --
+  std::string get_map_snapshot_path() const;
+  OSDMapRef load_map_snapshot(epoch_t e);
+  void write_map_snapshot();
+
   void clear_temp_objects();
 
   CompatSet osd_compat;
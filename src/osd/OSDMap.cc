@@ -1263,6 +1263,181 @@ void OSDMap::Incremental::generate_test_instances(list<Incremental*>& o)
   o.push_back(new Incremental);
 }
 
+// ----------------------------------
+// OSDMap::RangeIncremental
+
+namespace {
+
+// delta ops
+const uint8_t RANGE_INC_COPY = 1;   // copy <offset, length> of the base
+const uint8_t RANGE_INC_DATA = 2;   // <length> literal bytes follow
+
+// matches are looked up by the hash of blocks of this size
+const size_t RANGE_INC_BLOCK = 32;
+const uint64_t RANGE_INC_MULT = 0x100000001b3ull;
+
+uint64_t range_inc_hash(const unsigned char *p)
+{
+  uint64_t h = 0;
+  for (size_t i = 0; i < RANGE_INC_BLOCK; ++i)
+    h = h * RANGE_INC_MULT + p[i];
+  return h;
+}
+
+void range_inc_data(const unsigned char *p, size_t len, bufferlist& bl)
+{
+  if (!len)
+    return;
+  encode(RANGE_INC_DATA, bl);
+  encode((uint32_t)len, bl);
+  bl.append((const char*)p, len);
+}
+
+} // anonymous namespace
+
+void OSDMap::RangeIncremental::build(const bufferlist& from,
+				     const bufferlist& to)
+{
+  using ceph::encode;
+  // rsync style: index the blocks of from, roll a hash over to and
+  // extend every block match in both directions
+  bufferlist fbl(from), tbl(to);
+  const unsigned char *f = (const unsigned char*)fbl.c_str();
+  const unsigned char *t = (const unsigned char*)tbl.c_str();
+  size_t flen = fbl.length(), tlen = tbl.length();
+  base_crc = fbl.crc32c(-1);
+  full_crc = tbl.crc32c(-1);
+  delta.clear();
+
+  std::unordered_map<uint64_t, uint32_t> blocks;
+  blocks.reserve(flen / RANGE_INC_BLOCK);
+  for (size_t off = 0; off + RANGE_INC_BLOCK <= flen; off += RANGE_INC_BLOCK)
+    blocks.emplace(range_inc_hash(f + off), off);
+
+  uint64_t top = 1;   // RANGE_INC_MULT^(RANGE_INC_BLOCK-1)
+  for (size_t i = 1; i < RANGE_INC_BLOCK; ++i)
+    top *= RANGE_INC_MULT;
+
+  size_t lit = 0;     // start of the pending literal bytes
+  size_t i = 0;
+  uint64_t h = 0;
+  bool have_hash = false;
+  while (i + RANGE_INC_BLOCK <= tlen) {
+    if (!have_hash) {
+      h = range_inc_hash(t + i);
+      have_hash = true;
+    }
+    auto p = blocks.find(h);
+    if (p != blocks.end() &&
+	memcmp(f + p->second, t + i, RANGE_INC_BLOCK) == 0) {
+      size_t fo = p->second, tp = i;
+      while (tp > lit && fo > 0 && f[fo - 1] == t[tp - 1]) {
+	--fo;
+	--tp;
+      }
+      size_t len = i + RANGE_INC_BLOCK - tp;
+      while (fo + len < flen && tp + len < tlen && f[fo + len] == t[tp + len])
+	++len;
+      range_inc_data(t + lit, tp - lit, delta);
+      encode(RANGE_INC_COPY, delta);
+      encode((uint32_t)fo, delta);
+      encode((uint32_t)len, delta);
+      i = lit = tp + len;
+      have_hash = false;
+      continue;
+    }
+    if (i + RANGE_INC_BLOCK < tlen)
+      h = (h - t[i] * top) * RANGE_INC_MULT + t[i + RANGE_INC_BLOCK];
+    ++i;
+  }
+  range_inc_data(t + lit, tlen - lit, delta);
+}
+
+int OSDMap::RangeIncremental::apply(const OSDMap& from, bufferlist *to) const
+{
+  using ceph::decode;
+  if (from.get_epoch() != base || from.get_fsid() != fsid)
+    return -EINVAL;
+  bufferlist fbl;
+  from.encode(fbl, base_features | CEPH_FEATURE_RESERVED);
+  if (fbl.crc32c(-1) != base_crc)
+    return -EINVAL;
+  const char *f = fbl.c_str();
+
+  to->clear();
+  try {
+    auto p = delta.cbegin();
+    while (!p.end()) {
+      uint8_t op;
+      uint32_t len;
+      decode(op, p);
+      if (op == RANGE_INC_COPY) {
+	uint32_t off;
+	decode(off, p);
+	decode(len, p);
+	if ((uint64_t)off + len > fbl.length())
+	  return -EIO;
+	to->append(f + off, len);
+      } else if (op == RANGE_INC_DATA) {
+	decode(len, p);
+	p.copy(len, *to);
+      } else {
+	return -EIO;
+      }
+    }
+  } catch (const buffer::error&) {
+    return -EIO;
+  }
+  if (to->crc32c(-1) != full_crc)
+    return -EIO;
+  return 0;
+}
+
+void OSDMap::RangeIncremental::encode(bufferlist& bl) const
+{
+  using ceph::encode;
+  ENCODE_START(1, 1, bl);
+  encode(fsid, bl);
+  encode(base, bl);
+  encode(epoch, bl);
+  encode(base_features, bl);
+  encode(base_crc, bl);
+  encode(full_crc, bl);
+  encode(delta, bl);
+  ENCODE_FINISH(bl);
+}
+
+void OSDMap::RangeIncremental::decode(bufferlist::const_iterator& bl)
+{
+  using ceph::decode;
+  DECODE_START(1, bl);
+  decode(fsid, bl);
+  decode(base, bl);
+  decode(epoch, bl);
+  decode(base_features, bl);
+  decode(base_crc, bl);
+  decode(full_crc, bl);
+  decode(delta, bl);
+  DECODE_FINISH(bl);
+}
+
+void OSDMap::RangeIncremental::dump(Formatter *f) const
+{
+  f->dump_stream("fsid") << fsid;
+  f->dump_unsigned("base", base);
+  f->dump_unsigned("epoch", epoch);
+  f->dump_unsigned("base_features", base_features);
+  f->dump_unsigned("base_crc", base_crc);
+  f->dump_unsigned("full_crc", full_crc);
+  f->dump_unsigned("delta_bytes", delta.length());
+}
+
+void OSDMap::RangeIncremental::generate_test_instances(
+  list<RangeIncremental*>& o)
+{
+  o.push_back(new RangeIncremental);
+}
+
 // ----------------------------------
 // OSDMap
 
@@ -1727,6 +1902,13 @@ void OSDMap::dedup(const OSDMap *o, OSDMap *n)
   if (o->osd_uuid->size() == n->osd_uuid->size() &&
       *o->osd_uuid == *n->osd_uuid)
     n->osd_uuid = o->osd_uuid;
+
+  // can the memoized crush mappings be shared?
+  if (o->crush_cache && n->crush_cache && o->crush == n->crush &&
+      o->max_osd == n->max_osd && o->osd_weight == n->osd_weight) {
+    n->crush_cache = std::make_shared<const CrushResultCache>(
+      n->pools, o->crush_cache.get(), n->crush_cache->get_stats());
+  }
 }
 
 void OSDMap::clean_temps(CephContext *cct,
@@ -1819,6 +2001,13 @@ void OSDMap::get_upmap_pgs(vector<pg_t> *upmap_pgs) const
     upmap_pgs->push_back(p.first);
 }
 
+void OSDMap::get_pg_temp_pgs(vector<pg_t> *pgs) const
+{
+  pgs->reserve(pgs->size() + pg_temp->size());
+  for (auto p = pg_temp->begin(); p != pg_temp->end(); ++p)
+    pgs->push_back(p->first);
+}
+
 bool OSDMap::check_pg_upmaps(
   CephContext *cct,
   const vector<pg_t>& to_check,
@@ -2284,9 +2473,25 @@ int OSDMap::apply_incremental(const Incremental &inc)
 
   calc_num_osds();
   _calc_up_osd_features();
+
+  if (crush_cache) {
+    // keep the memoized mappings unless the crush inputs of the whole
+    // map changed; the cache drops those of changed pools itself
+    bool same = !inc.crush.length() && inc.new_weight.empty() &&
+      inc.new_max_osd < 0;
+    crush_cache = std::make_shared<const CrushResultCache>(
+      pools, same ? crush_cache.get() : nullptr, crush_cache->get_stats());
+  }
   return 0;
 }
 
+void OSDMap::enable_crush_cache(
+  std::shared_ptr<CrushResultCache::stats_t> stats)
+{
+  crush_cache = std::make_shared<const CrushResultCache>(
+    pools, nullptr, std::move(stats));
+}
+
 // mapping
 int OSDMap::map_to_pg(
   int64_t poolid,
@@ -2366,10 +2571,28 @@ void OSDMap::_pg_to_raw_osds(
   ps_t pps = pool.raw_pg_to_pps(pg);  // placement ps
   unsigned size = pool.get_size();
 
-  // what crush rule?
-  int ruleno = crush->find_rule(pool.get_crush_rule(), pool.get_type(), size);
-  if (ruleno >= 0)
-    crush->do_rule(ruleno, pps, *osds, size, osd_weight, pg.pool());
+  CrushResultCache::pool_table_t *table = nullptr;
+  unsigned row = 0;
+  if (crush_cache) {
+    table = crush_cache->get_table(pg.pool(), pool);
+    row = ceph_stable_mod(pg.ps(), pool.get_pgp_num(),
+			  pool.get_pgp_num_mask());
+  }
+  if (table && table->lookup(row, osds)) {
+    crush_cache->count(true);
+  } else {
+    bool claimed = table && table->claim(row);
+    // what crush rule?
+    int ruleno = crush->find_rule(pool.get_crush_rule(), pool.get_type(), size);
+    if (ruleno >= 0)
+      crush->do_rule(ruleno, pps, *osds, size, osd_weight, pg.pool());
+    else
+      osds->clear();
+    if (claimed)
+      table->publish(row, *osds);
+    if (crush_cache)
+      crush_cache->count(false);
+  }
 
   _remove_nonexistent_osds(pool, *osds);
 
@@ -2377,6 +2600,36 @@ void OSDMap::_pg_to_raw_osds(
     *ppps = pps;
 }
 
+void OSDMap::_pgs_to_raw_osds(
+  const pg_pool_t& pool, int64_t poolid,
+  unsigned ps_begin, unsigned ps_end,
+  vector<vector<int>> *osds,
+  vector<ps_t> *ppps) const
+{
+  unsigned size = pool.get_size();
+  vector<int> xs;
+  xs.reserve(ps_end - ps_begin);
+  ppps->clear();
+  ppps->reserve(ps_end - ps_begin);
+  for (unsigned ps = ps_begin; ps < ps_end; ++ps) {
+    ps_t pps = pool.raw_pg_to_pps(pg_t(ps, poolid));
+    xs.push_back(pps);
+    ppps->push_back(pps);
+  }
+
+  int ruleno = crush->find_rule(pool.get_crush_rule(), pool.get_type(), size);
+  if (ruleno >= 0) {
+    crush->do_rule_batch(ruleno, xs, osds, size, osd_weight, poolid);
+  } else {
+    osds->clear();
+    osds->resize(xs.size());
+  }
+
+  for (auto& o : *osds) {
+    _remove_nonexistent_osds(pool, o);
+  }
+}
+
 int OSDMap::_pick_primary(const vector<int>& osds) const
 {
   for (auto osd : osds) {
@@ -2616,17 +2869,9 @@ void OSDMap::_pg_to_up_acting_osds(
   _get_temp_osds(*pool, pg, &_acting, &_acting_primary);
   if (_acting.empty() || up || up_primary) {
     _pg_to_raw_osds(*pool, pg, &raw, &pps);
-    _apply_upmap(*pool, pg, &raw);
-    _raw_to_up_osds(*pool, raw, &_up);
-    _up_primary = _pick_primary(_up);
-    _apply_primary_affinity(pps, *pool, &_up, &_up_primary);
-    if (_acting.empty()) {
-      _acting = _up;
-      if (_acting_primary == -1) {
-        _acting_primary = _up_primary;
-      }
-    }
-  
+    _raw_to_up_acting_osds(*pool, pg, pps, &raw, &_up, &_up_primary,
+			   &_acting, &_acting_primary);
+
     if (up)
       up->swap(_up);
     if (up_primary)
@@ -2639,6 +2884,55 @@ void OSDMap::_pg_to_up_acting_osds(
     *acting_primary = _acting_primary;
 }
 
+void OSDMap::_raw_to_up_acting_osds(
+  const pg_pool_t& pool, pg_t pg, ps_t pps,
+  vector<int> *raw,
+  vector<int> *up, int *up_primary,
+  vector<int> *acting, int *acting_primary) const
+{
+  // acting and acting_primary come in as the pg_temp overrides
+  _apply_upmap(pool, pg, raw);
+  _raw_to_up_osds(pool, *raw, up);
+  *up_primary = _pick_primary(*up);
+  _apply_primary_affinity(pps, pool, up, up_primary);
+  if (acting->empty()) {
+    *acting = *up;
+    if (*acting_primary == -1) {
+      *acting_primary = *up_primary;
+    }
+  }
+}
+
+void OSDMap::pg_range_to_up_acting_osds(
+  int64_t poolid, unsigned ps_begin, unsigned ps_end,
+  std::function<void(unsigned ps,
+		     vector<int>&& up, int up_primary,
+		     vector<int>&& acting, int acting_primary,
+		     const vector<int>& raw)> f) const
+{
+  const pg_pool_t *pool = get_pg_pool(poolid);
+  ceph_assert(pool);
+  ceph_assert(ps_end <= pool->get_pg_num());
+  // bound the batch so its results stay in cache
+  constexpr unsigned batch = 1024;
+  vector<vector<int>> raws;
+  vector<ps_t> ppss;
+  for (unsigned begin = ps_begin; begin < ps_end; begin += batch) {
+    unsigned end = std::min(ps_end, begin + batch);
+    _pgs_to_raw_osds(*pool, poolid, begin, end, &raws, &ppss);
+    for (unsigned ps = begin; ps < end; ++ps) {
+      pg_t pg(ps, poolid);
+      vector<int> up, acting;
+      int up_primary, acting_primary;
+      _get_temp_osds(*pool, pg, &acting, &acting_primary);
+      _raw_to_up_acting_osds(*pool, pg, ppss[ps - begin], &raws[ps - begin],
+			     &up, &up_primary, &acting, &acting_primary);
+      f(ps, std::move(up), up_primary, std::move(acting), acting_primary,
+	raws[ps - begin]);
+    }
+  }
+}
+
 int OSDMap::calc_pg_rank(int osd, const vector<int>& acting, int nrep)
 {
   if (!nrep)
@@ -3361,6 +3655,12 @@ void OSDMap::post_decode()
 
   calc_num_osds();
   _calc_up_osd_features();
+
+  if (crush_cache) {
+    // a new map as far as we know; start over
+    crush_cache = std::make_shared<const CrushResultCache>(
+      pools, nullptr, crush_cache->get_stats());
+  }
 }
 
 void OSDMap::dump_erasure_code_profiles(
@@ -4466,7 +4766,7 @@ bool OSDMap::try_pg_upmap(
   const set<int>& overfull,      ///< osds we'd want to evacuate
   const vector<int>& underfull,  ///< osds to move to, in order of preference
   vector<int> *orig,
-  vector<int> *out)              ///< resulting alternative mapping
+  vector<int> *out) const        ///< resulting alternative mapping
 {
   const pg_pool_t *pool = get_pg_pool(pg.pool());
   if (!pool)
@@ -4502,14 +4802,89 @@ bool OSDMap::try_pg_upmap(
   return true;
 }
 
+namespace {
+
+// tentative changes to calc_pg_upmaps()'s pgs_by_osd, so that trying a
+// change does not copy the whole thing
+class pgs_by_osd_change_t {
+  const map<int,set<pg_t>>& base;
+  map<int,map<pg_t,bool>> changed;  // osd -> pg -> whether it is there now
+
+public:
+  explicit pgs_by_osd_change_t(const map<int,set<pg_t>>& b) : base(b) {}
+
+  bool contains(int osd, pg_t pg) const {
+    if (auto p = changed.find(osd); p != changed.end()) {
+      if (auto q = p->second.find(pg); q != p->second.end())
+	return q->second;
+    }
+    auto p = base.find(osd);
+    return p != base.end() && p->second.count(pg);
+  }
+  void insert(int osd, pg_t pg) {
+    if (!contains(osd, pg))
+      changed[osd][pg] = true;
+  }
+  void erase(int osd, pg_t pg) {
+    if (contains(osd, pg))
+      changed[osd][pg] = false;
+  }
+  const map<int,map<pg_t,bool>>& get_changed() const {
+    return changed;
+  }
+  /// change of the number of pgs of osd
+  int size_delta(int osd) const {
+    auto p = changed.find(osd);
+    if (p == changed.end())
+      return 0;
+    auto b = base.find(osd);
+    int delta = 0;
+    for (auto& [pg, there] : p->second) {
+      bool was = b != base.end() && b->second.count(pg);
+      delta += (int)there - (int)was;
+    }
+    return delta;
+  }
+  void apply(map<int,set<pg_t>> *pgs_by_osd) const {
+    for (auto& [osd, pgs] : changed) {
+      auto& osd_pgs = (*pgs_by_osd)[osd];
+      for (auto& [pg, there] : pgs) {
+	if (there)
+	  osd_pgs.insert(pg);
+	else
+	  osd_pgs.erase(pg);
+      }
+    }
+  }
+};
+
+// a pg calc_pg_upmaps() may try to move off an overfull osd
+struct upmap_candidate_t {
+  pg_t pg;
+  mempool::osdmap::vector<pair<int32_t,int32_t>> new_upmap_items;
+  set<int> existing;
+  vector<int> orig, out;
+  bool ok = false;
+};
+
+// candidates run through crush at once when we have a pg_batch_runner_t
+const size_t UPMAP_CANDIDATE_WINDOW = 256;
+
+} // anonymous namespace
+
 int OSDMap::calc_pg_upmaps(
   CephContext *cct,
   float max_deviation_ratio,
   int max,
   const set<int64_t>& only_pools,
-  OSDMap::Incremental *pending_inc)
+  OSDMap::Incremental *pending_inc,
+  const pg_batch_runner_t& runner,
+  upmap_calc_stats_t *stats)
 {
   ldout(cct, 10) << __func__ << " pools " << only_pools << dendl;
+  auto start = ceph::mono_clock::now();
+  auto time_budget =
+    cct->_conf.get_val<double>("osd_calc_pg_upmaps_time_budget");
   OSDMap tmp;
   tmp.deepish_copy_from(*this);
   int num_changed = 0;
@@ -4517,19 +4892,39 @@ int OSDMap::calc_pg_upmaps(
   int total_pgs = 0;
   float osd_weight_total = 0;
   map<int,float> osd_weight;
-  for (auto& i : pools) {
-    if (!only_pools.empty() && !only_pools.count(i.first))
-      continue;
-    for (unsigned ps = 0; ps < i.second.get_pg_num(); ++ps) {
-      pg_t pg(ps, i.first);
+  // run fn over pgs, in parallel if we can
+  auto run = [&](const vector<pg_t>& pgs,
+		 const std::function<void(const vector<pg_t>&)>& fn) {
+    if (runner)
+      runner(pgs, fn);
+    else
+      fn(pgs);
+  };
+  ceph::mutex pgs_by_osd_lock =
+    ceph::make_mutex("OSDMap::calc_pg_upmaps::pgs_by_osd_lock");
+  auto map_pgs = [&](const vector<pg_t>& pgs) {
+    map<int,vector<pg_t>> mapped;
+    for (auto pg : pgs) {
       vector<int> up;
       tmp.pg_to_up_acting_osds(pg, &up, nullptr, nullptr, nullptr);
       ldout(cct, 20) << __func__ << " " << pg << " up " << up << dendl;
       for (auto osd : up) {
         if (osd != CRUSH_ITEM_NONE)
-	  pgs_by_osd[osd].insert(pg);
+	  mapped[osd].push_back(pg);
       }
     }
+    std::lock_guard l(pgs_by_osd_lock);
+    for (auto& [osd, osd_pgs] : mapped)
+      pgs_by_osd[osd].insert(osd_pgs.begin(), osd_pgs.end());
+  };
+  for (auto& i : pools) {
+    if (!only_pools.empty() && !only_pools.count(i.first))
+      continue;
+    vector<pg_t> pool_pgs;
+    pool_pgs.reserve(i.second.get_pg_num());
+    for (unsigned ps = 0; ps < i.second.get_pg_num(); ++ps)
+      pool_pgs.push_back(pg_t(ps, i.first));
+    run(pool_pgs, map_pgs);
     total_pgs += i.second.get_size() * i.second.get_pg_num();
 
     map<int,float> pmap;
@@ -4590,10 +4985,22 @@ int OSDMap::calc_pg_upmaps(
     deviation_osd.insert(make_pair(deviation, i.first));
     stddev += deviation * deviation;
   }
+  auto finish = [&]() {
+    if (stats) {
+      stats->end_stddev = sqrt(stddev / pgs_by_osd.size());
+      stats->elapsed = std::chrono::duration<double>(
+	ceph::mono_clock::now() - start).count();
+    }
+    ldout(cct, 10) << " num_changed = " << num_changed << dendl;
+    return num_changed;
+  };
+  if (stats) {
+    stats->start_stddev = sqrt(stddev / pgs_by_osd.size());
+  }
   if (stddev <= cct->_conf.get_val<double>("osd_calc_pg_upmaps_max_stddev")) {
     ldout(cct, 10) << __func__ << " distribution is almost perfect"
                    << dendl;
-    return 0;
+    return finish();
   }
   bool skip_overfull = false;
   auto aggressive =
@@ -4601,6 +5008,17 @@ int OSDMap::calc_pg_upmaps(
   auto local_fallback_retries =
     cct->_conf.get_val<uint64_t>("osd_calc_pg_upmaps_local_fallback_retries");
   while (max--) {
+    if (time_budget > 0 &&
+	std::chrono::duration<double>(
+	  ceph::mono_clock::now() - start).count() >= time_budget) {
+      ldout(cct, 10) << __func__ << " out of time after " << time_budget
+		     << "s" << dendl;
+      if (stats)
+	stats->timed_out = true;
+      break;
+    }
+    if (stats)
+      ++stats->rounds;
     // build overfull and underfull
     set<int> overfull;
     vector<int> underfull;
@@ -4661,7 +5079,7 @@ int OSDMap::calc_pg_upmaps(
 
     set<pg_t> to_unmap;
     map<pg_t, mempool::osdmap::vector<pair<int32_t,int32_t>>> to_upmap;
-    auto temp_pgs_by_osd = pgs_by_osd;
+    pgs_by_osd_change_t temp_pgs_by_osd(pgs_by_osd);
     // always start with fullest, break if we find any changes to make
     for (auto p = deviation_osd.rbegin(); p != deviation_osd.rend(); ++p) {
       if (skip_overfull) {
@@ -4710,8 +5128,8 @@ int OSDMap::calc_pg_upmaps(
                            << " which remapped " << pg
                            << " into overfull osd." << osd
                            << dendl;
-            temp_pgs_by_osd[q.second].erase(pg);
-            temp_pgs_by_osd[q.first].insert(pg);
+            temp_pgs_by_osd.erase(q.second, pg);
+            temp_pgs_by_osd.insert(q.first, pg);
           } else {
             new_upmap_items.push_back(q);
           }
@@ -4737,6 +5155,12 @@ int OSDMap::calc_pg_upmaps(
       }
 
       // try upmap
+      //
+      // The candidates are run through crush a window at a time, in
+      // parallel if we have a runner; the first candidate in order that
+      // works wins, as it would in a sequential scan.
+      vector<upmap_candidate_t> candidates;
+      candidates.reserve(pgs.size());
       for (auto pg : pgs) {
         auto temp_it = tmp.pg_upmap.find(pg);
         if (temp_it != tmp.pg_upmap.end()) {
@@ -4749,8 +5173,8 @@ int OSDMap::calc_pg_upmaps(
 	  continue;
 	}
         auto pg_pool_size = tmp.get_pg_pool_size(pg);
-        mempool::osdmap::vector<pair<int32_t,int32_t>> new_upmap_items;
-        set<int> existing;
+        upmap_candidate_t c;
+        c.pg = pg;
         auto it = tmp.pg_upmap_items.find(pg);
         if (it != tmp.pg_upmap_items.end() &&
             it->second.size() >= (size_t)pg_pool_size) {
@@ -4762,47 +5186,75 @@ int OSDMap::calc_pg_upmaps(
           ldout(cct, 10) << " " << pg << " already has pg_upmap_items "
                          << it->second
                          << dendl;
-          new_upmap_items = it->second;
+          c.new_upmap_items = it->second;
           // build existing too (for dedup)
           for (auto i : it->second) {
-            existing.insert(i.first);
-            existing.insert(i.second);
+            c.existing.insert(i.first);
+            c.existing.insert(i.second);
           }
           // fall through
           // to see if we can append more remapping pairs
         }
-	ldout(cct, 10) << " trying " << pg << dendl;
-        vector<int> raw, orig, out;
-        tmp.pg_to_raw_upmap(pg, &raw, &orig); // including existing upmaps too
-	if (!try_pg_upmap(cct, pg, overfull, underfull, &orig, &out)) {
-	  continue;
-	}
-	ldout(cct, 10) << " " << pg << " " << orig << " -> " << out << dendl;
-	if (orig.size() != out.size()) {
-	  continue;
-	}
-	ceph_assert(orig != out);
-	for (unsigned i = 0; i < out.size(); ++i) {
-          if (orig[i] == out[i])
-            continue; // skip invalid remappings
-          if (existing.count(orig[i]) || existing.count(out[i]))
-            continue; // we want new remappings only!
-          ldout(cct, 10) << " will try adding new remapping pair "
-                         << orig[i] << " -> " << out[i] << " for " << pg
-                         << dendl;
-          existing.insert(orig[i]);
-          existing.insert(out[i]);
-          temp_pgs_by_osd[orig[i]].erase(pg);
-          temp_pgs_by_osd[out[i]].insert(pg);
-          ceph_assert(new_upmap_items.size() < (size_t)pg_pool_size);
-          new_upmap_items.push_back(make_pair(orig[i], out[i]));
-          // append new remapping pairs slowly
-          // This way we can make sure that each tiny change will
-          // definitely make distribution of PGs converging to
-          // the perfect status.
-          to_upmap[pg] = new_upmap_items;
-          goto test_change;
-	}
+        candidates.push_back(std::move(c));
+      }
+      const size_t window = runner ? UPMAP_CANDIDATE_WINDOW : 1;
+      for (size_t begin = 0; begin < candidates.size(); begin += window) {
+        size_t end = std::min(begin + window, candidates.size());
+        std::unordered_map<pg_t, upmap_candidate_t*> by_pg;
+        vector<pg_t> window_pgs;
+        for (size_t i = begin; i < end; ++i) {
+          by_pg[candidates[i].pg] = &candidates[i];
+          window_pgs.push_back(candidates[i].pg);
+        }
+        run(window_pgs, [&](const vector<pg_t>& batch) {
+          for (auto pg : batch) {
+            auto c = by_pg.at(pg);
+            ldout(cct, 10) << " trying " << pg << dendl;
+            vector<int> raw;
+            // including existing upmaps too
+            tmp.pg_to_raw_upmap(pg, &raw, &c->orig);
+            c->ok = try_pg_upmap(cct, pg, overfull, underfull,
+                                 &c->orig, &c->out);
+          }
+        });
+        if (stats)
+          stats->evaluated += end - begin;
+        for (size_t j = begin; j < end; ++j) {
+          auto& c = candidates[j];
+          auto pg = c.pg;
+          if (!c.ok) {
+            continue;
+          }
+          auto& orig = c.orig;
+          auto& out = c.out;
+          ldout(cct, 10) << " " << pg << " " << orig << " -> " << out << dendl;
+          if (orig.size() != out.size()) {
+            continue;
+          }
+          ceph_assert(orig != out);
+          auto pg_pool_size = tmp.get_pg_pool_size(pg);
+          for (unsigned i = 0; i < out.size(); ++i) {
+            if (orig[i] == out[i])
+              continue; // skip invalid remappings
+            if (c.existing.count(orig[i]) || c.existing.count(out[i]))
+              continue; // we want new remappings only!
+            ldout(cct, 10) << " will try adding new remapping pair "
+                           << orig[i] << " -> " << out[i] << " for " << pg
+                           << dendl;
+            c.existing.insert(orig[i]);
+            c.existing.insert(out[i]);
+            temp_pgs_by_osd.erase(orig[i], pg);
+            temp_pgs_by_osd.insert(out[i], pg);
+            ceph_assert(c.new_upmap_items.size() < (size_t)pg_pool_size);
+            c.new_upmap_items.push_back(make_pair(orig[i], out[i]));
+            // append new remapping pairs slowly
+            // This way we can make sure that each tiny change will
+            // definitely make distribution of PGs converging to
+            // the perfect status.
+            to_upmap[pg] = c.new_upmap_items;
+            goto test_change;
+          }
+        }
       }
     }
 
@@ -4856,8 +5308,8 @@ int OSDMap::calc_pg_upmaps(
                            << " which remapped " << pg
                            << " out from underfull osd." << osd
                            << dendl;
-            temp_pgs_by_osd[j.second].erase(pg);
-            temp_pgs_by_osd[j.first].insert(pg);
+            temp_pgs_by_osd.erase(j.second, pg);
+            temp_pgs_by_osd.insert(j.first, pg);
           } else {
             new_upmap_items.push_back(j);
           }
@@ -4906,23 +5358,32 @@ int OSDMap::calc_pg_upmaps(
   test_change:
 
     // test change, apply if change is good
+    //
+    // only the osds the change touches have moved, so only their
+    // deviations are recomputed
     ceph_assert(to_unmap.size() || to_upmap.size());
-    float new_stddev = 0;
-    map<int,float> temp_osd_deviation;
-    multimap<float,int> temp_deviation_osd;
-    for (auto& i : temp_pgs_by_osd) {
+    map<int,float> changed_deviation;
+    for (auto& [osd, pgs] : temp_pgs_by_osd.get_changed()) {
       // make sure osd is still there (belongs to this crush-tree)
-      ceph_assert(osd_weight.count(i.first));
-      float target = osd_weight[i.first] * pgs_per_weight;
-      float deviation = (float)i.second.size() - target;
-      ldout(cct, 20) << " osd." << i.first
-                     << "\tpgs " << i.second.size()
+      ceph_assert(osd_weight.count(osd));
+      auto p = pgs_by_osd.find(osd);
+      int num_pgs = (p == pgs_by_osd.end() ? 0 : (int)p->second.size()) +
+	temp_pgs_by_osd.size_delta(osd);
+      float target = osd_weight[osd] * pgs_per_weight;
+      float deviation = (float)num_pgs - target;
+      ldout(cct, 20) << " osd." << osd
+                     << "\tpgs " << num_pgs
                      << "\ttarget " << target
                      << "\tdeviation " << deviation
                      << dendl;
-      temp_osd_deviation[i.first] = deviation;
-      temp_deviation_osd.insert(make_pair(deviation, i.first));
-      new_stddev += deviation * deviation;
+      changed_deviation[osd] = deviation;
+    }
+    // sum up in osd order, as a full recomputation would
+    float new_stddev = 0;
+    for (auto& [osd, deviation] : osd_deviation) {
+      auto p = changed_deviation.find(osd);
+      float d = p == changed_deviation.end() ? deviation : p->second;
+      new_stddev += d * d;
     }
     ldout(cct, 10) << " stddev " << stddev << " -> " << new_stddev << dendl;
     if (new_stddev >= stddev) {
@@ -4956,9 +5417,18 @@ int OSDMap::calc_pg_upmaps(
     // ready to go
     ceph_assert(new_stddev < stddev);
     stddev = new_stddev;
-    pgs_by_osd = temp_pgs_by_osd;
-    osd_deviation = temp_osd_deviation;
-    deviation_osd = temp_deviation_osd;
+    temp_pgs_by_osd.apply(&pgs_by_osd);
+    for (auto& [osd, deviation] : changed_deviation) {
+      auto range = deviation_osd.equal_range(osd_deviation[osd]);
+      for (auto p = range.first; p != range.second; ++p) {
+        if (p->second == osd) {
+          deviation_osd.erase(p);
+          break;
+        }
+      }
+      deviation_osd.insert(make_pair(deviation, osd));
+      osd_deviation[osd] = deviation;
+    }
     for (auto& i : to_unmap) {
       ldout(cct, 10) << " unmap pg " << i << dendl;
       ceph_assert(tmp.pg_upmap_items.count(i));
@@ -4975,8 +5445,7 @@ int OSDMap::calc_pg_upmaps(
       ++num_changed;
     }
   }
-  ldout(cct, 10) << " num_changed = " << num_changed << dendl;
-  return num_changed;
+  return finish();
 }
 
 int OSDMap::get_osds_by_bucket_name(const string &name, set<int> *osds) const
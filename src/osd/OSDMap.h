@@ -29,12 +29,14 @@
 #include <set>
 #include <map>
 #include <memory>
+#include <functional>
 
 #include <boost/smart_ptr/local_shared_ptr.hpp>
 #include "include/btree_map.h"
 #include "include/types.h"
 #include "common/ceph_releases.h"
 #include "osd_types.h"
+#include "CrushResultCache.h"
 
 //#include "include/ceph_features.h"
 #include "crush/CrushWrapper.h"
@@ -509,6 +511,44 @@ public:
       return p->second.contains(snap);
     }
   };
+
+  /**
+   * RangeIncremental
+   *
+   * The difference between the encoded full maps of epochs base and
+   * epoch, for clients that are many epochs behind.  It is a list of
+   * copies out of the base map and literal bytes, so its size depends on
+   * how much of the map changed rather than on the number of epochs in
+   * between.  The base map is encoded with base_features, which the
+   * receiver uses to reencode the map it has.  Both ends are covered by
+   * a crc, so a receiver whose map does not match the base fails
+   * cleanly and can fall back to plain incrementals.
+   */
+  class RangeIncremental {
+  public:
+    uuid_d fsid;
+    epoch_t base = 0;            ///< epoch the delta applies to
+    epoch_t epoch = 0;           ///< epoch of the resulting map
+    uint64_t base_features = 0;  ///< features the base map is encoded with
+    uint32_t base_crc = 0;       ///< crc32c of the encoded base map
+    uint32_t full_crc = 0;       ///< crc32c of the encoded resulting map
+    ceph::buffer::list delta;
+
+    /// compute the delta between two encoded full maps
+    void build(const ceph::buffer::list& from, const ceph::buffer::list& to);
+    /**
+     * rebuild the encoded map of epoch out of the map of epoch base
+     *
+     * @return 0, -EINVAL if from is not the base map, or -EIO if the
+     *         result does not match
+     */
+    int apply(const OSDMap& from, ceph::buffer::list *to) const;
+
+    void encode(ceph::buffer::list& bl) const;
+    void decode(ceph::buffer::list::const_iterator& bl);
+    void dump(ceph::Formatter *f) const;
+    static void generate_test_instances(std::list<RangeIncremental*>& o);
+  };
   
 private:
   uuid_d fsid;
@@ -616,6 +656,9 @@ private:
 private:
   uint32_t crush_version = 1;
 
+  /// memoized raw crush mappings, if enabled
+  std::shared_ptr<const CrushResultCache> crush_cache;
+
   friend class OSDMonitor;
 
  public:
@@ -661,6 +704,24 @@ public:
 
     // NOTE: we do not copy crush.  note that apply_incremental will
     // allocate a new CrushWrapper, though.
+  
+    // the copy is usually modified in place, which the crush cache
+    // does not follow
+    crush_cache.reset();
+  }
+
+  /**
+   * memoize the raw crush mappings of this map (see CrushResultCache)
+   *
+   * The cache follows the map through decode() and apply_incremental(),
+   * and dedup() shares it between maps with the same crush inputs.  Do
+   * not enable it on a map whose crush map, weights or pools are
+   * modified directly.
+   */
+  void enable_crush_cache(
+    std::shared_ptr<CrushResultCache::stats_t> stats = nullptr);
+  const CrushResultCache *get_crush_cache() const {
+    return crush_cache.get();
   }
 
   // map info
@@ -1055,6 +1116,7 @@ public:
   uint64_t get_up_osd_features() const;
 
   void get_upmap_pgs(vector<pg_t> *upmap_pgs) const;
+  void get_pg_temp_pgs(vector<pg_t> *pgs) const;
   bool check_pg_upmaps(
     CephContext *cct,
     const vector<pg_t>& to_check,
@@ -1164,6 +1226,12 @@ private:
     const pg_pool_t& pool, pg_t pg,
     std::vector<int> *osds,
     ps_t *ppps) const;
+  /// _pg_to_raw_osds() for pgs [ps_begin, ps_end) of a pool, in one crush batch
+  void _pgs_to_raw_osds(
+    const pg_pool_t& pool, int64_t poolid,
+    unsigned ps_begin, unsigned ps_end,
+    std::vector<std::vector<int>> *osds,
+    std::vector<ps_t> *ppps) const;
   int _pick_primary(const std::vector<int>& osds) const;
   void _remove_nonexistent_osds(const pg_pool_t& pool, std::vector<int>& osds) const;
 
@@ -1193,6 +1261,12 @@ private:
   void _pg_to_up_acting_osds(const pg_t& pg, std::vector<int> *up, int *up_primary,
                              std::vector<int> *acting, int *acting_primary,
 			     bool raw_pg_to_pg = true) const;
+  /// apply upmap, up state and primary affinity to a raw crush mapping
+  void _raw_to_up_acting_osds(const pg_pool_t& pool, pg_t pg, ps_t pps,
+			      std::vector<int> *raw,
+			      std::vector<int> *up, int *up_primary,
+			      std::vector<int> *acting,
+			      int *acting_primary) const;
 
 public:
   /***
@@ -1232,6 +1306,19 @@ public:
     int up_primary, acting_primary;
     pg_to_up_acting_osds(pg, &up, &up_primary, &acting, &acting_primary);
   }
+  /**
+   * pg_to_up_acting_osds() for every pg in [ps_begin, ps_end) of a pool
+   *
+   * CRUSH is run for the whole range at once (see
+   * CrushWrapper::do_rule_batch()); f is called with the result of each
+   * pg in order, along with its raw mapping after upmaps.
+   */
+  void pg_range_to_up_acting_osds(
+    int64_t pool, unsigned ps_begin, unsigned ps_end,
+    std::function<void(unsigned ps,
+		       std::vector<int>&& up, int up_primary,
+		       std::vector<int>&& acting, int acting_primary,
+		       const std::vector<int>& raw)> f) const;
   bool pg_is_ec(pg_t pg) const {
     auto i = pools.find(pg.pool());
     ceph_assert(i != pools.end());
@@ -1434,14 +1521,33 @@ public:
     const std::set<int>& overfull,      ///< osds we'd want to evacuate
     const std::vector<int>& underfull,  ///< osds to move to, in order of preference
     std::vector<int> *orig,
-    std::vector<int> *out);             ///< resulting alternative mapping
+    std::vector<int> *out) const;       ///< resulting alternative mapping
+
+  /// run process over pgs, in batches that may run in parallel, and
+  /// return when all are done (see ParallelPGMapper::get_runner())
+  typedef std::function<void(
+    const std::vector<pg_t>& pgs,
+    const std::function<void(const std::vector<pg_t>&)>& process)>
+    pg_batch_runner_t;
+
+  /// how a calc_pg_upmaps() run went
+  struct upmap_calc_stats_t {
+    int rounds = 0;          ///< balancing rounds run
+    uint64_t evaluated = 0;  ///< candidate pgs run through crush
+    float start_stddev = 0;  ///< pgs per osd, before
+    float end_stddev = 0;    ///< pgs per osd, after
+    double elapsed = 0;      ///< seconds
+    bool timed_out = false;  ///< stopped by osd_calc_pg_upmaps_time_budget
+  };
 
   int calc_pg_upmaps(
     CephContext *cct,
     float max_deviation, ///< max deviation from target (value < 1.0)
     int max_iterations,  ///< max iterations to run
     const std::set<int64_t>& pools,        ///< [optional] restrict to pool
-    Incremental *pending_inc
+    Incremental *pending_inc,
+    const pg_batch_runner_t& runner = {},  ///< [optional] to map pgs in parallel
+    upmap_calc_stats_t *stats = nullptr    ///< [optional] progress report
     );
 
   int get_osds_by_bucket_name(const std::string &name, std::set<int> *osds) const;
@@ -1557,6 +1663,7 @@ public:
 };
 WRITE_CLASS_ENCODER_FEATURES(OSDMap)
 WRITE_CLASS_ENCODER_FEATURES(OSDMap::Incremental)
+WRITE_CLASS_ENCODER(OSDMap::RangeIncremental)
 
 #ifdef WITH_SEASTAR
 using OSDMapRef = boost::local_shared_ptr<const OSDMap>;
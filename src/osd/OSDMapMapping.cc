@@ -48,10 +48,49 @@ void OSDMapMapping::update(const OSDMap& osdmap)
   for (auto& p : osdmap.get_pools()) {
     _update_range(osdmap, p.first, 0, p.second.get_pg_num());
   }
+  last_update_pgs = last_update_total_pgs = num_pgs;
   _finish(osdmap);
   //_dump();  // for debugging
 }
 
+void OSDMapMapping::update(const OSDMap& osdmap,
+			   const std::list<OSDMap::Incremental>& incs)
+{
+  std::vector<pg_t> pgs;
+  if (!_get_affected_pgs(osdmap, incs, &pgs)) {
+    update(osdmap);
+    return;
+  }
+  _start(osdmap);
+  _update_pgs(osdmap, pgs);
+  last_update_pgs = pgs.size();
+  last_update_total_pgs = num_pgs;
+  _finish(osdmap);
+}
+
+std::unique_ptr<OSDMapMapping::MappingJob> OSDMapMapping::start_update(
+  const OSDMap& osdmap,
+  ParallelPGMapper& mapper,
+  unsigned pgs_per_item,
+  const std::list<OSDMap::Incremental>& incs)
+{
+  std::vector<pg_t> pgs;
+  if (!_get_affected_pgs(osdmap, incs, &pgs)) {
+    return start_update(osdmap, mapper, pgs_per_item);
+  }
+  std::unique_ptr<MappingJob> job(new MappingJob(&osdmap, this));
+  last_update_pgs = pgs.size();
+  last_update_total_pgs = num_pgs;
+  if (pgs.empty()) {
+    // nothing to remap; just move to the new epoch
+    job->finish = ceph_clock_now();
+    job->complete();
+  } else {
+    mapper.queue(job.get(), pgs_per_item, pgs);
+  }
+  return job;
+}
+
 void OSDMapMapping::update(const OSDMap& osdmap, pg_t pgid)
 {
   _update_range(osdmap, pgid.pool(), pgid.ps(), pgid.ps() + 1);
@@ -84,12 +123,200 @@ void OSDMapMapping::_build_rmap(const OSDMap& osdmap)
   }
 }
 
+void OSDMapMapping::_save_osd_state(const OSDMap& osdmap)
+{
+  osd_state.resize(osdmap.get_max_osd());
+  for (int o = 0; o < osdmap.get_max_osd(); ++o) {
+    auto& st = osd_state[o];
+    st.exists = osdmap.exists(o);
+    st.up = st.exists && osdmap.is_up(o);
+    st.weight = st.exists ? osdmap.get_weight(o) : 0;
+    st.primary_affinity = st.exists ? osdmap.get_primary_affinity(o) :
+      CEPH_OSD_DEFAULT_PRIMARY_AFFINITY;
+  }
+}
+
 void OSDMapMapping::_finish(const OSDMap& osdmap)
 {
   _build_rmap(osdmap);
+  _save_osd_state(osdmap);
   epoch = osdmap.get_epoch();
 }
 
+bool OSDMapMapping::_get_affected_pgs(
+  const OSDMap& osdmap,
+  const std::list<OSDMap::Incremental>& incs,
+  std::vector<pg_t> *pgs) const
+{
+  // the incrementals must take us exactly from our epoch to osdmap's
+  if (epoch == 0 ||
+      (int)osd_state.size() != osdmap.get_max_osd()) {
+    return false;
+  }
+  epoch_t e = epoch;
+  for (auto& inc : incs) {
+    if (inc.epoch <= e)
+      continue;  // already reflected
+    if (inc.epoch != e + 1 ||
+	inc.fullmap.length() ||
+	inc.crush.length() ||
+	inc.new_max_osd >= 0) {
+      return false;
+    }
+    e = inc.epoch;
+  }
+  if (e != osdmap.get_epoch()) {
+    return false;
+  }
+
+  // pools to remap entirely
+  std::set<int64_t> whole_pools;
+  // osds whose presence in a pg's raw mapping means it must be remapped
+  std::set<int> raw_osds;
+  // individual pgs
+  std::set<pg_t> pg_set;
+
+  // osds that may now be chosen by crush where they were not before;
+  // every pool whose rule can reach them is remapped
+  std::set<int> new_candidates;
+  // compare the osds the incrementals touch with the state we mapped with
+  auto changed_osd = [&](int o, const osd_state_t& prev) {
+    osd_state_t now;
+    now.exists = osdmap.exists(o);
+    now.up = now.exists && osdmap.is_up(o);
+    now.weight = now.exists ? osdmap.get_weight(o) : 0;
+    now.primary_affinity = now.exists ? osdmap.get_primary_affinity(o) :
+      CEPH_OSD_DEFAULT_PRIMARY_AFFINITY;
+    if ((now.exists && !prev.exists) || now.weight > prev.weight) {
+      new_candidates.insert(o);
+    } else if (now.exists != prev.exists ||
+	       now.weight != prev.weight ||
+	       now.up != prev.up ||
+	       now.primary_affinity != prev.primary_affinity) {
+      // a lower weight can only reject o where crush picked it before;
+      // up state and affinity only matter where o is in the raw set
+      raw_osds.insert(o);
+    }
+  };
+  std::set<int> touched;
+  for (auto& inc : incs) {
+    if (inc.epoch <= epoch)
+      continue;
+    for (auto& p : inc.new_pools)
+      whole_pools.insert(p.first);
+    for (auto& p : inc.new_state)
+      touched.insert(p.first);
+    for (auto& p : inc.new_up_client)
+      touched.insert(p.first);
+    for (auto& p : inc.new_weight)
+      touched.insert(p.first);
+    for (auto& p : inc.new_primary_affinity)
+      touched.insert(p.first);
+    for (auto& p : inc.new_pg_temp)
+      pg_set.insert(p.first);
+    for (auto& p : inc.new_primary_temp)
+      pg_set.insert(p.first);
+    for (auto& p : inc.new_pg_upmap)
+      pg_set.insert(p.first);
+    for (auto& p : inc.new_pg_upmap_items)
+      pg_set.insert(p.first);
+    pg_set.insert(inc.old_pg_upmap.begin(), inc.old_pg_upmap.end());
+    pg_set.insert(inc.old_pg_upmap_items.begin(),
+		  inc.old_pg_upmap_items.end());
+  }
+  for (auto o : touched) {
+    if (o >= 0 && o < (int)osd_state.size())
+      changed_osd(o, osd_state[o]);
+  }
+  if (!raw_osds.empty() || !new_candidates.empty()) {
+    // pg_temp members that are down or gone are left out of acting
+    std::vector<pg_t> temp_pgs;
+    osdmap.get_pg_temp_pgs(&temp_pgs);
+    pg_set.insert(temp_pgs.begin(), temp_pgs.end());
+    // the raw sets we keep have the upmaps applied, so they do not show
+    // the osds an upmap replaced; and an upmap to an osd that was out may
+    // apply now
+    std::vector<pg_t> upmap_pgs;
+    osdmap.get_upmap_pgs(&upmap_pgs);
+    pg_set.insert(upmap_pgs.begin(), upmap_pgs.end());
+  }
+
+  if (!new_candidates.empty()) {
+    for (auto& p : osdmap.get_pools()) {
+      if (whole_pools.count(p.first))
+	continue;
+      int ruleno = osdmap.crush->find_rule(p.second.get_crush_rule(),
+					   p.second.get_type(),
+					   p.second.get_size());
+      if (ruleno < 0)
+	continue;
+      bool reaches = false;
+      for (int step = 0;
+	   !reaches && step < osdmap.crush->get_rule_len(ruleno);
+	   ++step) {
+	if (osdmap.crush->get_rule_op(ruleno, step) != CRUSH_RULE_TAKE)
+	  continue;
+	int root = osdmap.crush->get_rule_arg1(ruleno, step);
+	for (auto o : new_candidates) {
+	  if (root == o || osdmap.crush->subtree_contains(root, o)) {
+	    reaches = true;
+	    break;
+	  }
+	}
+      }
+      if (reaches)
+	whole_pools.insert(p.first);
+    }
+  }
+
+  pgs->clear();
+  for (auto& p : osdmap.get_pools()) {
+    unsigned pg_num = p.second.get_pg_num();
+    auto q = pools.find(p.first);
+    if (whole_pools.count(p.first) ||
+	q == pools.end() ||
+	q->second.pg_num != pg_num ||
+	q->second.size != p.second.get_size()) {
+      for (unsigned ps = 0; ps < pg_num; ++ps)
+	pgs->push_back(pg_t(ps, p.first));
+      continue;
+    }
+    auto first = pg_set.lower_bound(pg_t(0, p.first));
+    for (unsigned ps = 0; ps < pg_num; ++ps) {
+      bool affected = false;
+      if (first != pg_set.end() && first->pool() == (uint64_t)p.first &&
+	  first->ps() == ps) {
+	affected = true;
+	++first;
+      }
+      for (auto o = raw_osds.begin(); !affected && o != raw_osds.end(); ++o) {
+	affected = q->second.raw_contains(ps, *o);
+      }
+      if (affected)
+	pgs->push_back(pg_t(ps, p.first));
+    }
+  }
+  return true;
+}
+
+void OSDMapMapping::_update_pgs(
+  const OSDMap& osdmap,
+  const std::vector<pg_t>& pgs)
+{
+  // pgs are sorted; remap runs of consecutive pgs as one range
+  auto p = pgs.begin();
+  while (p != pgs.end()) {
+    auto q = p + 1;
+    while (q != pgs.end() &&
+	   q->pool() == p->pool() &&
+	   q->ps() == (q - 1)->ps() + 1) {
+      ++q;
+    }
+    _update_range(osdmap, p->pool(), p->ps(), (q - 1)->ps() + 1);
+    p = q;
+  }
+}
+
 void OSDMapMapping::_dump()
 {
   for (auto& p : pools) {
@@ -112,15 +339,14 @@ void OSDMapMapping::_update_range(
   ceph_assert(i != pools.end());
   ceph_assert(pg_begin <= pg_end);
   ceph_assert(pg_end <= i->second.pg_num);
-  for (unsigned ps = pg_begin; ps < pg_end; ++ps) {
-    std::vector<int> up, acting;
-    int up_primary, acting_primary;
-    osdmap.pg_to_up_acting_osds(
-      pg_t(ps, pool),
-      &up, &up_primary, &acting, &acting_primary);
-    i->second.set(ps, std::move(up), up_primary,
-		  std::move(acting), acting_primary);
-  }
+  osdmap.pg_range_to_up_acting_osds(
+    pool, pg_begin, pg_end,
+    [&](unsigned ps,
+	std::vector<int>&& up, int up_primary,
+	std::vector<int>&& acting, int acting_primary,
+	const std::vector<int>& raw) {
+      i->second.set(ps, up, up_primary, acting, acting_primary, raw);
+    });
 }
 
 // ---------------------------
@@ -159,6 +385,35 @@ void ParallelPGMapper::WQ::_process(Item *i, ThreadPool::TPHandle &h)
   delete i;
 }
 
+namespace {
+
+struct BatchJob : public ParallelPGMapper::Job {
+  const std::function<void(const vector<pg_t>&)>& fn;
+  BatchJob(const OSDMap *osdmap,
+	   const std::function<void(const vector<pg_t>&)>& fn)
+    : Job(osdmap), fn(fn) {}
+  void process(const vector<pg_t>& pgs) override {
+    fn(pgs);
+  }
+  void process(int64_t poolid, unsigned ps_begin, unsigned ps_end) override {}
+  void complete() override {}
+};
+
+} // anonymous namespace
+
+OSDMap::pg_batch_runner_t ParallelPGMapper::get_runner(unsigned pgs_per_item)
+{
+  return [this, pgs_per_item](
+    const vector<pg_t>& pgs,
+    const std::function<void(const vector<pg_t>&)>& fn) {
+    if (pgs.empty())
+      return;
+    BatchJob job(nullptr, fn);
+    queue(&job, pgs_per_item, pgs);
+    job.wait();
+  };
+}
+
 void ParallelPGMapper::queue(
   Job *job,
   unsigned pgs_per_item,
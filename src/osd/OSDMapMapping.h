@@ -9,11 +9,10 @@
 #include <map>
 
 #include "osd/osd_types.h"
+#include "osd/OSDMap.h"
 #include "common/WorkQueue.h"
 #include "common/Cond.h"
 
-class OSDMap;
-
 /// work queue to perform work on batches of pgids on multiple CPUs
 class ParallelPGMapper {
 public:
@@ -163,6 +162,9 @@ public:
   void drain() {
     wq.drain();
   }
+
+  /// an OSDMap::pg_batch_runner_t that runs its batches here
+  OSDMap::pg_batch_runner_t get_runner(unsigned pgs_per_item);
 };
 
 
@@ -187,7 +189,9 @@ private:
 	1 + // num acting
 	1 + // num up
 	size + // acting
-	size;  // up
+	size + // up
+	1 + // num raw
+	size;  // raw (crush output with upmaps applied)
     }
 
     PoolMapping(int s, int p, bool e)
@@ -223,11 +227,24 @@ private:
       }
     }
 
+    /// does the raw mapping of ps include osd
+    bool raw_contains(size_t ps, int osd) const {
+      const int32_t *row = &table[row_size() * ps];
+      const int32_t *raw = row + 4 + 2 * size;
+      for (int i = 0; i < raw[0]; ++i) {
+	if (raw[1 + i] == osd) {
+	  return true;
+	}
+      }
+      return false;
+    }
+
     void set(size_t ps,
 	     const std::vector<int>& up,
 	     int up_primary,
 	     const std::vector<int>& acting,
-	     int acting_primary) {
+	     int acting_primary,
+	     const std::vector<int>& raw) {
       int32_t *row = &table[row_size() * ps];
       row[0] = acting_primary;
       row[1] = up_primary;
@@ -242,25 +259,50 @@ private:
       for (int i = 0; i < row[3]; ++i) {
 	row[4 + size + i] = up[i];
       }
+      int32_t *rawrow = row + 4 + 2 * size;
+      rawrow[0] = std::min<int32_t>(raw.size(), size);
+      for (int i = 0; i < rawrow[0]; ++i) {
+	rawrow[1 + i] = raw[i];
+      }
     }
   };
 
+  /// the osd state the mapping was computed with
+  struct osd_state_t {
+    uint32_t weight = 0;
+    bool exists = false;
+    bool up = false;
+    uint32_t primary_affinity = CEPH_OSD_DEFAULT_PRIMARY_AFFINITY;
+  };
+
   mempool::osdmap_mapping::map<int64_t,PoolMapping> pools;
   mempool::osdmap_mapping::vector<
     mempool::osdmap_mapping::vector<pg_t>> acting_rmap;  // osd -> pg
   //unused: mempool::osdmap_mapping::vector<std::vector<pg_t>> up_rmap;  // osd -> pg
+  mempool::osdmap_mapping::vector<osd_state_t> osd_state;
   epoch_t epoch = 0;
   uint64_t num_pgs = 0;
+  /// pgs recomputed by the last update, and the pgs there were then
+  uint64_t last_update_pgs = 0, last_update_total_pgs = 0;
 
   void _init_mappings(const OSDMap& osdmap);
   void _update_range(
     const OSDMap& map,
     int64_t pool,
     unsigned pg_begin, unsigned pg_end);
+  void _update_pgs(const OSDMap& map, const std::vector<pg_t>& pgs);
 
   void _build_rmap(const OSDMap& osdmap);
+  void _save_osd_state(const OSDMap& osdmap);
+  bool _get_affected_pgs(
+    const OSDMap& osdmap,
+    const std::list<OSDMap::Incremental>& incs,
+    std::vector<pg_t> *pgs) const;
 
   void _start(const OSDMap& osdmap) {
+    // the rows match no epoch until _finish(); if the job is aborted,
+    // the next update has to be a full one
+    epoch = 0;
     _init_mappings(osdmap);
   }
   void _finish(const OSDMap& osdmap);
@@ -268,6 +310,7 @@ private:
   void _dump();
 
   friend class ParallelPGMapper;
+  friend class OSDMapSnapshot;
 
   struct MappingJob : public ParallelPGMapper::Job {
     OSDMapMapping *mapping;
@@ -275,7 +318,9 @@ private:
       : Job(osdmap), mapping(m) {
       mapping->_start(*osdmap);
     }
-    void process(const vector<pg_t>& pgs) override {}
+    void process(const vector<pg_t>& pgs) override {
+      mapping->_update_pgs(*osdmap, pgs);
+    }
     void process(int64_t pool, unsigned ps_begin, unsigned ps_end) override {
       mapping->_update_range(*osdmap, pool, ps_begin, ps_end);
     }
@@ -325,15 +370,31 @@ public:
 
   void update(const OSDMap& map);
   void update(const OSDMap& map, pg_t pgid);
+  /**
+   * bring the mapping up to date with map, given the incrementals
+   * (oldest first) that lead to it from the mapping's epoch
+   *
+   * Only the pgs that the incrementals may have remapped are
+   * recomputed.  Falls back to a full update if incs do not start
+   * right after get_epoch() or carry a crush or full map.
+   */
+  void update(const OSDMap& map, const std::list<OSDMap::Incremental>& incs);
 
   std::unique_ptr<MappingJob> start_update(
     const OSDMap& map,
     ParallelPGMapper& mapper,
     unsigned pgs_per_item) {
     std::unique_ptr<MappingJob> job(new MappingJob(&map, this));
+    last_update_pgs = last_update_total_pgs = num_pgs;
     mapper.queue(job.get(), pgs_per_item, {});
     return job;
   }
+  /// start_update() that only remaps what incs may have changed
+  std::unique_ptr<MappingJob> start_update(
+    const OSDMap& map,
+    ParallelPGMapper& mapper,
+    unsigned pgs_per_item,
+    const std::list<OSDMap::Incremental>& incs);
 
   epoch_t get_epoch() const {
     return epoch;
@@ -342,6 +403,15 @@ public:
   uint64_t get_num_pgs() const {
     return num_pgs;
   }
+
+  /// fraction of the pgs recomputed by the last update
+  double get_last_update_fraction() const {
+    return last_update_total_pgs ?
+      (double)last_update_pgs / (double)last_update_total_pgs : 0.0;
+  }
+  uint64_t get_last_update_pgs() const {
+    return last_update_pgs;
+  }
 };
 
 
@@ -0,0 +1,285 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "OSDMapSnapshot.h"
+#include "OSDMap.h"
+#include "OSDMapMapping.h"
+#include "common/deleter.h"
+#include "include/byteorder.h"
+#include "include/compat.h"
+#include "include/crc32c.h"
+
+namespace {
+
+constexpr char SNAPSHOT_MAGIC[8] = {'c', 'e', 'p', 'h', 'o', 's', 'm', 's'};
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+struct header_t {
+  char magic[8];
+  ceph_le32 version;
+  ceph_le32 crc;         ///< crc32c of the file past the header
+  uint8_t fsid[16];
+  ceph_le32 epoch;
+  ceph_le32 num_pools;
+  ceph_le64 file_len;
+  ceph_le64 map_off;
+  ceph_le64 map_len;
+  ceph_le64 pools_off;
+} __attribute__ ((packed));
+
+struct pool_t {
+  ceph_le64 pool;
+  ceph_le32 size;
+  ceph_le32 pg_num;
+  ceph_le32 erasure;
+  ceph_le32 row_size;
+  ceph_le64 table_off;
+} __attribute__ ((packed));
+
+static_assert(sizeof(header_t) % 8 == 0);
+static_assert(sizeof(pool_t) % 8 == 0);
+
+uint64_t pad8(uint64_t len)
+{
+  return (len + 7) & ~7ull;
+}
+
+void append_zeros(ceph::buffer::list& bl, unsigned len)
+{
+  if (len) {
+    bl.append_zero(len);
+  }
+}
+
+} // anonymous namespace
+
+struct OSDMapSnapshot::mapped_t {
+  const char *data = nullptr;
+  size_t len = 0;
+
+  mapped_t(const char *d, size_t l) : data(d), len(l) {}
+  ~mapped_t() {
+    ::munmap(const_cast<char*>(data), len);
+  }
+  const header_t& header() const {
+    return *reinterpret_cast<const header_t*>(data);
+  }
+  const pool_t *pools() const {
+    return reinterpret_cast<const pool_t*>(data + header().pools_off);
+  }
+};
+
+OSDMapSnapshot::~OSDMapSnapshot()
+{
+  close();
+}
+
+int OSDMapSnapshot::write(const std::string& path,
+			  const OSDMap& osdmap,
+			  const ceph::buffer::list& map_bl,
+			  const OSDMapMapping *mapping)
+{
+  if (mapping && mapping->get_epoch() != osdmap.get_epoch()) {
+    return -EINVAL;
+  }
+  header_t h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+  h.version = SNAPSHOT_VERSION;
+  memcpy(h.fsid, osdmap.get_fsid().uuid.data, sizeof(h.fsid));
+  h.epoch = osdmap.get_epoch();
+  h.map_off = sizeof(header_t);
+  h.map_len = map_bl.length();
+  h.pools_off = pad8(h.map_off + h.map_len);
+
+  ceph::buffer::list body;
+  body.append(map_bl);
+  append_zeros(body, h.pools_off - h.map_off - h.map_len);
+  if (mapping) {
+    h.num_pools = mapping->pools.size();
+    uint64_t table_off = h.pools_off + sizeof(pool_t) * mapping->pools.size();
+    for (auto& [id, pm] : mapping->pools) {
+      pool_t p;
+      p.pool = id;
+      p.size = pm.size;
+      p.pg_num = pm.pg_num;
+      p.erasure = pm.erasure;
+      p.row_size = pm.row_size();
+      p.table_off = table_off;
+      body.append(reinterpret_cast<const char*>(&p), sizeof(p));
+      table_off = pad8(table_off + sizeof(int32_t) * pm.table.size());
+    }
+    for (auto& [id, pm] : mapping->pools) {
+      ceph::buffer::ptr t(sizeof(int32_t) * pm.table.size());
+      auto *out = reinterpret_cast<ceph_le32*>(t.c_str());
+      for (size_t i = 0; i < pm.table.size(); ++i) {
+	out[i] = pm.table[i];
+      }
+      body.append(std::move(t));
+      append_zeros(body, pad8(body.length()) - body.length());
+    }
+  }
+  h.file_len = sizeof(header_t) + body.length();
+  h.crc = body.crc32c(-1);
+
+  ceph::buffer::list bl;
+  bl.append(reinterpret_cast<const char*>(&h), sizeof(h));
+  bl.claim_append(body);
+
+  std::string tmp = path + ".tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return -errno;
+  }
+  int r = bl.write_fd(fd);
+  if (r == 0 && ::fsync(fd) < 0) {
+    r = -errno;
+  }
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+  if (r == 0 && ::rename(tmp.c_str(), path.c_str()) < 0) {
+    r = -errno;
+  }
+  if (r < 0) {
+    ::unlink(tmp.c_str());
+  }
+  return r;
+}
+
+int OSDMapSnapshot::open(const std::string& path)
+{
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY|O_CLOEXEC);
+  if (fd < 0) {
+    return -errno;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    int r = -errno;
+    VOID_TEMP_FAILURE_RETRY(::close(fd));
+    return r;
+  }
+  if ((size_t)st.st_size < sizeof(header_t)) {
+    VOID_TEMP_FAILURE_RETRY(::close(fd));
+    return -EINVAL;
+  }
+  void *p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+  if (p == MAP_FAILED) {
+    return -errno;
+  }
+  auto m = std::make_shared<mapped_t>(static_cast<const char*>(p),
+				      st.st_size);
+
+  const header_t& h = m->header();
+  if (memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) != 0 ||
+      h.version != SNAPSHOT_VERSION ||
+      h.file_len != m->len ||
+      h.map_off < sizeof(header_t) ||
+      h.map_off + h.map_len > h.pools_off ||
+      h.pools_off + sizeof(pool_t) * (uint64_t)h.num_pools > m->len) {
+    return -EINVAL;
+  }
+  for (unsigned i = 0; i < h.num_pools; ++i) {
+    const pool_t& pool = m->pools()[i];
+    uint64_t table_len = sizeof(int32_t) * (uint64_t)pool.pg_num *
+      pool.row_size;
+    if (pool.table_off % 8 ||
+	pool.table_off + table_len > m->len) {
+      return -EINVAL;
+    }
+  }
+  uint32_t crc = ceph_crc32c(
+    -1, reinterpret_cast<const unsigned char*>(m->data) + sizeof(header_t),
+    m->len - sizeof(header_t));
+  if (crc != h.crc) {
+    return -EIO;
+  }
+
+  memcpy(fsid.uuid.data, h.fsid, sizeof(h.fsid));
+  epoch = h.epoch;
+  mapped = std::move(m);
+  return 0;
+}
+
+void OSDMapSnapshot::close()
+{
+  mapped.reset();
+  fsid = uuid_d();
+  epoch = 0;
+}
+
+bool OSDMapSnapshot::has_mapping() const
+{
+  return mapped && mapped->header().num_pools > 0;
+}
+
+ceph::buffer::list OSDMapSnapshot::get_map_bl() const
+{
+  ceph::buffer::list bl;
+  if (!mapped) {
+    return bl;
+  }
+  const header_t& h = mapped->header();
+  // the deleter holds a reference to the mapping
+  bl.append(ceph::buffer::claim_buffer(
+    h.map_len, const_cast<char*>(mapped->data + h.map_off),
+    make_deleter([m = mapped] {})));
+  return bl;
+}
+
+bool OSDMapSnapshot::get_mapping(const OSDMap& osdmap,
+				 OSDMapMapping *mapping) const
+{
+  if (!has_mapping() ||
+      osdmap.get_epoch() != epoch ||
+      osdmap.get_fsid() != fsid) {
+    return false;
+  }
+  const header_t& h = mapped->header();
+  if (h.num_pools != osdmap.get_pools().size()) {
+    return false;
+  }
+  mapping->pools.clear();
+  mapping->num_pgs = 0;
+  for (unsigned i = 0; i < h.num_pools; ++i) {
+    const pool_t& p = mapped->pools()[i];
+    const pg_pool_t *pi = osdmap.get_pg_pool(p.pool);
+    if (!pi ||
+	pi->get_size() != p.size ||
+	pi->get_pg_num() != p.pg_num ||
+	pi->is_erasure() != (bool)p.erasure) {
+      mapping->pools.clear();
+      return false;
+    }
+    auto& pm = mapping->pools.emplace(
+      p.pool,
+      OSDMapMapping::PoolMapping(p.size, p.pg_num, p.erasure)).first->second;
+    if (pm.row_size() != p.row_size) {
+      mapping->pools.clear();
+      return false;
+    }
+    auto *in = reinterpret_cast<const ceph_le32*>(mapped->data + p.table_off);
+    for (size_t j = 0; j < pm.table.size(); ++j) {
+      pm.table[j] = (int32_t)in[j];
+    }
+    mapping->num_pgs += p.pg_num;
+  }
+  mapping->_finish(osdmap);
+  return true;
+}
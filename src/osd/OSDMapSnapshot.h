@@ -0,0 +1,98 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "include/buffer.h"
+#include "include/types.h"
+#include "include/uuid.h"
+
+class OSDMap;
+class OSDMapMapping;
+
+/**
+ * OSDMapSnapshot
+ *
+ * A flat file holding one full OSDMap, encoded, and optionally the
+ * tables of an OSDMapMapping computed for it.  The file is mapped
+ * read-only and used in place: the map is decoded straight from the
+ * mapped pages, and the mapping tables are copied out without running
+ * CRUSH for every pg.
+ *
+ * Layout, all integers little endian:
+ *
+ *   header_t
+ *   encoded map, padded to 8 bytes
+ *   pool_t[num_pools]
+ *   one int32 table per pool, pg_num * row size entries
+ *
+ * The file is checksummed as a whole and written to a temporary file
+ * that is renamed into place, so a reader sees either the old or the
+ * new snapshot.
+ */
+class OSDMapSnapshot {
+  struct mapped_t;
+
+  std::shared_ptr<mapped_t> mapped;
+  uuid_d fsid;
+  epoch_t epoch = 0;
+
+public:
+  OSDMapSnapshot() = default;
+  ~OSDMapSnapshot();
+
+  /**
+   * write a snapshot of osdmap to path
+   *
+   * @param map_bl the full map of osdmap, as encoded for the store
+   * @param mapping mapping to store along, or nullptr
+   */
+  static int write(const std::string& path,
+		   const OSDMap& osdmap,
+		   const ceph::buffer::list& map_bl,
+		   const OSDMapMapping *mapping);
+
+  /// map and verify the snapshot at path
+  int open(const std::string& path);
+  void close();
+
+  bool is_open() const {
+    return mapped != nullptr;
+  }
+  const uuid_d& get_fsid() const {
+    return fsid;
+  }
+  epoch_t get_epoch() const {
+    return epoch;
+  }
+  bool has_mapping() const;
+
+  /**
+   * the encoded map
+   *
+   * The returned buffer refers to the mapped file and keeps it mapped
+   * for as long as it (or any buffer sharing it) lives, even past
+   * close().
+   */
+  ceph::buffer::list get_map_bl() const;
+
+  /**
+   * fill mapping from the stored tables
+   *
+   * @param osdmap the map decoded from this snapshot
+   * @return false if there are no tables or they do not fit osdmap
+   */
+  bool get_mapping(const OSDMap& osdmap, OSDMapMapping *mapping) const;
+};
@@ -2704,10 +2704,17 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
 	   * left end of the range if we are a tier because they may legitimately
 	   * not exist (see _scrub).
 	   */
-	  int min = std::max<int64_t>(3, cct->_conf->osd_scrub_chunk_min /
-				      scrubber.preempt_divisor);
-	  int max = std::max<int64_t>(min, cct->_conf->osd_scrub_chunk_max /
-                                      scrubber.preempt_divisor);
+	  // forced scrubs are not throttled
+	  int64_t min_chunk = cct->_conf->osd_scrub_chunk_min /
+	    scrubber.preempt_divisor;
+	  int64_t max_chunk = cct->_conf->osd_scrub_chunk_max /
+	    scrubber.preempt_divisor;
+	  if (!scrubber.must_scrub) {
+	    min_chunk = osd->scrub_throttle.get_chunk_size(min_chunk);
+	    max_chunk = osd->scrub_throttle.get_chunk_size(max_chunk);
+	  }
+	  int min = std::max<int64_t>(3, min_chunk);
+	  int max = std::max<int64_t>(min, max_chunk);
           hobject_t start = scrubber.start;
 	  hobject_t candidate_end;
 	  vector<hobject_t> objects;
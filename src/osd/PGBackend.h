@@ -36,6 +36,7 @@ struct inconsistent_obj_wrapper;
 //forward declaration
 class OSDMap;
 class PGLog;
+class ECReadCache;
 typedef std::shared_ptr<const OSDMap> OSDMapRef;
 
  /**
@@ -286,6 +287,8 @@ typedef std::shared_ptr<const OSDMap> OSDMapRef;
 
      virtual PerfCounters *get_logger() = 0;
 
+     virtual ECReadCache *get_ec_read_cache() = 0;
+
      virtual ceph_tid_t get_tid() = 0;
 
      virtual OstreamTemp clog_error() = 0;
@@ -20,6 +20,7 @@
 #include "include/ceph_assert.h"
 #include "osd_types.h"
 #include "os/ObjectStore.h"
+#include "PGLogIndex.h"
 #include <list>
 
 #ifdef WITH_SEASTAR
@@ -73,10 +74,45 @@ public:
    * plus some methods to manipulate it all.
    */
   struct IndexedLog : public pg_log_t {
-    mutable ceph::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
-    mutable ceph::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
-    mutable ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
-    mutable ceph::unordered_map<osd_reqid_t,pg_log_dup_t*> dup_index;
+    struct object_key_t {
+      static const hobject_t& key(const pg_log_entry_t *e) {
+	return e->soid;
+      }
+      static bool match(const pg_log_entry_t *e, const hobject_t &k) {
+	return e->soid == k;
+      }
+    };
+    template <typename T>
+    struct reqid_key_t {
+      static const osd_reqid_t& key(const T *e) {
+	return e->reqid;
+      }
+      static bool match(const T *e, const osd_reqid_t &k) {
+	return e->reqid == k;
+      }
+    };
+    struct extra_reqid_key_t {
+      static bool match(const pg_log_entry_t *e, const osd_reqid_t &k) {
+	for (auto& i : e->extra_reqids) {
+	  if (i.first == k)
+	    return true;
+	}
+	return false;
+      }
+    };
+    using object_index_t =
+      pglog_index_t<hobject_t, pg_log_entry_t, object_key_t>;
+    using caller_ops_index_t =
+      pglog_index_t<osd_reqid_t, pg_log_entry_t, reqid_key_t<pg_log_entry_t>>;
+    using extra_caller_ops_index_t =
+      pglog_index_t<osd_reqid_t, pg_log_entry_t, extra_reqid_key_t, true>;
+    using dup_index_t =
+      pglog_index_t<osd_reqid_t, pg_log_dup_t, reqid_key_t<pg_log_dup_t>>;
+
+    mutable object_index_t objects;  // ptrs into log.  be careful!
+    mutable caller_ops_index_t caller_ops;
+    mutable extra_caller_ops_index_t extra_caller_ops;
+    mutable dup_index_t dup_index;
 
     // recovery pointers
     list<pg_log_entry_t>::iterator complete_to; // not inclusive of referenced item
@@ -273,7 +309,7 @@ public:
       ceph_assert(version);
       ceph_assert(user_version);
       ceph_assert(return_code);
-      ceph::unordered_map<osd_reqid_t,pg_log_entry_t*>::const_iterator p;
+      caller_ops_index_t::const_iterator p;
       if (!(indexed_data & PGLOG_INDEXED_CALLER_OPS)) {
         index_caller_ops();
       }
@@ -291,20 +327,21 @@ public:
       if (!(indexed_data & PGLOG_INDEXED_EXTRA_CALLER_OPS)) {
         index_extra_caller_ops();
       }
-      p = extra_caller_ops.find(r);
-      if (p != extra_caller_ops.end()) {
+      auto ep = extra_caller_ops.find(r);
+      if (ep != extra_caller_ops.end()) {
+	const pg_log_entry_t *e = ep.get();
 	uint32_t idx = 0;
-	for (auto i = p->second->extra_reqids.begin();
-	     i != p->second->extra_reqids.end();
+	for (auto i = e->extra_reqids.begin();
+	     i != e->extra_reqids.end();
 	     ++idx, ++i) {
 	  if (i->first == r) {
-	    *version = p->second->version;
+	    *version = e->version;
 	    *user_version = i->second;
-	    *return_code = p->second->return_code;
-	    *op_returns = p->second->op_returns;
+	    *return_code = e->return_code;
+	    *op_returns = e->op_returns;
 	    if (*return_code >= 0) {
-	      auto it = p->second->extra_reqid_return_codes.find(idx);
-	      if (it != p->second->extra_reqid_return_codes.end()) {
+	      auto it = e->extra_reqid_return_codes.find(idx);
+	      if (it != e->extra_reqid_return_codes.end()) {
 		*return_code = it->second;
 	      }
 	    }
@@ -378,8 +415,9 @@ public:
 	extra_caller_ops.clear();
       if (to_index & PGLOG_INDEXED_DUPS) {
 	dup_index.clear();
+	dup_index.reserve(dups.size());
 	for (auto& i : dups) {
-	  dup_index[i.reqid] = const_cast<pg_log_dup_t*>(&i);
+	  dup_index.insert_or_assign(i.reqid, const_cast<pg_log_dup_t*>(&i));
 	}
       }
 
@@ -389,18 +427,22 @@ public:
 	PGLOG_INDEXED_EXTRA_CALLER_OPS;
 
       if (to_index & any_log_entry_index) {
+	if (to_index & PGLOG_INDEXED_OBJECTS)
+	  objects.reserve(log.size());
+	if (to_index & PGLOG_INDEXED_CALLER_OPS)
+	  caller_ops.reserve(log.size());
 	for (list<pg_log_entry_t>::const_iterator i = log.begin();
 	     i != log.end();
 	     ++i) {
 	  if (to_index & PGLOG_INDEXED_OBJECTS) {
 	    if (i->object_is_indexed()) {
-	      objects[i->soid] = const_cast<pg_log_entry_t*>(&(*i));
+	      objects.insert_or_assign(i->soid, const_cast<pg_log_entry_t*>(&(*i)));
 	    }
 	  }
 
 	  if (to_index & PGLOG_INDEXED_CALLER_OPS) {
 	    if (i->reqid_is_indexed()) {
-	      caller_ops[i->reqid] = const_cast<pg_log_entry_t*>(&(*i));
+	      caller_ops.insert_or_assign(i->reqid, const_cast<pg_log_entry_t*>(&(*i)));
 	    }
 	  }
 
@@ -409,7 +451,7 @@ public:
 		 j != i->extra_reqids.end();
 		 ++j) {
 	      extra_caller_ops.insert(
-		make_pair(j->first, const_cast<pg_log_entry_t*>(&(*i))));
+		j->first, const_cast<pg_log_entry_t*>(&(*i)));
 	    }
 	  }
 	}
@@ -436,21 +478,21 @@ public:
 
     void index(pg_log_entry_t& e) {
       if ((indexed_data & PGLOG_INDEXED_OBJECTS) && e.object_is_indexed()) {
-        if (objects.count(e.soid) == 0 ||
-            objects[e.soid]->version < e.version)
-          objects[e.soid] = &e;
+        auto it = objects.find(e.soid);
+        if (it == objects.end() || it->second->version < e.version)
+          objects.insert_or_assign(e.soid, &e);
       }
       if (indexed_data & PGLOG_INDEXED_CALLER_OPS) {
 	// divergent merge_log indexes new before unindexing old
         if (e.reqid_is_indexed()) {
-	  caller_ops[e.reqid] = &e;
+	  caller_ops.insert_or_assign(e.reqid, &e);
         }
       }
       if (indexed_data & PGLOG_INDEXED_EXTRA_CALLER_OPS) {
         for (auto j = e.extra_reqids.begin();
 	     j != e.extra_reqids.end();
 	     ++j) {
-	  extra_caller_ops.insert(make_pair(j->first, &e));
+	  extra_caller_ops.insert(j->first, &e);
         }
       }
     }
@@ -482,22 +524,14 @@ public:
         for (auto j = e.extra_reqids.begin();
              j != e.extra_reqids.end();
              ++j) {
-          for (ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*>::iterator k =
-		 extra_caller_ops.find(j->first);
-               k != extra_caller_ops.end() && k->first == j->first;
-               ++k) {
-            if (k->second == &e) {
-              extra_caller_ops.erase(k);
-              break;
-            }
-          }
+          extra_caller_ops.erase(j->first, &e);
         }
       }
     }
 
     void index(pg_log_dup_t& e) {
       if (indexed_data & PGLOG_INDEXED_DUPS) {
-	dup_index[e.reqid] = &e;
+	dup_index.insert_or_assign(e.reqid, &e);
       }
     }
 
@@ -532,11 +566,11 @@ public:
 
       // to our index
       if ((indexed_data & PGLOG_INDEXED_OBJECTS) && e.object_is_indexed()) {
-        objects[e.soid] = &(log.back());
+        objects.insert_or_assign(e.soid, &(log.back()));
       }
       if (indexed_data & PGLOG_INDEXED_CALLER_OPS) {
         if (e.reqid_is_indexed()) {
-	  caller_ops[e.reqid] = &(log.back());
+	  caller_ops.insert_or_assign(e.reqid, &(log.back()));
         }
       }
 
@@ -544,7 +578,7 @@ public:
         for (auto j = e.extra_reqids.begin();
 	     j != e.extra_reqids.end();
 	     ++j) {
-	  extra_caller_ops.insert(make_pair(j->first, &(log.back())));
+	  extra_caller_ops.insert(j->first, &(log.back()));
         }
       }
 
@@ -974,7 +1008,7 @@ protected:
 		       << " last_divergent_update: " << last_divergent_update
 		       << dendl;
 
-    ceph::unordered_map<hobject_t, pg_log_entry_t*>::const_iterator objiter =
+    IndexedLog::object_index_t::const_iterator objiter =
       log.objects.find(hoid);
     if (objiter != log.objects.end() &&
 	objiter->second->version >= first_divergent_update) {
@@ -0,0 +1,263 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <utility>
+
+#include "include/ceph_assert.h"
+#include "include/mempool.h"
+
+/**
+ * pglog_index_t
+ *
+ * Open addressing (linear probing) index from a key to an element of a
+ * PG log or dup list.  The elements already carry their key (the object
+ * or reqid of an entry), so a slot only holds the full hash and a
+ * pointer: 16 bytes per slot instead of a heap allocated node holding a
+ * copy of the hobject_t/osd_reqid_t.  Slots live in a single
+ * mempool::osd_pglog vector, so the index is also accounted with the
+ * log it refers to.
+ *
+ * Traits provides
+ *   static bool match(const T *v, const Key &k);
+ * and, for indexes where an element maps to a single key,
+ *   static const Key& key(const T *v);
+ *
+ * With Multi set the same key may be inserted several times (the
+ * extra_reqids of a log entry); find() then returns one of them.
+ *
+ * Deletion shifts the following slots back, so there are no tombstones
+ * and lookups never degrade as the log is trimmed and appended to.
+ * Any insert or erase invalidates iterators.
+ */
+template <typename Key, typename T, typename Traits, bool Multi = false>
+class pglog_index_t {
+  struct slot_t {
+    size_t hash = 0;
+    T *value = nullptr;   ///< nullptr for an empty slot
+  };
+  mempool::osd_pglog::vector<slot_t> slots;
+  size_t num = 0;
+
+  static constexpr size_t MIN_SLOTS = 16;
+
+  static size_t hash_key(const Key &k) {
+    // std::hash of osd_reqid_t is a plain xor of its fields; mix it so
+    // that the low bits used for the slot position are well spread
+    uint64_t h = std::hash<Key>()(k);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+  }
+  size_t mask() const {
+    return slots.size() - 1;
+  }
+  size_t find_slot(size_t h, const Key &k) const {
+    if (slots.empty())
+      return slots.size();
+    for (size_t i = h & mask(); slots[i].value; i = (i + 1) & mask()) {
+      if (slots[i].hash == h && Traits::match(slots[i].value, k))
+	return i;
+    }
+    return slots.size();
+  }
+  void rehash(size_t n) {
+    mempool::osd_pglog::vector<slot_t> old(n);
+    old.swap(slots);
+    for (auto &s : old) {
+      if (s.value)
+	place(s.hash, s.value);
+    }
+  }
+  void place(size_t h, T *v) {
+    size_t i = h & mask();
+    while (slots[i].value)
+      i = (i + 1) & mask();
+    slots[i].hash = h;
+    slots[i].value = v;
+  }
+  void maybe_grow() {
+    // keep the load factor at or below 3/4
+    if ((num + 1) * 4 > slots.size() * 3)
+      rehash(slots.empty() ? MIN_SLOTS : slots.size() * 2);
+  }
+  void erase_slot(size_t i) {
+    // backward shift deletion
+    size_t j = i;
+    while (true) {
+      j = (j + 1) & mask();
+      if (!slots[j].value)
+	break;
+      size_t home = slots[j].hash & mask();
+      // move j into the hole at i unless its home lies in (i, j]
+      if ((j > i && (home <= i || home > j)) ||
+	  (j < i && (home <= i && home > j))) {
+	slots[i] = slots[j];
+	i = j;
+      }
+    }
+    slots[i] = slot_t();
+    --num;
+  }
+
+public:
+  class const_iterator {
+    friend class pglog_index_t;
+    const pglog_index_t *idx = nullptr;
+    size_t pos = 0;
+
+    const_iterator(const pglog_index_t *idx, size_t pos)
+      : idx(idx), pos(pos) {
+      skip();
+    }
+    void skip() {
+      while (pos < idx->slots.size() && !idx->slots[pos].value)
+	++pos;
+    }
+  public:
+    using value_type = std::pair<const Key&, T*>;
+    using reference = value_type;
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    struct pointer {
+      value_type v;
+      const value_type *operator->() const {
+	return &v;
+      }
+    };
+
+    const_iterator() = default;
+    /// the element, usable on indexes whose Traits have no key()
+    T *get() const {
+      return idx->slots[pos].value;
+    }
+    value_type operator*() const {
+      T *v = idx->slots[pos].value;
+      return value_type(Traits::key(v), v);
+    }
+    pointer operator->() const {
+      return pointer{**this};
+    }
+    const_iterator& operator++() {
+      ++pos;
+      skip();
+      return *this;
+    }
+    bool operator==(const const_iterator &o) const {
+      return pos == o.pos;
+    }
+    bool operator!=(const const_iterator &o) const {
+      return pos != o.pos;
+    }
+  };
+  using iterator = const_iterator;
+
+  pglog_index_t() = default;
+  pglog_index_t(const pglog_index_t&) = default;
+  pglog_index_t(pglog_index_t&&) = default;
+  pglog_index_t& operator=(const pglog_index_t&) = default;
+  pglog_index_t& operator=(pglog_index_t&&) = default;
+
+  size_t size() const {
+    return num;
+  }
+  bool empty() const {
+    return num == 0;
+  }
+  /// number of slots allocated
+  size_t capacity() const {
+    return slots.size();
+  }
+  size_t memory_usage() const {
+    return slots.capacity() * sizeof(slot_t);
+  }
+
+  void clear() {
+    mempool::osd_pglog::vector<slot_t>().swap(slots);
+    num = 0;
+  }
+  void reserve(size_t n) {
+    size_t want = MIN_SLOTS;
+    while (want * 3 < n * 4)
+      want *= 2;
+    if (want > slots.size())
+      rehash(want);
+  }
+
+  const_iterator begin() const {
+    return const_iterator(this, 0);
+  }
+  const_iterator end() const {
+    return const_iterator(this, slots.size());
+  }
+  const_iterator find(const Key &k) const {
+    return const_iterator(this, find_slot(hash_key(k), k));
+  }
+  size_t count(const Key &k) const {
+    return find_slot(hash_key(k), k) != slots.size();
+  }
+
+  /// point k at v, replacing any existing mapping for k
+  void insert_or_assign(const Key &k, T *v) {
+    static_assert(!Multi, "use insert() on a multi index");
+    ceph_assert(v);
+    size_t h = hash_key(k);
+    size_t i = find_slot(h, k);
+    if (i != slots.size()) {
+      slots[i].value = v;
+      return;
+    }
+    maybe_grow();
+    place(h, v);
+    ++num;
+  }
+  /// add a mapping from k to v, keeping any existing one
+  void insert(const Key &k, T *v) {
+    static_assert(Multi, "use insert_or_assign() on a unique index");
+    ceph_assert(v);
+    maybe_grow();
+    place(hash_key(k), v);
+    ++num;
+  }
+
+  void erase(const_iterator it) {
+    ceph_assert(it.idx == this && it.pos < slots.size());
+    erase_slot(it.pos);
+  }
+  /**
+   * remove the mapping from k to v
+   *
+   * Only the stored hash and pointer are compared, so v need not
+   * be dereferenceable.
+   *
+   * @return true if it was found
+   */
+  bool erase(const Key &k, const T *v) {
+    if (slots.empty())
+      return false;
+    size_t h = hash_key(k);
+    for (size_t i = h & mask(); slots[i].value; i = (i + 1) & mask()) {
+      if (slots[i].hash == h && slots[i].value == v) {
+	erase_slot(i);
+	return true;
+      }
+    }
+    return false;
+  }
+};
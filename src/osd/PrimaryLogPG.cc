@@ -4078,6 +4078,7 @@ void PrimaryLogPG::log_op_stats(const OpRequest& op,
   osd->logger->inc(l_osd_op_inb, inb);
   osd->logger->tinc(l_osd_op_lat, latency);
   osd->logger->tinc(l_osd_op_process_lat, process_latency);
+  osd->scrub_throttle.add_client_latency(latency.to_nsec());
 
   if (op.may_read() && op.may_write()) {
     osd->logger->inc(l_osd_op_rw);
@@ -4116,7 +4117,8 @@ void PrimaryLogPG::log_op_stats(const OpRequest& op,
 void PrimaryLogPG::set_dynamic_perf_stats_queries(
     const std::list<OSDPerfMetricQuery> &queries)
 {
-  m_dynamic_perf_stats.set_queries(queries);
+  m_dynamic_perf_stats.set_queries(
+    queries, cct->_conf.get_val<uint64_t>("osd_perf_metric_max_keys"));
 }
 
 void PrimaryLogPG::get_dynamic_perf_stats(DynamicPerfStats *stats)
@@ -539,6 +539,10 @@ public:
 
   PerfCounters *get_logger() override;
 
+  ECReadCache *get_ec_read_cache() override {
+    return &osd->ec_read_cache;
+  }
+
   ceph_tid_t get_tid() override { return osd->get_tid(); }
 
   OstreamTemp clog_error() override { return osd->clog->error(); }
@@ -0,0 +1,93 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "ScrubThrottle.h"
+#include "common/debug.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_osd
+#undef dout_prefix
+#define dout_prefix *_dout << "scrub_throttle "
+
+void ScrubThrottle::update(uint64_t store_commit_latency_ns)
+{
+  std::array<uint64_t, NUM_BUCKETS> counts;
+  uint64_t total = 0;
+  for (unsigned i = 0; i < NUM_BUCKETS; ++i) {
+    counts[i] = buckets[i].exchange(0);
+    total += counts[i];
+  }
+
+  // with only a handful of ops the tail is noise; treat it as idle
+  uint64_t p99 = 0;
+  if (total >= cct->_conf.get_val<uint64_t>("osd_scrub_throttle_min_ops")) {
+    uint64_t want = total - total / 100;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < NUM_BUCKETS; ++i) {
+      seen += counts[i];
+      if (seen >= want) {
+	p99 = bucket_upper_ns(i);
+	break;
+      }
+    }
+  }
+  client_p99_ns = p99;
+
+  double client_target =
+    cct->_conf.get_val<double>("osd_scrub_throttle_client_p99_target");
+  double store_target =
+    cct->_conf.get_val<double>("osd_scrub_throttle_store_latency_target");
+  if (client_target <= 0 && store_target <= 0) {
+    level = 0;
+    return;
+  }
+
+  // how far over (>1) or under (<1) target we are; the worse one wins
+  double ratio = 0;
+  if (client_target > 0) {
+    ratio = std::max(ratio, (double)p99 / (client_target * 1e9));
+  }
+  if (store_target > 0) {
+    ratio = std::max(ratio, (double)store_commit_latency_ns /
+		     (store_target * 1e9));
+  }
+
+  unsigned old = level;
+  if (ratio > 1.0 && old < MAX_LEVEL) {
+    level = old + 1;
+  } else if (ratio < 0.5 && old > 0) {
+    level = old - 1;
+  }
+  if (level != old) {
+    dout(10) << __func__ << " client p99 " << p99 << "ns over "
+	     << total << " ops, store commit "
+	     << store_commit_latency_ns << "ns, level "
+	     << old << " -> " << level << dendl;
+  }
+}
+
+double ScrubThrottle::get_sleep(double base) const
+{
+  unsigned l = level;
+  if (l == 0) {
+    return base;
+  }
+  double max_sleep =
+    cct->_conf.get_val<double>("osd_scrub_throttle_max_sleep");
+  return std::max(base, max_sleep * l / MAX_LEVEL);
+}
+
+void ScrubThrottle::dump(ceph::Formatter *f) const
+{
+  f->dump_unsigned("level", level);
+  f->dump_unsigned("client_p99_ns", client_p99_ns);
+}
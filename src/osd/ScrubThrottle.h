@@ -0,0 +1,99 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+
+#include "common/ceph_context.h"
+#include "common/Formatter.h"
+#include "common/perf_counters.h"
+
+/**
+ * ScrubThrottle
+ *
+ * Scales scrub chunk size and sleep with the load seen by client ops.
+ *
+ * Client op latencies are collected into a log2 histogram.  On each OSD
+ * tick update() computes the p99 of the ops completed since the previous
+ * tick, and together with the object store commit latency moves the
+ * throttle level up when either exceeds its target
+ * (osd_scrub_throttle_client_p99_target,
+ * osd_scrub_throttle_store_latency_target) and down when both are well
+ * below it.  At level L the scrub chunk is divided by 2^L and the sleep
+ * between chunks grows linearly up to osd_scrub_throttle_max_sleep.
+ */
+class ScrubThrottle {
+public:
+  static constexpr unsigned MAX_LEVEL = 8;
+
+  explicit ScrubThrottle(CephContext *cct) : cct(cct) {
+    for (auto& b : buckets) {
+      b = 0;
+    }
+  }
+
+  /// record the latency of a completed client op
+  void add_client_latency(uint64_t nsec) {
+    buckets[bucket_of(nsec)]++;
+  }
+
+  /// re-evaluate the level from the latencies seen since the last call
+  void update(uint64_t store_commit_latency_ns);
+  /**
+   * average store commit latency since the last call
+   *
+   * @param totals ObjectStore::get_commit_latency_totals()
+   */
+  uint64_t get_store_commit_latency(const std::pair<uint64_t, uint64_t>& totals) {
+    store_commit_lat.consume_next(totals);
+    return store_commit_lat.current_avg();
+  }
+
+  unsigned get_level() const {
+    return level;
+  }
+  /// p99 client latency seen by the last update(), 0 if too few ops
+  uint64_t get_client_p99_ns() const {
+    return client_p99_ns;
+  }
+
+  /// sleep between scrub chunks given the configured one
+  double get_sleep(double base) const;
+  /// scrub chunk bound (in objects) given the configured one
+  int64_t get_chunk_size(int64_t base) const {
+    return base >> level;
+  }
+
+  void dump(ceph::Formatter *f) const;
+
+private:
+  static constexpr unsigned NUM_BUCKETS = 64;
+  static unsigned bucket_of(uint64_t nsec) {
+    // bucket i holds latencies in [2^(i-1), 2^i) usec
+    uint64_t usec = nsec / 1000;
+    return usec ? std::min<unsigned>(NUM_BUCKETS - 1, 64 - __builtin_clzll(usec))
+      : 0;
+  }
+  static uint64_t bucket_upper_ns(unsigned i) {
+    return (1ull << i) * 1000;
+  }
+
+  CephContext *cct;
+  std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets;
+  std::atomic<unsigned> level = 0;
+  std::atomic<uint64_t> client_p99_ns = 0;
+  /// our own window on the store's totals; only used from the tick
+  PerfCounters::avg_tracker<uint64_t> store_commit_lat;
+};
@@ -261,6 +261,24 @@ PerfCounters *build_osd_logger(CephContext *cct) {
     l_osd_object_ctx_cache_total, "object_ctx_cache_total", "Object context cache lookups");
 
   osd_plb.add_u64_counter(l_osd_op_cache_hit, "op_cache_hit");
+
+  osd_plb.add_u64_counter(
+    l_osd_ec_read_cache_hit, "ec_read_cache_hit",
+    "Erasure coded reads served from the read cache");
+  osd_plb.add_u64_counter(
+    l_osd_ec_read_cache_miss, "ec_read_cache_miss",
+    "Erasure coded reads that missed the read cache");
+  osd_plb.add_u64(
+    l_osd_ec_read_cache_bytes, "ec_read_cache_bytes",
+    "Bytes of reconstructed data in the erasure coded read cache",
+    NULL, 0, unit_t(UNIT_BYTES));
+
+  osd_plb.add_u64(
+    l_osd_scrub_throttle_level, "scrub_throttle_level",
+    "Current scrub throttle level (0 = unthrottled)");
+  osd_plb.add_u64(
+    l_osd_client_op_p99_lat, "client_op_p99_lat",
+    "p99 client op latency (ns) over the last tick, as seen by the scrub throttle");
   osd_plb.add_time_avg(
     l_osd_tier_flush_lat, "osd_tier_flush_lat", "Object flush latency");
   osd_plb.add_time_avg(
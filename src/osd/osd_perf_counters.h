@@ -109,6 +109,14 @@ enum {
   l_osd_object_ctx_cache_total,
 
   l_osd_op_cache_hit,
+
+  l_osd_ec_read_cache_hit,
+  l_osd_ec_read_cache_miss,
+  l_osd_ec_read_cache_bytes,
+
+  l_osd_scrub_throttle_level,
+  l_osd_client_op_p99_lat,
+
   l_osd_tier_flush_lat,
   l_osd_tier_promote_lat,
   l_osd_tier_r_lat,
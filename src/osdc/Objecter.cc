@@ -151,6 +151,7 @@ enum {
   l_osdc_map_epoch,
   l_osdc_map_full,
   l_osdc_map_inc,
+  l_osdc_map_range,
 
   l_osdc_osd_sessions,
   l_osdc_osd_session_open,
@@ -161,6 +162,12 @@ enum {
   l_osdc_osdop_omap_rd,
   l_osdc_osdop_omap_del,
 
+  l_osdc_crush_cache_hit,
+  l_osdc_crush_cache_miss,
+
+  l_osdc_op_coalesced,
+  l_osdc_op_coalesce_send,
+
   l_osdc_last,
 };
 
@@ -363,6 +370,8 @@ void Objecter::init()
 			"Full OSD maps received");
     pcb.add_u64_counter(l_osdc_map_inc, "map_inc",
 			"Incremental OSD maps received");
+    pcb.add_u64_counter(l_osdc_map_range, "map_range",
+			"Range incremental OSD maps applied");
 
     pcb.add_u64(l_osdc_osd_sessions, "osd_sessions",
 		"Open sessions");  // open sessions
@@ -379,6 +388,16 @@ void Objecter::init()
     pcb.add_u64_counter(l_osdc_osdop_omap_del, "omap_del",
 			"OSD OMAP delete operations");
 
+    pcb.add_u64_counter(l_osdc_crush_cache_hit, "crush_cache_hit",
+			"PG mappings served from the CRUSH result cache");
+    pcb.add_u64_counter(l_osdc_crush_cache_miss, "crush_cache_miss",
+			"PG mappings that ran CRUSH");
+
+    pcb.add_u64_counter(l_osdc_op_coalesced, "op_coalesced",
+			"Reads merged into a coalesced op");
+    pcb.add_u64_counter(l_osdc_op_coalesce_send, "op_coalesce_send",
+			"Coalesced read ops sent");
+
     logger = pcb.create_perf_counters();
     cct->get_perfcounters_collection()->add(logger);
   }
@@ -398,6 +417,16 @@ void Objecter::init()
 
   update_crush_location();
 
+  read_coalesce_window = std::chrono::microseconds(
+    cct->_conf.get_val<uint64_t>("objecter_read_coalesce_window_us"));
+  read_coalesce_max_ops =
+    cct->_conf.get_val<uint64_t>("objecter_read_coalesce_max_ops");
+  read_coalesce_max_bytes =
+    cct->_conf.get_val<Option::size_t>("objecter_read_coalesce_max_bytes");
+  if (read_coalesce_window.count() > 0 && read_coalesce_max_ops > 1) {
+    coalesce_timer.emplace();
+  }
+
   cct->_conf.add_observer(this);
 
   initialized = true;
@@ -413,6 +442,8 @@ void Objecter::start(const OSDMap* o)
   start_tick();
   if (o) {
     osdmap->deepish_copy_from(*o);
+    if (crush_cache_stats)
+      osdmap->enable_crush_cache(crush_cache_stats);
     prune_pg_mapping(osdmap->get_pools());
   } else if (osdmap->get_epoch() == 0) {
     _maybe_request_map();
@@ -423,6 +454,13 @@ void Objecter::shutdown()
 {
   ceph_assert(initialized);
 
+  // send whatever is still waiting for its coalescing window.  the
+  // timer stays until we are destroyed, since submitters use it unlocked
+  if (coalesce_timer) {
+    _flush_all_coalesced_reads();
+    coalesce_timer->cancel_all_events();
+  }
+
   unique_lock wl(rwlock);
 
   initialized = false;
@@ -1194,6 +1232,13 @@ void Objecter::handle_osd_map(MOSDMap *m)
 	   e++) {
 
 	if (osdmap->get_epoch() == e-1 &&
+	    _apply_range_incremental(m)) {
+	  // we never saw the epochs in between
+	  e = osdmap->get_epoch();
+	  skipped_map = true;
+	  logger->inc(l_osdc_map_range);
+	}
+	else if (osdmap->get_epoch() == e-1 &&
 	    m->incremental_maps.count(e)) {
 	  ldout(cct, 3) << "handle_osd_map decoding incremental epoch " << e
 			<< dendl;
@@ -1207,6 +1252,8 @@ void Objecter::handle_osd_map(MOSDMap *m)
 	else if (m->maps.count(e)) {
 	  ldout(cct, 3) << "handle_osd_map decoding full epoch " << e << dendl;
           auto new_osdmap = std::make_unique<OSDMap>();
+	  if (crush_cache_stats)
+	    new_osdmap->enable_crush_cache(crush_cache_stats);
           new_osdmap->decode(m->maps[e]);
 
           emit_blacklist_events(*osdmap, *new_osdmap);
@@ -1229,6 +1276,7 @@ void Objecter::handle_osd_map(MOSDMap *m)
 	  continue;
 	}
 	logger->set(l_osdc_map_epoch, osdmap->get_epoch());
+	update_crush_cache_counters();
 
         prune_pg_mapping(osdmap->get_pools());
 	cluster_full = cluster_full || _osdmap_full_flag();
@@ -1528,7 +1576,7 @@ int Objecter::pool_snap_list(int64_t poolid, vector<uint64_t> *snaps)
 }
 
 // sl may be unlocked.
-void Objecter::_check_op_pool_dne(Op *op, unique_lock *sl)
+void Objecter::_check_op_pool_dne(Op *op, OSDSession::unique_lock *sl)
 {
   // rwlock is locked unique
 
@@ -1991,11 +2039,56 @@ void Objecter::_maybe_request_map()
     flag = CEPH_SUBSCRIBE_ONETIME;
   }
   epoch_t epoch = osdmap->get_epoch() ? osdmap->get_epoch()+1 : 0;
+  if (want_range_incremental && epoch) {
+    flag |= CEPH_SUBSCRIBE_RANGE_INC;
+  }
   if (monc->sub_want("osdmap", epoch, flag)) {
     monc->renew_subs();
   }
 }
 
+bool Objecter::_apply_range_incremental(MOSDMap *m)
+{
+  // rwlock is locked unique
+  for (auto& [epoch, bl] : m->range_incremental_maps) {
+    if (epoch <= osdmap->get_epoch())
+      continue;
+    OSDMap::RangeIncremental ri;
+    try {
+      auto p = bl.cbegin();
+      decode(ri, p);
+    } catch (const buffer::error& e) {
+      ldout(cct, 0) << __func__ << " bad range incremental to " << epoch
+		    << ": " << e.what() << dendl;
+      want_range_incremental = false;
+      return false;
+    }
+    if (ri.base != osdmap->get_epoch())
+      continue;
+    bufferlist full_bl;
+    int r = ri.apply(*osdmap, &full_bl);
+    if (r < 0) {
+      // our map does not encode like the mon's; stick to incrementals
+      ldout(cct, 0) << __func__ << " failed to apply range incremental "
+		    << ri.base << ".." << ri.epoch << ": " << cpp_strerror(r)
+		    << "; disabling range incrementals" << dendl;
+      want_range_incremental = false;
+      return false;
+    }
+    ldout(cct, 3) << __func__ << " applied range incremental " << ri.base
+		  << ".." << ri.epoch << ", " << ri.delta.length()
+		  << " bytes" << dendl;
+    auto new_osdmap = std::make_unique<OSDMap>();
+    if (crush_cache_stats)
+      new_osdmap->enable_crush_cache(crush_cache_stats);
+    new_osdmap->decode(full_bl);
+    emit_blacklist_events(*osdmap, *new_osdmap);
+    osdmap = std::move(new_osdmap);
+    return true;
+  }
+  return false;
+}
+
 void Objecter::_wait_for_new_map(Context *c, epoch_t epoch, int err)
 {
   // rwlock is locked unique
@@ -2111,6 +2204,14 @@ void Objecter::start_tick()
 		    &Objecter::tick, this);
 }
 
+void Objecter::update_crush_cache_counters()
+{
+  if (crush_cache_stats) {
+    logger->set(l_osdc_crush_cache_hit, crush_cache_stats->hit);
+    logger->set(l_osdc_crush_cache_miss, crush_cache_stats->miss);
+  }
+}
+
 void Objecter::tick()
 {
   shared_lock rl(rwlock);
@@ -2182,6 +2283,7 @@ void Objecter::tick()
 
   logger->set(l_osdc_op_laggy, laggy_ops);
   logger->set(l_osdc_osd_laggy, toping.size());
+  update_crush_cache_counters();
 
   if (!toping.empty()) {
     // send a ping to these osds, to ensure we detect any session resets
@@ -2255,6 +2357,12 @@ void Objecter::resend_mon_ops()
 
 void Objecter::op_submit(Op *op, ceph_tid_t *ptid, int *ctx_budget)
 {
+  if (coalesce_timer) {
+    if (!ctx_budget && _maybe_coalesce_read(op, ptid))
+      return;
+    // reads of the object parked before op go first
+    _flush_coalesced_reads(op);
+  }
   shunique_lock rl(rwlock, ceph::acquire_shared);
   ceph_tid_t tid = 0;
   if (!ptid)
@@ -2274,8 +2382,10 @@ void Objecter::_op_submit_with_budget(Op *op, shunique_lock& sul,
   ceph_assert(op->ops.size() == op->out_handler.size());
 
   // throttle.  before we look at any state, because
-  // _take_op_budget() may drop our lock while it blocks.
-  if (!op->ctx_budgeted || (ctx_budget && (*ctx_budget == -1))) {
+  // _take_op_budget() may drop our lock while it blocks.  coalesced
+  // reads took theirs before they were parked.
+  if ((!op->ctx_budgeted && op->budget < 0) ||
+      (ctx_budget && (*ctx_budget == -1))) {
     int op_budget = _take_op_budget(op, sul);
     // take and pass out the budget for the first OP
     // in the context session
@@ -2296,6 +2406,247 @@ void Objecter::_op_submit_with_budget(Op *op, shunique_lock& sul,
   _op_submit(op, sul, ptid);
 }
 
+bool Objecter::_is_coalescable_read(const Op *op) const
+{
+  if (op->ops.size() != 1 ||
+      op->ops[0].op.op != CEPH_OSD_OP_READ ||
+      op->ops[0].op.extent.length > read_coalesce_max_bytes ||
+      (op->target.flags & (CEPH_OSD_FLAG_WRITE | CEPH_OSD_FLAG_PGOP |
+			   CEPH_OSD_FLAG_RWORDERED)) ||
+      op->ctx_budgeted || op->data_offset || op->reply_epoch ||
+      op->reqid != osd_reqid_t()) {
+    return false;
+  }
+  // the data must go to exactly one buffer, and not into one the
+  // caller preallocated (see the copy in handle_osd_op_reply)
+  ceph::buffer::list *dest = op->outbl ? op->outbl : op->out_bl[0];
+  if (!dest || (op->outbl && op->out_bl[0] && op->out_bl[0] != op->outbl) ||
+      dest->length()) {
+    return false;
+  }
+  return true;
+}
+
+bool Objecter::_can_coalesce(const Op *a, const Op *b)
+{
+  return _same_object(a, b) &&
+    a->target.flags == b->target.flags &&
+    a->snapid == b->snapid &&
+    a->priority == b->priority &&
+    a->features == b->features;
+}
+
+bool Objecter::_same_object(const Op *a, const Op *b)
+{
+  return a->target.base_oid == b->target.base_oid &&
+    a->target.base_oloc == b->target.base_oloc;
+}
+
+unsigned Objecter::_coalesce_shard_of(const Op *op) const
+{
+  return std::hash<object_t>()(op->target.base_oid) % COALESCE_SHARDS;
+}
+
+std::vector<Objecter::coalesce_batch_t>::iterator
+Objecter::_find_coalesce_batch(coalesce_shard_t& shard, const Op *op)
+{
+  return std::find_if(shard.batches.begin(), shard.batches.end(),
+		      [op](const coalesce_batch_t& b) {
+			return b.oid == op->target.base_oid &&
+			  b.oloc == op->target.base_oloc;
+		      });
+}
+
+std::vector<Objecter::coalesce_batch_t>::iterator
+Objecter::_wait_coalesce_batch(coalesce_shard_t& shard,
+			       std::unique_lock<ceph::mutex>& l,
+			       const Op *op)
+{
+  auto b = _find_coalesce_batch(shard, op);
+  while (b != shard.batches.end() && b->sending) {
+    shard.cond.wait(l);
+    b = _find_coalesce_batch(shard, op);
+  }
+  return b;
+}
+
+bool Objecter::_maybe_coalesce_read(Op *op, ceph_tid_t *ptid)
+{
+  if (!_is_coalescable_read(op))
+    return false;
+
+  unsigned shard_index = _coalesce_shard_of(op);
+  auto& shard = coalesce_shards[shard_index];
+  if (coalesce_stopped)
+    return false;
+
+  // take the budget now: the batch is sent from the timer thread, which
+  // must not block on the throttle
+  {
+    shunique_lock rl(rwlock, ceph::acquire_shared);
+    _take_op_budget(op, rl);
+  }
+
+  // the tid of a coalesced read cannot be used to cancel it; it only
+  // identifies the op in the log
+  op->tid = ++last_tid;
+  if (ptid)
+    *ptid = op->tid;
+  op->trace.event("op coalesce");
+  ldout(cct, 20) << __func__ << " tid " << op->tid << " "
+		 << op->target.base_oid << " " << op->ops << dendl;
+
+  std::unique_lock l(shard.lock);
+  auto b = _wait_coalesce_batch(shard, l, op);
+  if (b != shard.batches.end() && !_can_coalesce(b->ops.front(), op)) {
+    // op cannot join the reads before it; they go first
+    _send_coalesce_batch(shard, l, b);
+    b = _wait_coalesce_batch(shard, l, op);
+  }
+  if (coalesce_stopped) {
+    // shut down while we were waiting; we still hold our budget
+    l.unlock();
+    shunique_lock rl(rwlock, ceph::acquire_shared);
+    ceph_tid_t tid = op->tid;
+    _op_submit_with_budget(op, rl, &tid);
+    return true;
+  }
+  if (b == shard.batches.end()) {
+    b = shard.batches.emplace(shard.batches.end());
+    b->id = ++shard.last_id;
+    b->oid = op->target.base_oid;
+    b->oloc = op->target.base_oloc;
+    coalesce_timer->add_event(
+      read_coalesce_window,
+      [this, shard_index, id = b->id] {
+	_flush_coalesced_reads(shard_index, id);
+      });
+  }
+  b->ops.push_back(op);
+  b->bytes += op->ops[0].op.extent.length;
+  if (b->ops.size() >= read_coalesce_max_ops ||
+      b->bytes >= read_coalesce_max_bytes) {
+    _send_coalesce_batch(shard, l, b);
+  }
+  return true;
+}
+
+void Objecter::_send_coalesce_batch(coalesce_shard_t& shard,
+				    std::unique_lock<ceph::mutex>& l,
+				    std::vector<coalesce_batch_t>::iterator b)
+{
+  ceph_assert(!b->sending);
+  b->sending = true;
+  uint64_t id = b->id;
+  auto ops = std::move(b->ops);
+  l.unlock();
+  _send_coalesced_reads(std::move(ops));
+  l.lock();
+  // the batches may have moved meanwhile
+  for (auto p = shard.batches.begin(); p != shard.batches.end(); ++p) {
+    if (p->id == id) {
+      shard.batches.erase(p);
+      break;
+    }
+  }
+  shard.cond.notify_all();
+}
+
+void Objecter::_flush_coalesced_reads(unsigned shard_index, uint64_t id)
+{
+  auto& shard = coalesce_shards[shard_index];
+  std::unique_lock l(shard.lock);
+  for (auto b = shard.batches.begin(); b != shard.batches.end(); ++b) {
+    if (b->id == id) {
+      if (!b->sending) {
+	_send_coalesce_batch(shard, l, b);
+      }
+      break;
+    }
+  }
+}
+
+void Objecter::_flush_coalesced_reads(const Op *op)
+{
+  auto& shard = coalesce_shards[_coalesce_shard_of(op)];
+  std::unique_lock l(shard.lock);
+  auto b = _wait_coalesce_batch(shard, l, op);
+  if (b != shard.batches.end()) {
+    ldout(cct, 20) << __func__ << " " << op->target.base_oid << " "
+		   << b->ops.size() << " parked reads" << dendl;
+    _send_coalesce_batch(shard, l, b);
+  }
+}
+
+void Objecter::_flush_all_coalesced_reads()
+{
+  coalesce_stopped = true;
+  for (auto& shard : coalesce_shards) {
+    std::unique_lock l(shard.lock);
+    while (true) {
+      auto b = std::find_if(shard.batches.begin(), shard.batches.end(),
+			    [](const coalesce_batch_t& b) {
+			      return !b.sending;
+			    });
+      if (b == shard.batches.end()) {
+	break;
+      }
+      _send_coalesce_batch(shard, l, b);
+    }
+    // and those other threads are sending
+    shard.cond.wait(l, [&shard] { return shard.batches.empty(); });
+  }
+}
+
+void Objecter::_send_coalesced_reads(std::vector<Op*>&& ops)
+{
+  if (ops.size() == 1) {
+    // nothing joined it within the window
+    Op *op = ops.front();
+    shunique_lock rl(rwlock, ceph::acquire_shared);
+    ceph_tid_t tid = op->tid;
+    _op_submit_with_budget(op, rl, &tid);
+    return;
+  }
+
+  Op *first = ops.front();
+  auto fin = new C_CoalescedRead;
+  vector<OSDOp> merged_ops;
+  for (auto op : ops) {
+    merged_ops.push_back(op->ops[0]);
+  }
+  Op *merged = new Op(first->target.base_oid, first->target.base_oloc,
+		      merged_ops, first->target.flags, fin, &fin->version);
+  merged->snapid = first->snapid;
+  merged->priority = first->priority;
+  merged->features = first->features;
+  // the merged op returns the bytes of the budgets of the reads, and one
+  // op of it; the others are returned now
+  merged->budget = 0;
+  for (unsigned i = 0; i < ops.size(); ++i) {
+    Op *op = ops[i];
+    merged->out_bl[i] = op->outbl ? op->outbl : op->out_bl[0];
+    merged->out_rval[i] = op->out_rval[0];
+    merged->out_handler[i] = op->out_handler[0];
+    op->out_handler[0] = nullptr;
+    fin->onfinish.push_back(op->onfinish);
+    fin->objver.push_back(op->objver);
+    op->onfinish = nullptr;
+    merged->budget += op->budget;
+    op->budget = -1;
+    op->put();
+  }
+  op_throttle_ops.put(ops.size() - 1);
+  ldout(cct, 10) << __func__ << " " << merged->target.base_oid << " "
+		 << merged->ops << dendl;
+  logger->inc(l_osdc_op_coalesced, ops.size());
+  logger->inc(l_osdc_op_coalesce_send);
+  shunique_lock rl(rwlock, ceph::acquire_shared);
+  ceph_tid_t tid = 0;
+  merged->trace.event("op submit");
+  _op_submit_with_budget(merged, rl, &tid);
+}
+
 void Objecter::_send_op_account(Op *op)
 {
   inflight_ops++;
@@ -4998,7 +5349,13 @@ Objecter::Objecter(CephContext *cct_, Messenger *m, MonClient *mc,
 		    cct->_conf->objecter_inflight_op_bytes),
   op_throttle_ops(cct, "objecter_ops", cct->_conf->objecter_inflight_ops),
   retry_writes_after_first_reply(cct->_conf->objecter_retry_writes_after_first_reply)
-{}
+{
+  if (cct->_conf.get_val<bool>("objecter_crush_cache")) {
+    crush_cache_stats = std::make_shared<CrushResultCache::stats_t>();
+    osdmap->enable_crush_cache(crush_cache_stats);
+  }
+  want_range_incremental = cct->_conf.get_val<bool>("objecter_range_incremental");
+}
 
 Objecter::~Objecter()
 {
@@ -15,11 +15,13 @@
 #ifndef CEPH_OBJECTER_H
 #define CEPH_OBJECTER_H
 
+#include <array>
 #include <condition_variable>
 #include <list>
 #include <map>
 #include <mutex>
 #include <memory>
+#include <optional>
 #include <sstream>
 #include <type_traits>
 
@@ -34,6 +36,7 @@
 #include "common/ceph_time.h"
 #include "common/ceph_timer.h"
 #include "common/config_obs.h"
+#include "common/sharded_shared_mutex.h"
 #include "common/shunique_lock.h"
 #include "common/zipkin_trace.h"
 #include "common/Finisher.h"
@@ -1273,7 +1276,7 @@ private:
                : epoch(epoch), up(up), up_primary(up_primary),
                  acting(acting), acting_primary(acting_primary) {}
   };
-  std::shared_mutex pg_mapping_lock;
+  ceph::sharded_shared_mutex<> pg_mapping_lock;
   // pool -> pg mapping
   std::map<int64_t, std::vector<pg_mapping_t>> pg_mappings;
 
@@ -1324,11 +1327,14 @@ public:
 private:
 
   void _maybe_request_map();
+  bool _apply_range_incremental(class MOSDMap *m);
 
   version_t last_seen_osdmap_version = 0;
   version_t last_seen_pgmap_version = 0;
 
-  mutable std::shared_mutex rwlock;
+  // taken shared on every op submission, so readers must not share a
+  // cache line; writers (map updates, cancellation) are comparatively rare
+  mutable ceph::sharded_shared_mutex<> rwlock;
   using lock_guard = std::lock_guard<decltype(rwlock)>;
   using unique_lock = std::unique_lock<decltype(rwlock)>;
   using shared_lock = boost::shared_lock<decltype(rwlock)>;
@@ -1336,11 +1342,16 @@ private:
   ceph::timer<ceph::coarse_mono_clock> timer;
 
   PerfCounters *logger = nullptr;
+  /// hits and misses of our osdmap's crush cache, if enabled
+  std::shared_ptr<CrushResultCache::stats_t> crush_cache_stats;
+  /// subscribe to osdmap range incrementals; cleared once one fails to apply
+  bool want_range_incremental = false;
 
   uint64_t tick_event = 0;
 
   void start_tick();
   void tick();
+  void update_crush_cache_counters();
   void update_crush_location();
 
   class RequestStateHook;
@@ -2045,7 +2056,7 @@ public:
   }
 
 private:
-  void _check_op_pool_dne(Op *op, unique_lock *sl);
+  void _check_op_pool_dne(Op *op, OSDSession::unique_lock *sl);
   void _send_op_map_check(Op *op);
   void _op_cancel_map_check(Op *op);
   void _check_linger_pool_dne(LingerOp *op, bool *need_unregister);
@@ -2145,6 +2156,12 @@ private:
   void set_pool_full_try() { pool_full_try = true; }
   void unset_pool_full_try() { pool_full_try = false; }
 
+  /**
+   * Never subscribe to osdmap range incrementals.  Call before
+   * start(); the OSD needs every epoch and shares our subscription.
+   */
+  void unset_range_incremental() { want_range_incremental = false; }
+
   void _scan_requests(
     OSDSession *s,
     bool skipped_map,
@@ -2215,6 +2232,79 @@ private:
   void _op_submit_with_budget(Op *op, shunique_lock& lc,
 			      ceph_tid_t *ptid,
 			      int *ctx_budget = NULL);
+
+  // read coalescing: small reads of the same object submitted within
+  // objecter_read_coalesce_window_us are sent as a single multi-op
+  // MOSDOp, and the reply is split back to the callers.
+  struct C_CoalescedRead : public Context {
+    std::vector<Context*> onfinish;
+    std::vector<version_t*> objver;
+    version_t version = 0;
+    void finish(int r) override {
+      for (unsigned i = 0; i < onfinish.size(); ++i) {
+	if (objver[i])
+	  *objver[i] = version;
+	if (onfinish[i])
+	  onfinish[i]->complete(r);
+      }
+    }
+  };
+  struct coalesce_batch_t {
+    uint64_t id = 0;
+    object_t oid;
+    object_locator_t oloc;
+    std::vector<Op*> ops;
+    uint64_t bytes = 0;
+    /// ops are on their way out, without the shard lock
+    bool sending = false;
+  };
+  struct coalesce_shard_t {
+    ceph::mutex lock = ceph::make_mutex("Objecter::coalesce_shard_t::lock");
+    /// a batch was sent
+    ceph::condition_variable cond;
+    uint64_t last_id = 0;
+    std::vector<coalesce_batch_t> batches;
+  };
+  static constexpr unsigned COALESCE_SHARDS = 16;
+  std::array<coalesce_shard_t, COALESCE_SHARDS> coalesce_shards;
+  /// fires the window of each batch; only exists when coalescing is on,
+  /// and lives as long as we do since submitters test it unlocked
+  std::optional<ceph::timer<ceph::mono_clock>> coalesce_timer;
+  /// set on shutdown; checked under the shard lock before parking
+  std::atomic<bool> coalesce_stopped = false;
+  std::chrono::microseconds read_coalesce_window{0};
+  uint64_t read_coalesce_max_ops = 0;
+  uint64_t read_coalesce_max_bytes = 0;
+
+  // there is at most one batch per object.  A batch is sent without the
+  // shard lock, since rwlock comes first, but it stays in its shard until
+  // it is out, and any op of its object waits for that.  so the ops of
+  // an object go out in the order they were submitted
+  bool _is_coalescable_read(const Op *op) const;
+  static bool _can_coalesce(const Op *a, const Op *b);
+  static bool _same_object(const Op *a, const Op *b);
+  unsigned _coalesce_shard_of(const Op *op) const;
+  /// the batch of op's object in shard, or batches.end()
+  static std::vector<coalesce_batch_t>::iterator _find_coalesce_batch(
+    coalesce_shard_t& shard, const Op *op);
+  /// wait until the batch of op's object, if any, is not being sent
+  static std::vector<coalesce_batch_t>::iterator _wait_coalesce_batch(
+    coalesce_shard_t& shard, std::unique_lock<ceph::mutex>& l,
+    const Op *op);
+  /// park op in a coalescing batch, return false if it must be sent alone
+  bool _maybe_coalesce_read(Op *op, ceph_tid_t *ptid);
+  /// send batch id of shard, if its window has not been cut short
+  void _flush_coalesced_reads(unsigned shard, uint64_t id);
+  /// send the batch of op's object, if any, before op
+  void _flush_coalesced_reads(const Op *op);
+  void _flush_all_coalesced_reads();
+  /// send batch b of shard, dropping l meanwhile
+  void _send_coalesce_batch(coalesce_shard_t& shard,
+			    std::unique_lock<ceph::mutex>& l,
+			    std::vector<coalesce_batch_t>::iterator b);
+  /// send the ops of a batch, which already hold their budget
+  void _send_coalesced_reads(std::vector<Op*>&& ops);
+
   // public interface
 public:
   void op_submit(Op *op, ceph_tid_t *ptid = NULL, int *ctx_budget = NULL);
@@ -1250,6 +1250,22 @@ class MgrModule(ceph_module.BaseMgrModule):
 
         return result
 
+    def get_all_perf_counters_prometheus(self, prio_limit=PRIO_USEFUL,
+                                         services=("mds", "mon", "osd",
+                                                   "rbd-mirror", "rgw",
+                                                   "tcmu-runner")):
+        """
+        Like `get_all_perf_counters`, but return the latest values
+        rendered by ceph-mgr in the Prometheus text exposition format,
+        with the metric names and labels the prometheus module uses.
+        Long running averages become a `_sum` and a `_count` metric, and
+        histograms are left out.
+
+        :return: bytes
+        """
+        return self._ceph_get_perf_counters_prometheus(prio_limit,
+                                                       list(services))
+
     def set_uri(self, uri):
         """
         If the module exposes a service, then call this to publish the
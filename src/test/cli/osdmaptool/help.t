@@ -8,6 +8,8 @@
      --clobber               allows osdmaptool to overwrite <mapfilename> if it already exists
      --export-crush <file>   write osdmap's crush map to <file>
      --import-crush <file>   replace osdmap's crush map with <file>
+     --export-snapshot <file> write osdmap and its pg mappings as a snapshot to <file>
+     --snapshot              <mapfilename> is a snapshot, map it read-only
      --health                dump health checks
      --test-map-pgs [--pool <poolid>] [--pg_num <pg_num>] [--range-first <first> --range-last <last>] map all pgs
      --test-map-pgs-dump [--pool <poolid>] [--range-first <first> --range-last <last>] map all pgs
@@ -0,0 +1,18 @@
+  $ osdmaptool --createsimple 3 myosdmap --with-default-pool
+  osdmaptool: osdmap file 'myosdmap'
+  osdmaptool: writing epoch 1 to myosdmap
+  $ osdmaptool --export-snapshot mysnap myosdmap
+  osdmaptool: osdmap file 'myosdmap'
+  osdmaptool: exported epoch 1 snapshot to mysnap
+  $ osdmaptool --test-map-pgs-dump myosdmap > plain.out
+  osdmaptool: osdmap file 'myosdmap'
+  $ osdmaptool --snapshot --test-map-pgs-dump mysnap > snap.out
+  osdmaptool: osdmap file 'mysnap'
+  $ cmp plain.out snap.out
+  $ osdmaptool --snapshot --print mysnap | grep ^epoch
+  osdmaptool: osdmap file 'mysnap'
+  epoch 1
+  $ osdmaptool --snapshot myosdmap --print
+  osdmaptool: osdmap file 'myosdmap'
+  osdmaptool: couldn't open myosdmap: (22) Invalid argument
+  [255]
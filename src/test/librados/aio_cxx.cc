@@ -2330,6 +2330,79 @@ TEST(LibRadosAio, RacingRemovePP) {
   delete my_completion2;
 }
 
+TEST(LibRadosAio, CoalescedReadsPP) {
+  AioTestDataPP test_data;
+  // a long window so that all reads below land in one batch
+  ASSERT_EQ("", test_data.init({{"objecter_read_coalesce_window_us", "20000"},
+				{"objecter_read_coalesce_max_ops", "16"}}));
+  char buf[8192];
+  for (unsigned i = 0; i < sizeof(buf); ++i) {
+    buf[i] = i % 251;
+  }
+  bufferlist bl;
+  bl.append(buf, sizeof(buf));
+  ASSERT_EQ(0, test_data.m_ioctx.write_full("foo", bl));
+
+  const unsigned num = 8;
+  AioCompletion *completions[num + 1];
+  bufferlist bls[num + 1];
+  for (unsigned i = 0; i < num; ++i) {
+    completions[i] = test_data.m_cluster.aio_create_completion(nullptr, nullptr);
+    // adjacent, overlapping and past-the-end extents
+    ASSERT_EQ(0, test_data.m_ioctx.aio_read("foo", completions[i], &bls[i],
+					    1024, i * 1000 + 512));
+  }
+  completions[num] = test_data.m_cluster.aio_create_completion(nullptr, nullptr);
+  ASSERT_EQ(0, test_data.m_ioctx.aio_read("nonexistent", completions[num],
+					  &bls[num], 1024, 0));
+  {
+    TestAlarm alarm;
+    for (auto c : completions) {
+      ASSERT_EQ(0, c->wait_for_complete());
+    }
+  }
+  for (unsigned i = 0; i < num; ++i) {
+    uint64_t off = i * 1000 + 512;
+    uint64_t len = std::min<uint64_t>(1024, sizeof(buf) - off);
+    ASSERT_EQ((int)len, completions[i]->get_return_value()) << i;
+    ASSERT_EQ(len, bls[i].length());
+    ASSERT_EQ(0, memcmp(bls[i].c_str(), buf + off, len));
+  }
+  ASSERT_EQ(-ENOENT, completions[num]->get_return_value());
+  for (auto c : completions) {
+    c->release();
+  }
+}
+
+TEST(LibRadosAio, CoalescedReadsOrderPP) {
+  AioTestDataPP test_data;
+  // a window long enough that the write below would overtake the read
+  // if it were not sent first
+  ASSERT_EQ("", test_data.init({{"objecter_read_coalesce_window_us",
+				 "500000"}}));
+  bufferlist old_bl, new_bl;
+  old_bl.append(std::string(4096, 'a'));
+  new_bl.append(std::string(4096, 'b'));
+  ASSERT_EQ(0, test_data.m_ioctx.write_full("foo", old_bl));
+
+  AioCompletion *read = test_data.m_cluster.aio_create_completion(
+    nullptr, nullptr);
+  AioCompletion *write = test_data.m_cluster.aio_create_completion(
+    nullptr, nullptr);
+  bufferlist bl;
+  ASSERT_EQ(0, test_data.m_ioctx.aio_read("foo", read, &bl, 4096, 0));
+  ASSERT_EQ(0, test_data.m_ioctx.aio_write_full("foo", write, new_bl));
+  {
+    TestAlarm alarm;
+    ASSERT_EQ(0, write->wait_for_complete());
+    ASSERT_EQ(0, read->wait_for_complete());
+  }
+  ASSERT_EQ(4096, read->get_return_value());
+  ASSERT_TRUE(bl.contents_equal(old_bl));
+  read->release();
+  write->release();
+}
+
 TEST(LibRadosAio, RoundTripCmpExtPP) {
   AioTestDataPP test_data;
   ASSERT_EQ("", test_data.init());
@@ -0,0 +1,187 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Multi-threaded op submission benchmark.
+ *
+ * Measures how the client side of op submission (target calculation,
+ * Objecter locking, session assignment) scales with the number of
+ * submitting threads.  The cluster is paused while ops are submitted so
+ * that they queue in the Objecter without being sent, and only the
+ * submission is timed; the ops are drained after unpausing.
+ *
+ *   ceph_test_rados_submit_bench [--threads N] [--ops N] [--objects N]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/errno.h"
+#include "include/rados/librados.hpp"
+#include "test/librados/test_cxx.h"
+
+using namespace librados;
+
+namespace {
+
+int osd_pause(Rados& cluster, bool pause)
+{
+  bufferlist inbl, outbl;
+  std::string outs;
+  std::string cmd = pause ? "{\"prefix\": \"osd pause\"}" :
+    "{\"prefix\": \"osd unpause\"}";
+  int r = cluster.mon_command(cmd, inbl, &outbl, &outs);
+  if (r < 0) {
+    std::cerr << cmd << " failed: " << outs << std::endl;
+    return r;
+  }
+  return cluster.wait_for_latest_osdmap();
+}
+
+struct stat_op_t {
+  AioCompletion *c = nullptr;
+  uint64_t size = 0;
+  time_t mtime = 0;
+};
+
+// submit ops_per_thread stats from each of num_threads threads, return
+// the time it took in seconds
+double run(IoCtx& ioctx, const std::vector<std::string>& oids,
+	   unsigned num_threads, unsigned ops_per_thread,
+	   std::vector<std::vector<stat_op_t>> *ops)
+{
+  ops->assign(num_threads, std::vector<stat_op_t>(ops_per_thread));
+  std::atomic<unsigned> ready = {0};
+  std::atomic<bool> go = {false};
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      auto& mine = (*ops)[t];
+      for (auto& op : mine) {
+	op.c = Rados::aio_create_completion();
+      }
+      ++ready;
+      while (!go) {
+	std::this_thread::yield();
+      }
+      for (unsigned i = 0; i < ops_per_thread; ++i) {
+	auto& op = mine[i];
+	ioctx.aio_stat(oids[(t * 7919 + i) % oids.size()], op.c,
+		       &op.size, &op.mtime);
+      }
+    });
+  }
+  while (ready < num_threads) {
+    std::this_thread::yield();
+  }
+  auto start = std::chrono::steady_clock::now();
+  go = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+void drain(std::vector<std::vector<stat_op_t>> *ops)
+{
+  for (auto& thread_ops : *ops) {
+    for (auto& op : thread_ops) {
+      op.c->wait_for_complete();
+      op.c->release();
+    }
+  }
+  ops->clear();
+}
+
+} // anonymous namespace
+
+int main(int argc, const char **argv)
+{
+  unsigned max_threads = 32;
+  unsigned ops_per_thread = 20000;
+  unsigned num_objects = 1024;
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 < argc && strcmp(argv[i], "--threads") == 0) {
+      max_threads = std::stoul(argv[++i]);
+    } else if (i + 1 < argc && strcmp(argv[i], "--ops") == 0) {
+      ops_per_thread = std::stoul(argv[++i]);
+    } else if (i + 1 < argc && strcmp(argv[i], "--objects") == 0) {
+      num_objects = std::stoul(argv[++i]);
+    } else {
+      std::cerr << "usage: " << argv[0]
+		<< " [--threads N] [--ops N] [--objects N]" << std::endl;
+      return 1;
+    }
+  }
+
+  Rados cluster;
+  std::string pool_name = get_temp_pool_name("submit-bench-");
+  // paused ops stay in flight until the end of a round
+  std::string err = create_one_pool_pp(pool_name, cluster,
+				       {{"objecter_inflight_ops", "0"},
+					{"objecter_inflight_op_bytes", "0"}});
+  if (!err.empty()) {
+    std::cerr << err << std::endl;
+    return 1;
+  }
+  IoCtx ioctx;
+  int r = cluster.ioctx_create(pool_name.c_str(), ioctx);
+  if (r < 0) {
+    std::cerr << "ioctx_create: " << cpp_strerror(r) << std::endl;
+    destroy_one_pool_pp(pool_name, cluster);
+    return 1;
+  }
+  std::vector<std::string> oids;
+  bufferlist bl;
+  bl.append(std::string(4096, 'x'));
+  for (unsigned i = 0; i < num_objects; ++i) {
+    oids.push_back("submit_bench_" + std::to_string(i));
+    r = ioctx.write_full(oids.back(), bl);
+    if (r < 0) {
+      std::cerr << "write_full: " << cpp_strerror(r) << std::endl;
+      destroy_one_pool_pp(pool_name, cluster);
+      return 1;
+    }
+  }
+
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "submits/s"
+	    << std::setw(10) << "scaling" << std::endl;
+  double base = 0;
+  std::vector<std::vector<stat_op_t>> ops;
+  for (unsigned n = 1; n <= max_threads; n *= 2) {
+    r = osd_pause(cluster, true);
+    if (r < 0)
+      break;
+    double secs = run(ioctx, oids, n, ops_per_thread, &ops);
+    r = osd_pause(cluster, false);
+    if (r < 0)
+      break;
+    drain(&ops);
+    double rate = (double)n * ops_per_thread / secs;
+    if (n == 1)
+      base = rate;
+    std::cout << std::setw(8) << n << std::setw(16) << std::fixed
+	      << std::setprecision(0) << rate << std::setw(10)
+	      << std::setprecision(2) << rate / base << std::endl;
+  }
+
+  ioctx.close();
+  destroy_one_pool_pp(pool_name, cluster);
+  return r < 0 ? 1 : 0;
+}
@@ -0,0 +1,150 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "messages/MMgrReport.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+PerfCounterValue mk_value(uint64_t v, uint64_t avgcount = 0,
+			  uint64_t avgcount2 = 0)
+{
+  PerfCounterValue r;
+  r.v = v;
+  r.avgcount = avgcount;
+  r.avgcount2 = avgcount2;
+  return r;
+}
+
+// encode the changes from prev to cur as a report would, apply them to
+// a copy of prev and return it
+std::vector<PerfCounterValue> round_trip(
+  const std::vector<PerfCounterValue>& prev,
+  const std::vector<PerfCounterValue>& cur,
+  bool avg,
+  size_t *encoded_len = nullptr)
+{
+  ceph::buffer::list bl;
+  uint32_t num_changed = 0;
+  uint64_t next_idx = 0;
+  for (uint64_t i = 0; i < cur.size(); ++i) {
+    if (cur[i] != prev[i]) {
+      cur[i].encode_delta(prev[i], i - next_idx, avg, bl);
+      next_idx = i + 1;
+      ++num_changed;
+    }
+  }
+  if (encoded_len) {
+    *encoded_len = bl.length();
+  }
+
+  std::vector<PerfCounterValue> r = prev;
+  if (!num_changed) {
+    return r;
+  }
+  bl.c_str();
+  ceph::buffer::ptr bp = bl.front();
+  auto p = bp.cbegin();
+  uint64_t gap;
+  denc_varint(gap, p);
+  uint64_t idx = gap;
+  while (true) {
+    r[idx].decode_delta(avg, p);
+    if (--num_changed == 0) {
+      break;
+    }
+    denc_varint(gap, p);
+    idx += 1 + gap;
+  }
+  EXPECT_EQ(p.get_offset(), bl.length());
+  return r;
+}
+
+} // anonymous namespace
+
+TEST(PerfCounterValue, zigzag)
+{
+  const uint64_t max = std::numeric_limits<uint64_t>::max();
+  for (auto [from, to] : std::vector<std::pair<uint64_t, uint64_t>>{
+	 {0, 0}, {0, 1}, {1, 0}, {5, 1000}, {1000, 5},
+	 {0, max}, {max, 0}, {max - 1, max}, {1ull << 63, 0}, {0, 1ull << 63}}) {
+    EXPECT_EQ(to, PerfCounterValue::unzigzag(
+		from, PerfCounterValue::zigzag(from, to)))
+      << from << " -> " << to;
+  }
+  // small steps either way stay small
+  EXPECT_EQ(2u, PerfCounterValue::zigzag(10, 11));
+  EXPECT_EQ(1u, PerfCounterValue::zigzag(11, 10));
+}
+
+TEST(PerfCounterValue, delta)
+{
+  std::mt19937 rng(42);
+  for (bool avg : {false, true}) {
+    std::vector<PerfCounterValue> prev(500), cur;
+    for (int round = 0; round < 50; ++round) {
+      cur = prev;
+      for (auto& c : cur) {
+	switch (rng() % 4) {
+	case 0:
+	  c.v += rng() % 100;     // counter
+	  break;
+	case 1:
+	  c.v = rng();            // gauge, up or down
+	  break;
+	default:
+	  continue;               // unchanged
+	}
+	if (avg) {
+	  c.avgcount += 1;
+	  c.avgcount2 = c.avgcount;
+	}
+      }
+      ASSERT_EQ(cur, round_trip(prev, cur, avg));
+      prev = cur;
+    }
+  }
+}
+
+TEST(PerfCounterValue, delta_is_compact)
+{
+  // the usual report: most counters idle, a few ticking up slowly
+  std::vector<PerfCounterValue> prev, cur;
+  for (unsigned i = 0; i < 1000; ++i) {
+    prev.push_back(mk_value(1000000 + i));
+  }
+  cur = prev;
+  for (unsigned i = 0; i < cur.size(); i += 10) {
+    cur[i].v += 3;
+  }
+  size_t len = 0;
+  ASSERT_EQ(cur, round_trip(prev, cur, false, &len));
+  // one byte of gap and one of delta each, where a full report takes
+  // eight bytes for every counter
+  EXPECT_EQ(2u * 100, len);
+  EXPECT_EQ(cur, round_trip(cur, cur, false, &len));
+  EXPECT_EQ(0u, len);
+}
+
+TEST(PerfCounterValue, delta_avg)
+{
+  std::vector<PerfCounterValue> prev = {mk_value(100, 10, 10),
+					mk_value(0, 0, 0)};
+  std::vector<PerfCounterValue> cur = {mk_value(100, 10, 10),
+				       mk_value(5000, 7, 7)};
+  EXPECT_EQ(cur, round_trip(prev, cur, true));
+}
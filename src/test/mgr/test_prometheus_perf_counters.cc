@@ -0,0 +1,212 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <chrono>
+#include <iostream>
+
+#include "mgr/PrometheusPerfCounters.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+void add_type(PerfCounterTypes &types, const std::string &path,
+	      perfcounter_type_d type, const std::string &desc,
+	      uint8_t prio = PerfCountersBuilder::PRIO_USEFUL)
+{
+  PerfCounterType t;
+  t.path = path;
+  t.description = desc;
+  t.type = type;
+  t.priority = prio;
+  t.unit = UNIT_NONE;
+  types[path] = t;
+}
+
+DaemonStatePtr add_daemon(DaemonStateIndex &index, const std::string &type,
+			  const std::string &name)
+{
+  auto d = std::make_shared<DaemonState>(index.types);
+  d->key = DaemonKey{type, name};
+  d->hostname = "host" + name;
+  index.insert(d);
+  return d;
+}
+
+// one report setting every counter of d
+void report(DaemonState &d, uint64_t base)
+{
+  std::lock_guard l(d.lock);
+  auto &pc = d.perf_counters;
+  const auto seq = pc.stamps.push(ceph_clock_now());
+  uint64_t i = 0;
+  for (const auto &[path, t] : pc.types) {
+    auto p = pc.instances.find(path);
+    if (p == pc.instances.end()) {
+      p = pc.instances.emplace(path, t.type).first;
+    }
+    if (t.type & PERFCOUNTER_LONGRUNAVG) {
+      p->second.push_avg(seq, base + i, i + 1);
+    } else {
+      p->second.push(seq, base + i);
+    }
+    ++i;
+  }
+  ++pc.version;
+}
+
+bool contains(const std::string &s, const std::string &what)
+{
+  return s.find(what) != std::string::npos;
+}
+
+} // anonymous namespace
+
+TEST(PrometheusPerfCounters, render)
+{
+  DaemonStateIndex index;
+  add_type(index.types, "osd.op_w", (perfcounter_type_d)
+	   (PERFCOUNTER_U64 | PERFCOUNTER_COUNTER), "Client write operations");
+  add_type(index.types, "osd.numpg", PERFCOUNTER_U64, "Placement groups");
+  add_type(index.types, "osd.op_w_latency", (perfcounter_type_d)
+	   (PERFCOUNTER_TIME | PERFCOUNTER_LONGRUNAVG), "Latency of writes");
+  add_type(index.types, "osd.op_w_hist", (perfcounter_type_d)
+	   (PERFCOUNTER_U64 | PERFCOUNTER_HISTOGRAM), "Histogram");
+  add_type(index.types, "osd.debug", PERFCOUNTER_U64, "Debugging",
+	   PerfCountersBuilder::PRIO_DEBUGONLY);
+  add_type(index.types,
+	   "rbd_mirror_pool/ns/image.replay_bytes", (perfcounter_type_d)
+	   (PERFCOUNTER_U64 | PERFCOUNTER_COUNTER), "Replayed bytes");
+
+  auto osd0 = add_daemon(index, "osd", "0");
+  auto osd1 = add_daemon(index, "osd", "1");
+  auto mirror = add_daemon(index, "rbd-mirror", "a");
+  report(*osd0, 1000000000);
+  report(*osd1, 2000000000);
+  report(*mirror, 0);
+
+  PrometheusPerfCounters prom;
+  auto out = prom.render(index, PerfCountersBuilder::PRIO_USEFUL,
+			 {"osd", "rbd-mirror"});
+
+  // the layout of the prometheus module: HELP and TYPE, then a sample
+  // per daemon
+  EXPECT_TRUE(contains(out,
+    "\n# HELP ceph_osd_op_w Client write operations"
+    "\n# TYPE ceph_osd_op_w counter"
+    "\nceph_osd_op_w{ceph_daemon=\"osd.0\"} 1000000002"
+    "\nceph_osd_op_w{ceph_daemon=\"osd.1\"} 2000000002"
+    "\nceph_osd_op_w{ceph_daemon=\"rbd-mirror.a\"} 2")) << out;
+  EXPECT_TRUE(contains(out, "\n# TYPE ceph_osd_numpg gauge")) << out;
+  // a long running average is a sum, in seconds, and a count
+  EXPECT_TRUE(contains(out,
+    "\n# HELP ceph_osd_op_w_latency_sum Latency of writes Total"
+    "\n# TYPE ceph_osd_op_w_latency_sum counter"
+    "\nceph_osd_op_w_latency_sum{ceph_daemon=\"osd.0\"} 1.000000004")) << out;
+  EXPECT_TRUE(contains(out,
+    "\nceph_osd_op_w_latency_count{ceph_daemon=\"osd.1\"} 5")) << out;
+  EXPECT_FALSE(contains(out, "op_w_hist")) << out;
+  EXPECT_FALSE(contains(out, "ceph_osd_debug")) << out;
+  EXPECT_TRUE(contains(out,
+    "\nceph_rbd_mirror_replay_bytes{ceph_daemon=\"rbd-mirror.a\","
+    "pool=\"pool\",namespace=\"ns\",image=\"image\"} 5")) << out;
+
+  // unchanged daemons render the same, changed ones are picked up
+  EXPECT_EQ(out, prom.render(index, PerfCountersBuilder::PRIO_USEFUL,
+			     {"osd", "rbd-mirror"}));
+  report(*osd1, 3000000000);
+  out = prom.render(index, PerfCountersBuilder::PRIO_USEFUL,
+		    {"osd", "rbd-mirror"});
+  EXPECT_TRUE(contains(out,
+    "\nceph_osd_op_w{ceph_daemon=\"osd.1\"} 3000000002")) << out;
+
+  // filtering by priority and service
+  out = prom.render(index, PerfCountersBuilder::PRIO_DEBUGONLY, {"osd"});
+  EXPECT_TRUE(contains(out, "ceph_osd_debug")) << out;
+  EXPECT_FALSE(contains(out, "rbd-mirror.a")) << out;
+
+  // daemons that are gone are dropped
+  index.rm(DaemonKey{"osd", "0"});
+  out = prom.render(index, PerfCountersBuilder::PRIO_USEFUL, {"osd"});
+  EXPECT_FALSE(contains(out, "osd.0")) << out;
+  EXPECT_TRUE(contains(out, "osd.1")) << out;
+}
+
+TEST(PrometheusPerfCounters, names)
+{
+  DaemonStateIndex index;
+  // hyphens become underscores unless one is trailing, in which case
+  // only that one is spelled out, as the prometheus module does
+  add_type(index.types, "mds.inode-max", PERFCOUNTER_U64, "Inode max");
+  add_type(index.types, "mds.cap-revoke-", PERFCOUNTER_U64, "Caps");
+  add_type(index.types, "mds.rd+wr", PERFCOUNTER_U64, "Ops");
+  add_type(index.types, "mds.a::b c", PERFCOUNTER_U64, "Scoped");
+
+  auto mds = add_daemon(index, "mds", "a");
+  report(*mds, 0);
+
+  PrometheusPerfCounters prom;
+  auto out = prom.render(index, PerfCountersBuilder::PRIO_USEFUL, {"mds"});
+  EXPECT_TRUE(contains(out, "\n# TYPE ceph_mds_inode_max gauge")) << out;
+  EXPECT_TRUE(contains(out, "\n# TYPE ceph_mds_cap-revoke_minus gauge"))
+    << out;
+  EXPECT_TRUE(contains(out, "\n# TYPE ceph_mds_rd_pluswr gauge")) << out;
+  EXPECT_TRUE(contains(out, "\n# TYPE ceph_mds_a_b_c gauge")) << out;
+}
+
+TEST(PrometheusPerfCounters, bench)
+{
+  // a large cluster: 3000 osds with a few hundred counters each
+  const int num_osds = 3000;
+  const int num_counters = 300;
+  DaemonStateIndex index;
+  for (int i = 0; i < num_counters; ++i) {
+    std::string path = "osd.counter_" + std::to_string(i);
+    switch (i % 3) {
+    case 0:
+      add_type(index.types, path, (perfcounter_type_d)
+	       (PERFCOUNTER_U64 | PERFCOUNTER_COUNTER), "A counter");
+      break;
+    case 1:
+      add_type(index.types, path, PERFCOUNTER_U64, "A gauge");
+      break;
+    case 2:
+      add_type(index.types, path, (perfcounter_type_d)
+	       (PERFCOUNTER_TIME | PERFCOUNTER_LONGRUNAVG), "A latency");
+      break;
+    }
+  }
+  std::vector<DaemonStatePtr> osds;
+  for (int i = 0; i < num_osds; ++i) {
+    osds.push_back(add_daemon(index, "osd", std::to_string(i)));
+    report(*osds.back(), i * 1000);
+  }
+
+  PrometheusPerfCounters prom;
+  auto time = [&](const char *what) {
+    auto start = std::chrono::steady_clock::now();
+    auto out = prom.render(index, PerfCountersBuilder::PRIO_USEFUL, {"osd"});
+    auto end = std::chrono::steady_clock::now();
+    std::cout << what << ": "
+	      << std::chrono::duration<double, std::milli>(end - start).count()
+	      << " ms, " << out.size() << " bytes" << std::endl;
+    return out.size();
+  };
+  auto cold = time("all daemons rendered");
+  // a scrape between two reports of every daemon
+  auto warm = time("no daemon changed");
+  for (int i = 0; i < num_osds; i += 10) {
+    report(*osds[i], i * 1000 + 1);
+  }
+  time("a tenth of the daemons changed");
+  EXPECT_EQ(cold, warm);
+}
@@ -0,0 +1,96 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "mgr/PyFormatter.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// a dump the way get_python() makes it: {"epoch": e, "osds": [{"osd": 0}]}
+PyObject *make_dump(int epoch)
+{
+  if (!Py_IsInitialized()) {
+    Py_Initialize();
+  }
+  PyFormatter f;
+  f.dump_int("epoch", epoch);
+  f.open_array_section("osds");
+  f.open_object_section("osd");
+  f.dump_int("osd", 0);
+  f.close_section();
+  f.close_section();
+  return f.get();
+}
+
+bool equal(PyObject *a, PyObject *b)
+{
+  return PyObject_RichCompareBool(a, b, Py_EQ) == 1;
+}
+
+} // anonymous namespace
+
+TEST(PyDumpCache, hit)
+{
+  PyObject *dump = make_dump(5);
+  Py_INCREF(dump);
+  PyDumpCache cache;
+  ASSERT_EQ(nullptr, cache.get("osd_map", {5, 0}));
+
+  // the caller always gets a copy of what is kept
+  PyObject *put = cache.put("osd_map", {5, 0}, dump);
+  ASSERT_NE(nullptr, put);
+  EXPECT_NE(dump, put);
+  EXPECT_TRUE(equal(dump, put));
+
+  PyObject *got = cache.get("osd_map", {5, 0});
+  ASSERT_NE(nullptr, got);
+  EXPECT_NE(dump, got);
+  EXPECT_NE(put, got);
+  EXPECT_TRUE(equal(dump, got));
+
+  // what a module does to its copy is not seen by the next one
+  PyList_Append(PyDict_GetItemString(got, "osds"), Py_None);
+  PyDict_DelItemString(PyList_GET_ITEM(PyDict_GetItemString(put, "osds"), 0),
+		       "osd");
+  PyObject *again = cache.get("osd_map", {5, 0});
+  ASSERT_NE(nullptr, again);
+  EXPECT_TRUE(equal(dump, again));
+
+  Py_DECREF(again);
+  Py_DECREF(got);
+  Py_DECREF(put);
+  Py_DECREF(dump);
+}
+
+TEST(PyDumpCache, invalidation)
+{
+  PyDumpCache cache;
+  Py_DECREF(cache.put("pg_dump", {5, 7}, make_dump(5)));
+
+  // a new epoch or version, or another object, is a miss
+  EXPECT_EQ(nullptr, cache.get("pg_dump", {6, 7}));
+  EXPECT_EQ(nullptr, cache.get("pg_dump", {5, 8}));
+  EXPECT_EQ(nullptr, cache.get("osd_map", {5, 7}));
+
+  // and the dump of the new one replaces the old one
+  PyObject *dump = make_dump(6);
+  Py_INCREF(dump);
+  Py_DECREF(cache.put("pg_dump", {6, 0}, dump));
+  EXPECT_EQ(nullptr, cache.get("pg_dump", {5, 7}));
+  PyObject *got = cache.get("pg_dump", {6, 0});
+  ASSERT_NE(nullptr, got);
+  EXPECT_TRUE(equal(dump, got));
+
+  Py_DECREF(got);
+  Py_DECREF(dump);
+}
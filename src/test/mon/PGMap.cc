@@ -14,7 +14,12 @@
 #include "mon/PGMap.h"
 #include "gtest/gtest.h"
 
+#include <random>
+
+#include "common/ceph_time.h"
+#include "global/global_context.h"
 #include "include/stringify.h"
+#include "osd/OSDMap.h"
 
 
 namespace {
@@ -37,6 +42,56 @@ namespace {
     }
   };
 
+  // an osdmap with num_osd osds of two device classes and one pool
+  void build_osdmap(OSDMap *osdmap, int num_osd, unsigned pg_num) {
+    uuid_d fsid;
+    osdmap->build_simple(g_ceph_context, 0, fsid, num_osd);
+    OSDMap::Incremental inc(osdmap->get_epoch() + 1);
+    inc.fsid = osdmap->get_fsid();
+    for (int i = 0; i < num_osd; ++i) {
+      inc.new_state[i] = CEPH_OSD_EXISTS | CEPH_OSD_NEW | CEPH_OSD_UP;
+      inc.new_weight[i] = CEPH_OSD_IN;
+    }
+    inc.new_pool_max = 1;
+    pg_pool_t empty;
+    pg_pool_t *p = inc.get_new_pool(1, &empty);
+    p->size = 3;
+    p->set_pg_num(pg_num);
+    p->set_pgp_num(pg_num);
+    p->type = pg_pool_t::TYPE_REPLICATED;
+    p->crush_rule = 0;
+    inc.new_pool_names[1] = "pool";
+    osdmap->apply_incremental(inc);
+    std::stringstream ss;
+    for (int i = 0; i < num_osd; ++i) {
+      osdmap->crush->update_device_class(i, i % 2 ? "ssd" : "hdd",
+					 "osd." + stringify(i), &ss);
+    }
+  }
+
+  pg_stat_t mk_pg_stat(std::mt19937& rng, int num_osd) {
+    pg_stat_t s;
+    s.state = rng() % 10 ? PG_STATE_ACTIVE | PG_STATE_CLEAN : 0;
+    for (int i = 0; i < 3; ++i) {
+      s.up.push_back((rng() % num_osd));
+    }
+    s.acting = s.up;
+    s.up_primary = s.acting_primary = s.up[0];
+    s.stats.sum.num_bytes = rng() % 1000000;
+    s.stats.sum.num_objects = rng() % 1000;
+    s.purged_snaps.insert(1, 10 + rng() % 3);
+    return s;
+  }
+
+  osd_stat_t mk_osd_stat(std::mt19937& rng) {
+    osd_stat_t s;
+    s.statfs.total = 1ull << 40;
+    s.statfs.available = rng() % (1ull << 40);
+    s.num_pgs = rng() % 200;
+    s.num_osds = 1;
+    return s;
+  }
+
   // copied from PGMap.cc
   string percentify(float a) {
     stringstream ss;
@@ -164,3 +219,113 @@ TEST(pgmap, dump_object_stat_sum_2)
   ASSERT_EQ(percentify(0), tbl.get(0, col++));
   ASSERT_EQ(stringify(byte_u_t(avail/pool.size)), tbl.get(0, col++));
 }
+
+TEST(pgmap, digest_incremental)
+{
+  const int num_osd = 12;
+  const unsigned pg_num = 256;
+  OSDMap osdmap;
+  build_osdmap(&osdmap, num_osd, pg_num);
+  std::mt19937 rng(42);
+  PGMap pg_map;
+  for (unsigned round = 0; round < 200; ++round) {
+    PGMap::Incremental inc;
+    inc.version = pg_map.version + 1;
+    inc.stamp = utime_t(round + 1, 0);
+    unsigned updates = round == 0 ? pg_num : rng() % 20;
+    for (unsigned i = 0; i < updates; ++i) {
+      pg_t pgid(round == 0 ? i : rng() % pg_num, 1);
+      inc.pg_stat_updates[pgid] = mk_pg_stat(rng, num_osd);
+    }
+    if (round > 0 && rng() % 10 == 0) {
+      inc.pg_remove.insert(pg_t(rng() % pg_num, 1));
+    }
+    for (int osd = 0; osd < num_osd; ++osd) {
+      if (round == 0 || rng() % 4 == 0) {
+	inc.update_stat(osd, mk_osd_stat(rng));
+      }
+    }
+    if (round > 0 && rng() % 20 == 0) {
+      inc.rm_stat(rng() % num_osd);
+    }
+    pg_map.apply_incremental(g_ceph_context, inc);
+    if (round % 50 == 25) {
+      // move an osd to another class
+      int osd = rng() % num_osd;
+      std::stringstream ss;
+      osdmap.crush->remove_device_class(g_ceph_context, osd, &ss);
+      osdmap.crush->update_device_class(osd, "nvme", "osd." + stringify(osd),
+					&ss);
+      osdmap.inc_epoch();
+    }
+    pg_map.update_digest(osdmap);
+    std::stringstream ss;
+    ASSERT_TRUE(pg_map.check_digest(osdmap, &ss))
+      << "round " << round << ": " << ss.str();
+  }
+}
+
+TEST(pgmap, digest_cost)
+{
+  // the cost of the digest fields, recalculated in full and updated
+  // incrementally after 1% of the pgs and all osds report
+  const int num_osd = 100;
+  std::cout << std::setw(10) << "pgs" << std::setw(14) << "full us"
+	    << std::setw(18) << "incremental us" << std::endl;
+  for (unsigned pg_num : {1000u, 10000u, 50000u}) {
+    OSDMap osdmap;
+    build_osdmap(&osdmap, num_osd, pg_num);
+    std::mt19937 rng(pg_num);
+    PGMap pg_map;
+    PGMap::Incremental inc;
+    inc.version = 1;
+    inc.stamp = utime_t(1, 0);
+    for (unsigned ps = 0; ps < pg_num; ++ps) {
+      auto s = mk_pg_stat(rng, num_osd);
+      s.state = PG_STATE_ACTIVE | PG_STATE_CLEAN;
+      inc.pg_stat_updates[pg_t(ps, 1)] = s;
+    }
+    for (int osd = 0; osd < num_osd; ++osd) {
+      inc.update_stat(osd, mk_osd_stat(rng));
+    }
+    pg_map.apply_incremental(g_ceph_context, inc);
+    pg_map.update_digest(osdmap);
+
+    const unsigned rounds = 10;
+    ceph::timespan full = ceph::timespan::zero();
+    ceph::timespan incremental = ceph::timespan::zero();
+    for (unsigned r = 0; r < rounds; ++r) {
+      PGMap::Incremental next;
+      next.version = pg_map.version + 1;
+      next.stamp = utime_t(r + 2, 0);
+      for (unsigned i = 0; i < pg_num / 100; ++i) {
+	pg_t pgid(rng() % pg_num, 1);
+	auto s = pg_map.pg_stat[pgid];
+	s.stats.sum.num_bytes = rng() % 1000000;
+	next.pg_stat_updates[pgid] = s;
+      }
+      for (int osd = 0; osd < num_osd; ++osd) {
+	next.update_stat(osd, mk_osd_stat(rng));
+      }
+      pg_map.apply_incremental(g_ceph_context, next);
+
+      auto start = ceph::mono_clock::now();
+      std::map<int,int64_t> avail;
+      pg_map.get_rules_avail(osdmap, &avail);
+      pg_map.calc_osd_sum_by_class(osdmap);
+      pg_map.calc_purged_snaps();
+      auto mid = ceph::mono_clock::now();
+      pg_map.update_digest(osdmap);
+      auto end = ceph::mono_clock::now();
+      full += mid - start;
+      incremental += end - mid;
+    }
+    ASSERT_TRUE(pg_map.check_digest(osdmap, nullptr));
+    auto us = [&](ceph::timespan t) {
+      return std::chrono::duration_cast<std::chrono::microseconds>(t).count() /
+	rounds;
+    };
+    std::cout << std::setw(10) << pg_num << std::setw(14) << us(full)
+	      << std::setw(18) << us(incremental) << std::endl;
+  }
+}
@@ -0,0 +1,95 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "common/config_proxy.h"
+#include "crush/CrushWrapper.h"
+#include "global/global_context.h"
+#include "mon/ConfigMap.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+void add(Section *section, const std::string& name, const std::string& value,
+	 const std::string& mask = std::string())
+{
+  MaskedOption mopt(g_conf().find_option(name));
+  ASSERT_TRUE(mopt.opt);
+  mopt.raw_value = value;
+  if (mask.size()) {
+    std::string section_name;
+    ASSERT_TRUE(ConfigMap::parse_mask("osd/" + mask, &section_name,
+				      &mopt.mask));
+  }
+  section->options.insert(make_pair(name, std::move(mopt)));
+}
+
+EntityName osd(const std::string& id)
+{
+  EntityName name;
+  name.set(CEPH_ENTITY_TYPE_OSD, id);
+  return name;
+}
+
+} // anonymous namespace
+
+TEST(ConfigMap, get_entity_map)
+{
+  CrushWrapper crush;
+  crush.create();
+  crush.set_type_name(0, "osd");
+  crush.set_type_name(1, "host");
+  crush.set_type_name(2, "rack");
+
+  ConfigMap cm;
+  add(&cm.global, "osd_max_backfills", "1");
+  add(&cm.by_type["osd"], "osd_max_backfills", "2", "rack:r1");
+  add(&cm.by_type["osd"], "osd_max_backfills", "3", "host:h1");
+  add(&cm.by_type["osd"], "osd_recovery_max_active", "4", "class:ssd");
+  add(&cm.by_id["osd.2"], "osd_recovery_max_active", "5");
+
+  std::map<std::string,std::string> h1 = {{"host", "h1"}, {"rack", "r1"}};
+  std::map<std::string,std::string> h2 = {{"host", "h2"}, {"rack", "r1"}};
+  std::map<std::string,std::string> h3 = {{"host", "h3"}, {"rack", "r2"}};
+
+  struct {
+    EntityName name;
+    const std::map<std::string,std::string>& loc;
+    std::string device_class;
+    std::string backfills, recovery;
+  } cases[] = {
+    { osd("0"), h1, "ssd", "3", "4" },
+    { osd("1"), h1, "ssd", "3", "4" },
+    { osd("2"), h1, "ssd", "3", "5" },
+    { osd("3"), h2, "hdd", "2", "" },
+    { osd("4"), h3, "", "1", "" },
+  };
+  for (int pass = 0; pass < 2; ++pass) {
+    for (auto& c : cases) {
+      auto& out = cm.get_entity_map(c.name, c.loc, &crush, c.device_class);
+      EXPECT_EQ(cm.generate_entity_map(c.name, c.loc, &crush, c.device_class),
+		out) << c.name;
+      EXPECT_EQ(c.backfills, out.at("osd_max_backfills")) << c.name;
+      auto p = out.find("osd_recovery_max_active");
+      EXPECT_EQ(c.recovery, p == out.end() ? "" : p->second) << c.name;
+    }
+  }
+  // osd.0 and osd.1 share theirs
+  EXPECT_EQ(4u, cm.entity_map_cache.size());
+
+  cm.clear_entity_map_cache();
+  EXPECT_EQ("3", cm.get_entity_map(osd("0"), h1, &crush, "ssd")
+	    .at("osd_max_backfills"));
+  EXPECT_EQ(1u, cm.entity_map_cache.size());
+  cm.clear();
+  EXPECT_TRUE(cm.entity_map_cache.empty());
+}
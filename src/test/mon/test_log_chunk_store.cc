@@ -0,0 +1,153 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <sys/stat.h>
+
+#include <sstream>
+
+#include "global/global_context.h"
+#include "mon/LogChunkStore.h"
+
+#include "gtest/gtest.h"
+
+class LogChunkStoreTest : public ::testing::Test {
+protected:
+  std::string path;
+  std::unique_ptr<MonitorDBStore> store;
+  LogChunkStore chunks;
+  uint64_t seq = 0;
+
+  void SetUp() override {
+    path = "test_log_chunk_store." + std::to_string(getpid());
+    ASSERT_EQ(0, ::mkdir(path.c_str(), 0755));
+    store.reset(new MonitorDBStore(path));
+    std::ostringstream out;
+    ASSERT_EQ(0, store->create_and_open(out)) << out.str();
+    chunks.init(store.get());
+  }
+
+  void TearDown() override {
+    store->close();
+    store.reset();
+    std::string cmd = "rm -rf " + path;
+    ASSERT_EQ(0, ::system(cmd.c_str()));
+  }
+
+  void add(const std::string& channel, clog_type prio) {
+    LogEntry e;
+    e.channel = channel;
+    e.prio = prio;
+    e.seq = ++seq;
+    e.msg = channel + " " + std::to_string(seq);
+    chunks.add(seq, e);
+  }
+
+  // write the open chunk, committing it if commit
+  uint64_t flush(unsigned max_chunks, bool commit = true) {
+    auto t = std::make_shared<MonitorDBStore::Transaction>();
+    uint64_t id = chunks.flush(1, max_chunks, t);
+    if (id && commit) {
+      EXPECT_EQ(0, store->apply_transaction(t));
+      chunks.committed(id);
+    }
+    return id;
+  }
+
+  std::vector<uint64_t> last(const std::string& channel, clog_type level,
+			     size_t num) {
+    std::map<uint64_t,LogEntry> out;
+    chunks.get_last(channel, level, num, &out);
+    std::vector<uint64_t> seqs;
+    for (auto& [s, e] : out) {
+      EXPECT_EQ(s, e.seq);
+      seqs.push_back(s);
+    }
+    return seqs;
+  }
+};
+
+TEST_F(LogChunkStoreTest, get_last)
+{
+  // seq 1..30, every third one a warning of the audit channel
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 10; ++j) {
+      if (j % 3 == 2) {
+	add("audit", CLOG_WARN);
+      } else {
+	add("cluster", CLOG_INFO);
+      }
+    }
+    if (i < 2) {
+      ASSERT_NE(0u, flush(100));
+    }
+  }
+  // the last chunk is still open
+  EXPECT_EQ(2u, chunks.get_num_chunks());
+  EXPECT_EQ(30u, chunks.get_last_seq());
+
+  EXPECT_EQ(std::vector<uint64_t>({28, 29, 30}), last("*", CLOG_INFO, 3));
+  EXPECT_EQ(std::vector<uint64_t>({25, 27, 28, 30}),
+	    last("cluster", CLOG_INFO, 4));
+  EXPECT_EQ(std::vector<uint64_t>({3, 6, 9, 13, 16, 19, 23, 26, 29}),
+	    last("audit", CLOG_WARN, 100));
+  EXPECT_TRUE(last("cluster", CLOG_WARN, 10).empty());
+  EXPECT_TRUE(last("osd", CLOG_DEBUG, 10).empty());
+
+  // the same from the store
+  ASSERT_NE(0u, flush(100));
+  chunks.init(store.get());
+  EXPECT_EQ(3u, chunks.get_num_chunks());
+  EXPECT_EQ(30u, chunks.get_last_seq());
+  EXPECT_EQ(std::vector<uint64_t>({3, 6, 9, 13, 16, 19, 23, 26, 29}),
+	    last("audit", CLOG_WARN, 100));
+  EXPECT_EQ(30u, last("*", CLOG_DEBUG, 100).size());
+}
+
+TEST_F(LogChunkStoreTest, uncommitted)
+{
+  EXPECT_TRUE(chunks.get_open_stamp().is_zero());
+  add("cluster", CLOG_INFO);
+  utime_t stamp = chunks.get_open_stamp();
+  EXPECT_FALSE(stamp.is_zero());
+  add("cluster", CLOG_INFO);
+  EXPECT_EQ(stamp, chunks.get_open_stamp());
+  ASSERT_EQ(0u, chunks.flush(3, 10,
+			     std::make_shared<MonitorDBStore::Transaction>()));
+  ASSERT_NE(0u, flush(10, false));
+  EXPECT_TRUE(chunks.get_open_stamp().is_zero());
+  // not written, but found
+  EXPECT_EQ(std::vector<uint64_t>({1, 2}), last("cluster", CLOG_INFO, 10));
+  chunks.init(store.get());
+  EXPECT_EQ(0u, chunks.get_num_chunks());
+}
+
+TEST_F(LogChunkStoreTest, trim)
+{
+  for (int i = 0; i < 10; ++i) {
+    add("cluster", CLOG_INFO);
+    add("cluster", CLOG_INFO);
+    ASSERT_NE(0u, flush(3));
+  }
+  EXPECT_EQ(3u, chunks.get_num_chunks());
+  EXPECT_EQ(std::vector<uint64_t>({15, 16, 17, 18, 19, 20}),
+	    last("cluster", CLOG_INFO, 100));
+  chunks.init(store.get());
+  EXPECT_EQ(3u, chunks.get_num_chunks());
+  EXPECT_EQ(20u, chunks.get_last_seq());
+  EXPECT_EQ(6u, last("*", CLOG_INFO, 100).size());
+
+  // new chunks go after the ones in the store
+  add("cluster", CLOG_INFO);
+  ASSERT_NE(0u, flush(3));
+  EXPECT_EQ(std::vector<uint64_t>({17, 18, 19, 20, 21}),
+	    last("cluster", CLOG_INFO, 100));
+}
@@ -0,0 +1,106 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <sys/stat.h>
+
+#include <sstream>
+#include <thread>
+
+#include "common/Cond.h"
+#include "global/global_context.h"
+#include "mon/MonitorDBStore.h"
+
+#include "gtest/gtest.h"
+
+class MonitorDBStoreTest : public ::testing::Test {
+protected:
+  std::string path;
+  std::unique_ptr<MonitorDBStore> store;
+
+  void SetUp() override {
+    path = "test_mon_store." + std::to_string(getpid());
+    ASSERT_EQ(0, ::mkdir(path.c_str(), 0755));
+    store.reset(new MonitorDBStore(path));
+    std::ostringstream out;
+    ASSERT_EQ(0, store->create_and_open(out)) << out.str();
+  }
+
+  void TearDown() override {
+    store->close();
+    store.reset();
+    std::string cmd = "rm -rf " + path;
+    ASSERT_EQ(0, ::system(cmd.c_str()));
+  }
+
+  static MonitorDBStore::TransactionRef put(const std::string& key) {
+    auto t = std::make_shared<MonitorDBStore::Transaction>();
+    bufferlist bl;
+    bl.append(key);
+    t->put("test", key, bl);
+    return t;
+  }
+
+  std::string get(const std::string& key) {
+    bufferlist bl;
+    if (store->get("test", key, bl) < 0) {
+      return std::string();
+    }
+    return bl.to_str();
+  }
+};
+
+TEST_F(MonitorDBStoreTest, apply)
+{
+  ASSERT_EQ(0, store->apply_transaction(put("a")));
+  ASSERT_EQ("a", get("a"));
+}
+
+TEST_F(MonitorDBStoreTest, queue)
+{
+  const int n = 100;
+  std::vector<C_SaferCond> done(n);
+  for (int i = 0; i < n; ++i) {
+    store->queue_transaction(put(std::to_string(i)), &done[i]);
+  }
+  // a synchronous transaction behind the queued ones
+  ASSERT_EQ(0, store->apply_transaction(put("sync")));
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(0, done[i].wait());
+    ASSERT_EQ(std::to_string(i), get(std::to_string(i)));
+  }
+  ASSERT_EQ("sync", get("sync"));
+  store->flush();
+}
+
+TEST_F(MonitorDBStoreTest, concurrent)
+{
+  const int num_threads = 8;
+  const int per_thread = 50;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back([this, i] {
+      for (int j = 0; j < per_thread; ++j) {
+	ASSERT_EQ(0, store->apply_transaction(
+	  put(std::to_string(i) + "." + std::to_string(j))));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    for (int j = 0; j < per_thread; ++j) {
+      auto key = std::to_string(i) + "." + std::to_string(j);
+      ASSERT_EQ(key, get(key));
+    }
+  }
+}
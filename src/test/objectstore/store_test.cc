@@ -2641,6 +2641,60 @@ TEST_P(StoreTest, ZeroLengthZero) {
   ASSERT_EQ(0, r);
 }
 
+TEST_P(StoreTest, ReadCrc32c) {
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t(sobject_t("crc object", CEPH_NOSNAP)));
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  {
+    // aligned and unaligned data with a hole in between
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    for (unsigned i = 0; i < 196608; ++i) {
+      bl.append((char)(rand() & 0xff));
+    }
+    t.write(cid, hoid, 0, 131072, bl);
+    bufferlist tail;
+    tail.substr_of(bl, 131072, 65536 - 123);
+    t.write(cid, hoid, 262144 + 17, tail.length(), tail);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // remount so the reads below come from disk, not the buffer cache
+  ch.reset();
+  r = store->umount();
+  ASSERT_EQ(0, r);
+  r = store->mount();
+  ASSERT_EQ(0, r);
+  ch = store->open_collection(cid);
+
+  const vector<pair<uint64_t, uint64_t>> ranges = {
+    {0, 0}, {0, 131072}, {4096, 8192}, {100, 200000},
+    {131072, 131072}, {262144, 65536}, {0, 1048576}};
+  for (auto& [off, len] : ranges) {
+    bufferlist bl;
+    r = store->read(ch, hoid, off, len, bl);
+    ASSERT_GE(r, 0);
+    uint32_t crc = -1;
+    int r2 = store->read_crc32c(ch, hoid, off, len, &crc);
+    ASSERT_EQ(r, r2);
+    ASSERT_EQ(bl.crc32c(-1), crc) << "range " << off << "~" << len;
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTest, SimpleAttrTest) {
   int r;
   coll_t cid;
@@ -2,7 +2,9 @@
 #include "gtest/gtest.h"
 #include "osd/OSDMap.h"
 #include "osd/OSDMapMapping.h"
+#include "osd/OSDMapSnapshot.h"
 #include "mon/OSDMonitor.h"
+#include "messages/MOSDMap.h"
 
 #include "global/global_context.h"
 #include "global/global_init.h"
@@ -10,6 +12,7 @@
 #include "common/ceph_argparse.h"
 
 #include <iostream>
+#include <thread>
 
 using namespace std;
 
@@ -1700,6 +1703,497 @@ TEST_F(OSDMapTest, CleanPGUpmapsFixLeakedUpmaps) {
   }
 }
 
+TEST_F(OSDMapTest, IncrementalMappingUpdate) {
+  set_up_map(20);
+  mapping.update(osdmap);
+  ASSERT_EQ(1.0, mapping.get_last_update_fraction());
+
+  // apply inc, update the mapping from it and check it against a full
+  // mapping of the new map
+  auto apply = [&](OSDMap::Incremental& inc) -> double {
+    osdmap.apply_incremental(inc);
+    std::list<OSDMap::Incremental> incs;
+    incs.push_back(inc);
+    mapping.update(osdmap, incs);
+    OSDMapMapping full;
+    full.update(osdmap);
+    for (auto& p : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < p.second.get_pg_num(); ++ps) {
+	pg_t pgid(ps, p.first);
+	vector<int> up, acting, fup, facting;
+	int up_primary, acting_primary, fup_primary, facting_primary;
+	mapping.get(pgid, &up, &up_primary, &acting, &acting_primary);
+	full.get(pgid, &fup, &fup_primary, &facting, &facting_primary);
+	EXPECT_EQ(fup, up) << pgid;
+	EXPECT_EQ(fup_primary, up_primary) << pgid;
+	EXPECT_EQ(facting, acting) << pgid;
+	EXPECT_EQ(facting_primary, acting_primary) << pgid;
+      }
+    }
+    return mapping.get_last_update_fraction();
+  };
+
+  {
+    // down: only the pgs on the osd
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[3] = CEPH_OSD_UP;
+    double f = apply(inc);
+    ASSERT_LT(0.0, f);
+    ASSERT_GT(0.5, f);
+  }
+  {
+    // out: same
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[3] = CEPH_OSD_OUT;
+    double f = apply(inc);
+    ASSERT_LT(0.0, f);
+    ASSERT_GT(0.5, f);
+  }
+  {
+    // a pg_temp and an upmap
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_temp[pg_t(1, my_rep_pool)] =
+      mempool::osdmap::vector<int32_t>({5, 6, 7});
+    inc.new_pg_upmap_items[pg_t(2, my_rep_pool)] =
+      mempool::osdmap::vector<pair<int32_t,int32_t>>();
+    vector<int> up;
+    int primary;
+    osdmap.pg_to_raw_up(pg_t(2, my_rep_pool), &up, &primary);
+    int target = 0;
+    while (std::find(up.begin(), up.end(), target) != up.end() || target == 3)
+      ++target;
+    inc.new_pg_upmap_items[pg_t(2, my_rep_pool)].push_back(
+      make_pair(up[0], target));
+    double f = apply(inc);
+    ASSERT_EQ(2.0 / mapping.get_num_pgs(), f);
+  }
+  {
+    // primary affinity
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_primary_affinity[7] = 0;
+    double f = apply(inc);
+    ASSERT_GT(0.5, f);
+  }
+  {
+    // back in and up: every pool that can map to it
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[3] = CEPH_OSD_IN;
+    inc.new_state[3] = CEPH_OSD_UP;
+    ASSERT_EQ(1.0, apply(inc));
+  }
+  {
+    // nothing that touches placement
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_up_thru[4] = osdmap.get_epoch();
+    ASSERT_EQ(0.0, apply(inc));
+  }
+  {
+    // a gap falls back to a full update
+    OSDMap::Incremental skipped(osdmap.get_epoch() + 1);
+    osdmap.apply_incremental(skipped);
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    ASSERT_EQ(1.0, apply(inc));
+  }
+}
+
+TEST_F(OSDMapTest, CrushResultCache) {
+  set_up_map(20);
+  auto copy = [&](OSDMap *m) {
+    bufferlist bl;
+    osdmap.encode(bl, CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED);
+    m->enable_crush_cache();
+    m->decode(bl);
+  };
+  OSDMap cached;
+  copy(&cached);
+  unsigned num_pgs = 0;
+  for (auto& p : osdmap.get_pools())
+    num_pgs += p.second.get_pg_num();
+
+  // map every pg with m and check it against the uncached osdmap
+  auto check = [&](const OSDMap& m) {
+    for (auto& p : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < p.second.get_pg_num(); ++ps) {
+	pg_t pgid(ps, p.first);
+	vector<int> up, acting, cup, cacting;
+	int up_primary, acting_primary, cup_primary, cacting_primary;
+	osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				    &acting, &acting_primary);
+	m.pg_to_up_acting_osds(pgid, &cup, &cup_primary,
+			       &cacting, &cacting_primary);
+	EXPECT_EQ(up, cup) << pgid;
+	EXPECT_EQ(up_primary, cup_primary) << pgid;
+	EXPECT_EQ(acting, cacting) << pgid;
+	EXPECT_EQ(acting_primary, cacting_primary) << pgid;
+      }
+    }
+  };
+  auto apply = [&](OSDMap::Incremental& inc) {
+    osdmap.apply_incremental(inc);
+    cached.apply_incremental(inc);
+  };
+  auto stats = cached.get_crush_cache()->get_stats();
+
+  check(cached);
+  ASSERT_EQ(0u, stats->hit);
+  ASSERT_EQ(num_pgs, stats->miss);
+  check(cached);
+  ASSERT_EQ(num_pgs, stats->hit);
+  ASSERT_EQ(num_pgs, stats->miss);
+
+  {
+    // down: the raw mappings stay valid
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[3] = CEPH_OSD_UP;
+    apply(inc);
+    check(cached);
+    ASSERT_EQ(2 * num_pgs, stats->hit);
+    ASSERT_EQ(num_pgs, stats->miss);
+  }
+  {
+    // out: crush has to run again
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[3] = CEPH_OSD_OUT;
+    apply(inc);
+    check(cached);
+    ASSERT_EQ(2 * num_pgs, stats->hit);
+    ASSERT_EQ(2 * num_pgs, stats->miss);
+  }
+  {
+    // a pool change only drops the mappings of that pool
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    pg_pool_t pool = *osdmap.get_pg_pool(my_rep_pool);
+    pool.size = 2;
+    inc.new_pools[my_rep_pool] = pool;
+    apply(inc);
+    check(cached);
+    unsigned rep_pgs = pool.get_pg_num();
+    ASSERT_EQ(3 * num_pgs - rep_pgs, stats->hit);
+    ASSERT_EQ(2 * num_pgs + rep_pgs, stats->miss);
+  }
+  {
+    // dedup shares the tables with the next epoch
+    OSDMap next;
+    copy(&next);
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[5] = CEPH_OSD_UP;
+    osdmap.apply_incremental(inc);
+    next.apply_incremental(inc);
+    OSDMap::dedup(&cached, &next);
+    auto next_stats = next.get_crush_cache()->get_stats();
+    check(next);
+    ASSERT_EQ(num_pgs, next_stats->hit);
+    ASSERT_EQ(0u, next_stats->miss);
+  }
+}
+
+TEST_F(OSDMapTest, RangeIncremental) {
+  set_up_map(50);
+  uint64_t features = CEPH_FEATURES_SUPPORTED_DEFAULT &
+    osdmap.get_encoding_features();
+  auto encode_map = [&](const OSDMap& m) {
+    bufferlist bl;
+    m.encode(bl, features | CEPH_FEATURE_RESERVED);
+    return bl;
+  };
+  OSDMap base;
+  bufferlist base_bl = encode_map(osdmap);
+  base.decode(base_bl);
+
+  // a few epochs of the usual churn
+  for (int i = 0; i < 10; ++i) {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = osdmap.get_fsid();
+    inc.new_state[i] = CEPH_OSD_UP;
+    inc.new_weight[20 + i] = CEPH_OSD_IN / 2;
+    inc.new_pg_temp[pg_t(i, my_rep_pool)] =
+      mempool::osdmap::vector<int32_t>{i, i + 1, i + 2};
+    osdmap.apply_incremental(inc);
+  }
+  bufferlist to = encode_map(osdmap);
+
+  OSDMap::RangeIncremental ri;
+  ri.fsid = base.get_fsid();
+  ri.base = base.get_epoch();
+  ri.epoch = osdmap.get_epoch();
+  ri.base_features = features;
+  ri.build(base_bl, to);
+  EXPECT_LT(ri.delta.length() * 4, to.length());
+
+  bufferlist bl;
+  encode(ri, bl);
+  OSDMap::RangeIncremental dri;
+  auto p = bl.cbegin();
+  decode(dri, p);
+  bufferlist out;
+  ASSERT_EQ(0, dri.apply(base, &out));
+  ASSERT_TRUE(out.contents_equal(to));
+  OSDMap result;
+  result.decode(out);
+  ASSERT_EQ(osdmap.get_epoch(), result.get_epoch());
+  ASSERT_EQ(osdmap.get_crc(), result.get_crc());
+
+  // a map that differs from the base is refused
+  ASSERT_EQ(-EINVAL, dri.apply(result, &out));
+  OSDMap other;
+  other.decode(base_bl);
+  {
+    OSDMap::Incremental inc(other.get_epoch() + 1);
+    inc.fsid = other.get_fsid();
+    inc.new_weight[49] = 0;
+    other.apply_incremental(inc);
+    other.set_epoch(base.get_epoch());
+  }
+  ASSERT_EQ(-EINVAL, dri.apply(other, &out));
+}
+
+TEST(MOSDMap, RangeIncrementalEpochs) {
+  auto m = ceph::make_message<MOSDMap>(uuid_d(), 0);
+  m->range_incremental_maps[120];
+  EXPECT_EQ(120u, m->get_first());
+  EXPECT_EQ(120u, m->get_last());
+  m->incremental_maps[40];
+  m->maps[41];
+  EXPECT_EQ(40u, m->get_first());
+  EXPECT_EQ(120u, m->get_last());
+}
+
+TEST_F(OSDMapTest, CalcPgUpmapsParallel) {
+  set_up_map(30);
+  // no shuffling, so that runs can be compared
+  g_ceph_context->_conf.set_val("osd_calc_pg_upmaps_aggressively", "false");
+  g_ceph_context->_conf.set_val("osd_calc_pg_upmaps_max_stddev", "0");
+  g_ceph_context->_conf.apply_changes(nullptr);
+
+  OSDMap::Incremental seq_inc(osdmap.get_epoch() + 1);
+  OSDMap::upmap_calc_stats_t seq_stats;
+  int seq = osdmap.calc_pg_upmaps(g_ceph_context, 0, 100, {}, &seq_inc,
+				  {}, &seq_stats);
+  ASSERT_LT(0, seq);
+  ASSERT_LT(0, seq_stats.rounds);
+  ASSERT_LT(seq_stats.end_stddev, seq_stats.start_stddev);
+  ASSERT_FALSE(seq_stats.timed_out);
+
+  // the parallel run takes the same decisions
+  ThreadPool tp(g_ceph_context, "CalcPgUpmapsParallel::tp", "upmap_tp", 4);
+  tp.start();
+  ParallelPGMapper mapper(g_ceph_context, &tp);
+  OSDMap::Incremental par_inc(osdmap.get_epoch() + 1);
+  OSDMap::upmap_calc_stats_t par_stats;
+  int par = osdmap.calc_pg_upmaps(g_ceph_context, 0, 100, {}, &par_inc,
+				  mapper.get_runner(8), &par_stats);
+  tp.stop();
+  ASSERT_EQ(seq, par);
+  ASSERT_EQ(seq_inc.new_pg_upmap_items, par_inc.new_pg_upmap_items);
+  ASSERT_EQ(seq_inc.old_pg_upmap_items, par_inc.old_pg_upmap_items);
+  ASSERT_EQ(seq_stats.rounds, par_stats.rounds);
+  ASSERT_EQ(seq_stats.end_stddev, par_stats.end_stddev);
+  ASSERT_LE(seq_stats.evaluated, par_stats.evaluated);
+
+  // out of time right away
+  g_ceph_context->_conf.set_val("osd_calc_pg_upmaps_time_budget", "0.000000001");
+  g_ceph_context->_conf.apply_changes(nullptr);
+  OSDMap::Incremental late_inc(osdmap.get_epoch() + 1);
+  OSDMap::upmap_calc_stats_t late_stats;
+  ASSERT_EQ(0, osdmap.calc_pg_upmaps(g_ceph_context, 0, 100, {}, &late_inc,
+				     {}, &late_stats));
+  ASSERT_TRUE(late_stats.timed_out);
+
+  g_ceph_context->_conf.rm_val("osd_calc_pg_upmaps_time_budget");
+  g_ceph_context->_conf.rm_val("osd_calc_pg_upmaps_max_stddev");
+  g_ceph_context->_conf.rm_val("osd_calc_pg_upmaps_aggressively");
+  g_ceph_context->_conf.apply_changes(nullptr);
+}
+
+TEST_F(OSDMapTest, Snapshot) {
+  set_up_map(6);
+  OSDMapMapping mapping;
+  mapping.update(osdmap);
+  bufferlist bl;
+  osdmap.encode(bl, CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED);
+  std::string path = "osdmap_snapshot." + stringify(getpid());
+
+  // without a mapping
+  ASSERT_EQ(0, OSDMapSnapshot::write(path, osdmap, bl, nullptr));
+  {
+    OSDMapSnapshot snap;
+    ASSERT_EQ(0, snap.open(path));
+    ASSERT_FALSE(snap.has_mapping());
+    OSDMap loaded;
+    bufferlist snap_bl = snap.get_map_bl();
+    loaded.decode(snap_bl);
+    OSDMapMapping m;
+    ASSERT_FALSE(snap.get_mapping(loaded, &m));
+  }
+
+  ASSERT_EQ(0, OSDMapSnapshot::write(path, osdmap, bl, &mapping));
+  OSDMap loaded;
+  OSDMapMapping loaded_mapping;
+  bufferlist loaded_bl;
+  {
+    OSDMapSnapshot snap;
+    ASSERT_EQ(0, snap.open(path));
+    ASSERT_EQ(osdmap.get_epoch(), snap.get_epoch());
+    ASSERT_EQ(osdmap.get_fsid(), snap.get_fsid());
+    ASSERT_TRUE(snap.has_mapping());
+    loaded_bl = snap.get_map_bl();
+    ASSERT_TRUE(loaded_bl.contents_equal(bl));
+    loaded.decode(loaded_bl);
+    ASSERT_TRUE(snap.get_mapping(loaded, &loaded_mapping));
+
+    // tables that do not fit the map are not used
+    OSDMap other;
+    bufferlist other_bl = bl;
+    other.decode(other_bl);
+    OSDMap::Incremental inc(other.get_epoch() + 1);
+    inc.fsid = other.get_fsid();
+    pg_pool_t pool = *other.get_pg_pool(my_rep_pool);
+    pool.set_pg_num(pool.get_pg_num() * 2);
+    inc.new_pools[my_rep_pool] = pool;
+    other.apply_incremental(inc);
+    other.set_epoch(loaded.get_epoch());
+    OSDMapMapping m;
+    ASSERT_FALSE(snap.get_mapping(other, &m));
+  }
+  // the map buffer outlives the snapshot
+  ASSERT_TRUE(loaded_bl.contents_equal(bl));
+  ASSERT_EQ(osdmap.get_epoch(), loaded.get_epoch());
+  ASSERT_EQ(mapping.get_num_pgs(), loaded_mapping.get_num_pgs());
+  for (auto& [id, pool] : osdmap.get_pools()) {
+    for (unsigned ps = 0; ps < pool.get_pg_num(); ++ps) {
+      pg_t pgid(ps, id);
+      vector<int> up, acting, loaded_up, loaded_acting;
+      int up_primary, acting_primary, loaded_up_primary, loaded_acting_primary;
+      mapping.get(pgid, &up, &up_primary, &acting, &acting_primary);
+      loaded_mapping.get(pgid, &loaded_up, &loaded_up_primary,
+			 &loaded_acting, &loaded_acting_primary);
+      ASSERT_EQ(up, loaded_up);
+      ASSERT_EQ(up_primary, loaded_up_primary);
+      ASSERT_EQ(acting, loaded_acting);
+      ASSERT_EQ(acting_primary, loaded_acting_primary);
+    }
+  }
+  for (int osd = 0; osd < osdmap.get_max_osd(); ++osd) {
+    ASSERT_EQ(mapping.get_osd_acting_pgs(osd),
+	      loaded_mapping.get_osd_acting_pgs(osd));
+  }
+
+  // a damaged file is refused
+  {
+    bufferlist file;
+    std::string error;
+    ASSERT_EQ(0, file.read_file(path.c_str(), &error));
+    bufferlist damaged;
+    damaged.append(file.c_str(), file.length());
+    damaged.c_str()[file.length() - 1] ^= 1;
+    ASSERT_EQ(0, damaged.write_file(path.c_str()));
+    OSDMapSnapshot snap;
+    ASSERT_EQ(-EIO, snap.open(path));
+  }
+  ::unlink(path.c_str());
+}
+
+TEST_F(OSDMapTest, IncrementalMappingUpdateUpmapSourceOut) {
+  set_up_map(20);
+
+  // move a replica of a pg away from the osd crush picked
+  pg_t pgid(3, my_rep_pool);
+  vector<int> raw;
+  int primary;
+  osdmap.pg_to_raw_up(pgid, &raw, &primary);
+  int source = raw[1];
+  int target = 0;
+  while (std::find(raw.begin(), raw.end(), target) != raw.end())
+    ++target;
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_upmap_items[pgid] =
+      mempool::osdmap::vector<pair<int32_t,int32_t>>({{source, target}});
+    osdmap.apply_incremental(inc);
+  }
+  mapping.update(osdmap);
+  vector<int> up;
+  mapping.get(pgid, &up, nullptr, nullptr, nullptr);
+  ASSERT_EQ(raw.size(), up.size());
+  ASSERT_EQ(target, up[1]);
+
+  // the source osd goes out: crush no longer picks it and the upmap item
+  // does not apply any more, though source is not in the mapped raw set
+  OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+  inc.new_weight[source] = CEPH_OSD_OUT;
+  osdmap.apply_incremental(inc);
+  std::list<OSDMap::Incremental> incs;
+  incs.push_back(inc);
+  mapping.update(osdmap, incs);
+  ASSERT_GT(1.0, mapping.get_last_update_fraction());
+
+  OSDMapMapping full;
+  full.update(osdmap);
+  for (auto& p : osdmap.get_pools()) {
+    for (unsigned ps = 0; ps < p.second.get_pg_num(); ++ps) {
+      pg_t pg(ps, p.first);
+      vector<int> fup, facting, acting;
+      int fup_primary, facting_primary, up_primary, acting_primary;
+      mapping.get(pg, &up, &up_primary, &acting, &acting_primary);
+      full.get(pg, &fup, &fup_primary, &facting, &facting_primary);
+      EXPECT_EQ(fup, up) << pg;
+      EXPECT_EQ(fup_primary, up_primary) << pg;
+      EXPECT_EQ(facting, acting) << pg;
+      EXPECT_EQ(facting_primary, acting_primary) << pg;
+    }
+  }
+  mapping.get(pgid, &up, nullptr, nullptr, nullptr);
+  EXPECT_EQ(up.end(), std::find(up.begin(), up.end(), source));
+}
+
+TEST_F(OSDMapTest, IncrementalMappingUpdateAfterAbort) {
+  set_up_map(20);
+  mapping.update(osdmap);
+
+  ThreadPool tp(g_ceph_context, "MappingAbort::tp", "mapping_tp", 2);
+  tp.start();
+  ParallelPGMapper mapper(g_ceph_context, &tp);
+
+  // osd.0 goes down, and the job remapping its pgs is aborted
+  std::list<OSDMap::Incremental> incs;
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[0] = CEPH_OSD_UP;
+    osdmap.apply_incremental(inc);
+    incs.push_back(inc);
+  }
+  tp.pause();
+  auto job = mapping.start_update(osdmap, mapper, 8, incs);
+  ASSERT_LT(0.0, mapping.get_last_update_fraction());
+  ASSERT_GT(1.0, mapping.get_last_update_fraction());
+  // whatever rows the job wrote, the mapping no longer matches an epoch
+  EXPECT_EQ(0u, mapping.get_epoch());
+  std::thread aborter([&job] { job->abort(); });
+  while (true) {
+    std::lock_guard l(job->lock);
+    if (job->aborted) {
+      break;
+    }
+  }
+  tp.unpause();
+  aborter.join();
+  job.reset();
+  tp.stop();
+  EXPECT_EQ(0u, mapping.get_epoch());
+
+  // it comes back up: the net state is the same as before, so only a
+  // full update can be trusted
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[0] = CEPH_OSD_UP;
+    osdmap.apply_incremental(inc);
+    incs.push_back(inc);
+  }
+  mapping.update(osdmap, incs);
+  EXPECT_EQ(osdmap.get_epoch(), mapping.get_epoch());
+  EXPECT_EQ(1.0, mapping.get_last_update_fraction());
+}
+
 TEST(PGTempMap, basic)
 {
   PGTempMap m;
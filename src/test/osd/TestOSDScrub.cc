@@ -142,6 +142,82 @@ TEST(TestOSDScrub, scrub_time_permit) {
 
 }
 
+TEST(TestOSDScrub, scrub_throttle) {
+  // drop our overrides whatever the outcome
+  struct restore_conf {
+    ~restore_conf() {
+      for (auto key : {"osd_scrub_throttle_client_p99_target",
+		       "osd_scrub_throttle_store_latency_target",
+		       "osd_scrub_throttle_max_sleep",
+		       "osd_scrub_throttle_min_ops"}) {
+	g_ceph_context->_conf.rm_val(key);
+      }
+      g_ceph_context->_conf.apply_changes(nullptr);
+    }
+  } restore;
+
+  g_ceph_context->_conf.set_val("osd_scrub_throttle_client_p99_target", "0.01");
+  g_ceph_context->_conf.set_val("osd_scrub_throttle_store_latency_target", "0");
+  g_ceph_context->_conf.set_val("osd_scrub_throttle_max_sleep", "0.8");
+  g_ceph_context->_conf.set_val("osd_scrub_throttle_min_ops", "100");
+  g_ceph_context->_conf.apply_changes(nullptr);
+  ScrubThrottle throttle(g_ceph_context);
+  ASSERT_EQ(0u, throttle.get_level());
+  ASSERT_EQ(0.0, throttle.get_sleep(0));
+  ASSERT_EQ(25, throttle.get_chunk_size(25));
+
+  // 2% of the ops at 50ms: p99 over the 10ms target
+  for (unsigned i = 0; i < 1000; ++i) {
+    throttle.add_client_latency(i % 50 ? 1000000 : 50000000);
+  }
+  throttle.update(0);
+  ASSERT_EQ(1u, throttle.get_level());
+  ASSERT_GE(throttle.get_client_p99_ns(), 50000000u);
+  ASSERT_DOUBLE_EQ(0.1, throttle.get_sleep(0));
+  ASSERT_DOUBLE_EQ(0.2, throttle.get_sleep(0.2));
+  ASSERT_EQ(12, throttle.get_chunk_size(25));
+
+  for (unsigned i = 0; i < 20; ++i) {
+    for (unsigned j = 0; j < 1000; ++j) {
+      throttle.add_client_latency(50000000);
+    }
+    throttle.update(0);
+  }
+  ASSERT_EQ(ScrubThrottle::MAX_LEVEL, throttle.get_level());
+  ASSERT_DOUBLE_EQ(0.8, throttle.get_sleep(0));
+
+  // too few ops to judge: back off one level per update
+  throttle.add_client_latency(50000000);
+  throttle.update(0);
+  ASSERT_EQ(ScrubThrottle::MAX_LEVEL - 1, throttle.get_level());
+  ASSERT_EQ(0u, throttle.get_client_p99_ns());
+
+  // fast ops recover as well
+  for (unsigned j = 0; j < 1000; ++j) {
+    throttle.add_client_latency(100000);
+  }
+  throttle.update(0);
+  ASSERT_EQ(ScrubThrottle::MAX_LEVEL - 2, throttle.get_level());
+
+  // store latency alone is enough to throttle
+  g_ceph_context->_conf.set_val("osd_scrub_throttle_client_p99_target", "0");
+  g_ceph_context->_conf.set_val("osd_scrub_throttle_store_latency_target", "0.005");
+  g_ceph_context->_conf.apply_changes(nullptr);
+  throttle.update(20000000);
+  ASSERT_EQ(ScrubThrottle::MAX_LEVEL - 1, throttle.get_level());
+
+  // both targets off disables the throttle
+  g_ceph_context->_conf.set_val("osd_scrub_throttle_store_latency_target", "0");
+  g_ceph_context->_conf.apply_changes(nullptr);
+  throttle.update(20000000);
+  ASSERT_EQ(0u, throttle.get_level());
+
+  // store latency is averaged over the commits since the previous tick
+  ASSERT_EQ(1000000u, throttle.get_store_commit_latency({10, 10000000}));
+  ASSERT_EQ(2000000u, throttle.get_store_commit_latency({20, 30000000}));
+  ASSERT_EQ(0u, throttle.get_store_commit_latency({20, 30000000}));
+}
+
 // Local Variables:
 // compile-command: "cd ../.. ; make unittest_osdscrub ; ./unittest_osdscrub --log-to-stderr=true  --debug-osd=20 # --gtest_filter=*.* "
 // End:
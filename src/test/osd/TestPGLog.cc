@@ -2233,7 +2233,7 @@ TEST_F(PGLogTest, ErrorNotIndexedByObject) {
   log.add(modify);
 
   EXPECT_TRUE(log.logged_object(oid));
-  pg_log_entry_t *entry = log.objects[oid];
+  pg_log_entry_t *entry = log.objects.find(oid)->second;
   EXPECT_EQ(modify.op, entry->op);
   EXPECT_EQ(modify.version, entry->version);
   EXPECT_EQ(modify.prior_version, entry->prior_version);
@@ -2247,7 +2247,7 @@ TEST_F(PGLogTest, ErrorNotIndexedByObject) {
   log.add(del);
 
   EXPECT_TRUE(log.logged_object(oid));
-  entry = log.objects[oid];
+  entry = log.objects.find(oid)->second;
   EXPECT_EQ(del.op, entry->op);
   EXPECT_EQ(del.version, entry->version);
   EXPECT_EQ(del.prior_version, entry->prior_version);
@@ -2260,7 +2260,7 @@ TEST_F(PGLogTest, ErrorNotIndexedByObject) {
 		   utime_t(20,1), -ENOENT));
 
   EXPECT_TRUE(log.logged_object(oid));
-  entry = log.objects[oid];
+  entry = log.objects.find(oid)->second;
   EXPECT_EQ(del.op, entry->op);
   EXPECT_EQ(del.version, entry->version);
   EXPECT_EQ(del.prior_version, entry->prior_version);
@@ -0,0 +1,124 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "osd/DynamicPerfStats.h"
+
+typedef DynamicPerfStats::QueryCounters QueryCounters;
+
+static OSDPerfMetricKey mk_key(unsigned id) {
+  return {{"key_" + std::to_string(id)}};
+}
+
+static uint64_t weight_of(const QueryCounters &qc, unsigned id) {
+  auto it = qc.get_entries().find(mk_key(id));
+  return it == qc.get_entries().end() ? 0 : it->second.weight;
+}
+
+TEST(QueryCounters, Replace) {
+  QueryCounters qc;
+  qc.get(mk_key(0), 5, 2)->push_back({5, 0});
+  qc.get(mk_key(1), 3, 2)->push_back({3, 0});
+
+  // 2 takes the place of the lighter 1, and its weight
+  PerformanceCounters *c = qc.get(mk_key(2), 1, 2);
+  EXPECT_TRUE(c->empty());
+  ASSERT_EQ(2u, qc.get_entries().size());
+  EXPECT_EQ(5u, weight_of(qc, 0));
+  EXPECT_EQ(0u, weight_of(qc, 1));
+  EXPECT_EQ(4u, weight_of(qc, 2));
+
+  // 1 comes back in place of 2, now the lightest
+  qc.get(mk_key(1), 1, 2);
+  EXPECT_EQ(5u, weight_of(qc, 0));
+  EXPECT_EQ(0u, weight_of(qc, 2));
+  EXPECT_EQ(5u, weight_of(qc, 1));
+
+  // an existing key just gains weight
+  qc.get(mk_key(0), 2, 2);
+  EXPECT_EQ(7u, weight_of(qc, 0));
+  EXPECT_EQ(1u, qc.get_entries().at(mk_key(0)).counters.size());
+}
+
+TEST(QueryCounters, HeavyHitters) {
+  const uint64_t max_keys = 10;
+  const unsigned heavy = 5;
+  QueryCounters qc;
+  std::map<unsigned, uint64_t> truth;
+  uint64_t total = 0;
+
+  // each round: 10 ops for every heavy key and one for a new light key,
+  // so the light keys keep pushing each other out
+  unsigned next_light = heavy;
+  for (int round = 0; round < 100; ++round) {
+    for (unsigned id = 0; id < heavy; ++id) {
+      for (int i = 0; i < 10; ++i) {
+	qc.get(mk_key(id), 1, max_keys);
+	truth[id]++;
+	total++;
+      }
+    }
+    unsigned id = next_light++;
+    qc.get(mk_key(id), 1, max_keys);
+    truth[id]++;
+    total++;
+  }
+  ASSERT_GT(truth.size(), max_keys);
+  ASSERT_EQ(max_keys, qc.get_entries().size());
+
+  // every key seen more than total / max_keys times is kept
+  for (unsigned id = 0; id < heavy; ++id) {
+    ASSERT_GT(truth[id], total / max_keys);
+    EXPECT_NE(0u, weight_of(qc, id)) << id;
+  }
+
+  // weights overestimate by at most the lightest weight, which is what a
+  // key inherits when it takes another's place
+  uint64_t lightest = UINT64_MAX;
+  uint64_t sum = 0;
+  for (auto &[key, entry] : qc.get_entries()) {
+    lightest = std::min(lightest, entry.weight);
+    sum += entry.weight;
+  }
+  EXPECT_LE(lightest, total / max_keys);
+  EXPECT_EQ(total, sum);
+  for (unsigned id = 0; id < next_light; ++id) {
+    uint64_t w = weight_of(qc, id);
+    if (!w) {
+      continue;
+    }
+    EXPECT_GE(w, truth[id]) << id;
+    EXPECT_LE(w - truth[id], lightest) << id;
+  }
+  // the heavy keys never had to take a place, so they are exact
+  for (unsigned id = 0; id < heavy; ++id) {
+    EXPECT_EQ(truth[id], weight_of(qc, id)) << id;
+  }
+}
+
+TEST(QueryCounters, SetMaxKeys) {
+  QueryCounters qc;
+  for (unsigned id = 0; id < 8; ++id) {
+    qc.get(mk_key(id), id + 1, 0);
+  }
+  ASSERT_EQ(8u, qc.get_entries().size());
+
+  // the lightest go when the limit comes in
+  qc.set_max_keys(0, 3);
+  ASSERT_EQ(3u, qc.get_entries().size());
+  for (unsigned id = 5; id < 8; ++id) {
+    EXPECT_EQ(id + 1, weight_of(qc, id)) << id;
+  }
+  qc.get(mk_key(0), 1, 3);
+  EXPECT_EQ(0u, weight_of(qc, 5));
+  EXPECT_EQ(7u, weight_of(qc, 0));
+}
@@ -0,0 +1,123 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "osd/ECReadCache.h"
+
+static hobject_t mk_obj(unsigned id) {
+  hobject_t hoid;
+  stringstream ss;
+  ss << "obj_" << id;
+  hoid.oid = ss.str();
+  hoid.set_hash(id);
+  hoid.pool = 1;
+  return hoid;
+}
+
+static extent_map mk_map(uint64_t off, uint64_t len, char c) {
+  extent_map out;
+  bufferlist bl;
+  bl.append(string(len, c));
+  out.insert(off, len, bl);
+  return out;
+}
+
+TEST(ecreadcache, disabled)
+{
+  ECReadCache c;
+  ASSERT_FALSE(c.enabled());
+  c.insert(mk_obj(1), 1, mk_map(0, 4096, 'a'));
+  ASSERT_EQ(0u, c.get_bytes());
+  extent_set want;
+  want.insert(0, 4096);
+  extent_map out;
+  ASSERT_FALSE(c.lookup(mk_obj(1), 1, want, &out));
+}
+
+TEST(ecreadcache, lookup)
+{
+  ECReadCache c(1 << 20);
+  c.insert(mk_obj(1), 1, mk_map(0, 8192, 'a'));
+  c.insert(mk_obj(1), 1, mk_map(8192, 4096, 'b'));
+  ASSERT_EQ(12288u, c.get_bytes());
+
+  extent_set want;
+  want.insert(4096, 8192);
+  extent_map out;
+  ASSERT_TRUE(c.lookup(mk_obj(1), 1, want, &out));
+  ASSERT_EQ(want, out.get_interval_set());
+  auto range = out.get_containing_range(4096, 8192);
+  ASSERT_NE(range.first, range.second);
+  bufferlist bl;
+  bl.substr_of(range.first.get_val(), 4096, 4096);
+  ASSERT_EQ(string(4096, 'b'), bl.to_str());
+
+  // partially cached extents are a miss
+  extent_set more;
+  more.insert(8192, 8192);
+  extent_map out2;
+  ASSERT_FALSE(c.lookup(mk_obj(1), 1, more, &out2));
+  ASSERT_FALSE(c.lookup(mk_obj(2), 1, want, &out2));
+}
+
+TEST(ecreadcache, interval)
+{
+  ECReadCache c(1 << 20);
+  c.insert(mk_obj(1), 1, mk_map(0, 4096, 'a'));
+  extent_set want;
+  want.insert(0, 4096);
+  extent_map out;
+  ASSERT_FALSE(c.lookup(mk_obj(1), 2, want, &out));
+  ASSERT_EQ(0u, c.get_num_objects());
+  ASSERT_EQ(0u, c.get_bytes());
+}
+
+TEST(ecreadcache, invalidate)
+{
+  ECReadCache c(1 << 20);
+  c.insert(mk_obj(1), 1, mk_map(0, 4096, 'a'));
+  c.insert(mk_obj(2), 1, mk_map(0, 4096, 'a'));
+  c.invalidate(mk_obj(1));
+  ASSERT_EQ(1u, c.get_num_objects());
+  ASSERT_EQ(4096u, c.get_bytes());
+  extent_set want;
+  want.insert(0, 4096);
+  extent_map out;
+  ASSERT_FALSE(c.lookup(mk_obj(1), 1, want, &out));
+  ASSERT_TRUE(c.lookup(mk_obj(2), 1, want, &out));
+}
+
+TEST(ecreadcache, lru)
+{
+  ECReadCache c(3 * 4096);
+  for (unsigned i = 0; i < 3; ++i) {
+    c.insert(mk_obj(i), 1, mk_map(0, 4096, 'a'));
+  }
+  extent_set want;
+  want.insert(0, 4096);
+  extent_map out;
+  // touch obj_0 so that obj_1 is the oldest
+  ASSERT_TRUE(c.lookup(mk_obj(0), 1, want, &out));
+  c.insert(mk_obj(3), 1, mk_map(0, 4096, 'a'));
+  ASSERT_EQ(3u, c.get_num_objects());
+  ASSERT_FALSE(c.lookup(mk_obj(1), 1, want, &out));
+  ASSERT_TRUE(c.lookup(mk_obj(0), 1, want, &out));
+
+  // objects larger than the cache are not kept
+  c.insert(mk_obj(4), 1, mk_map(0, 4 * 4096, 'a'));
+  ASSERT_FALSE(c.lookup(mk_obj(4), 1, want, &out));
+  ASSERT_LE(c.get_bytes(), 3u * 4096);
+
+  c.set_max_bytes(4096);
+  ASSERT_EQ(1u, c.get_num_objects());
+  ASSERT_TRUE(c.lookup(mk_obj(3), 1, want, &out));
+}
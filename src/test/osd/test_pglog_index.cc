@@ -0,0 +1,218 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "common/ceph_time.h"
+#include "global/global_context.h"
+#include "osd/PGLog.h"
+
+using IndexedLog = PGLog::IndexedLog;
+
+namespace {
+
+hobject_t mk_obj(unsigned id) {
+  hobject_t hoid;
+  stringstream ss;
+  ss << "rbd_data.1234567890ab." << std::setw(16) << std::setfill('0') << id;
+  hoid.oid = ss.str();
+  hoid.set_hash(ceph_str_hash_rjenkins(hoid.oid.name.c_str(),
+				       hoid.oid.name.size()));
+  hoid.pool = 1;
+  return hoid;
+}
+
+pg_log_entry_t mk_entry(unsigned v, unsigned obj) {
+  return pg_log_entry_t(pg_log_entry_t::MODIFY, mk_obj(obj),
+			eversion_t(1, v), eversion_t(1, v - 1), v,
+			osd_reqid_t(entity_name_t::CLIENT(4100 + obj % 7), 0, v),
+			utime_t(1, 1), 0);
+}
+
+// counts what a node based container gets from the heap
+size_t node_bytes = 0;
+template <typename T>
+struct counting_allocator : std::allocator<T> {
+  template <typename U> struct rebind {
+    using other = counting_allocator<U>;
+  };
+  counting_allocator() = default;
+  template <typename U>
+  counting_allocator(const counting_allocator<U>&) {}
+  T *allocate(size_t n) {
+    node_bytes += n * sizeof(T);
+    return std::allocator<T>::allocate(n);
+  }
+  void deallocate(T *p, size_t n) {
+    node_bytes -= n * sizeof(T);
+    std::allocator<T>::deallocate(p, n);
+  }
+};
+
+struct int_key_t {
+  static const uint64_t& key(const uint64_t *v) {
+    return *v;
+  }
+  static bool match(const uint64_t *v, const uint64_t &k) {
+    return *v == k;
+  }
+};
+
+} // anonymous namespace
+
+TEST(pglog_index, random_ops)
+{
+  // compare against std::unordered_map under random insert/erase,
+  // small key space so that probe chains wrap and erase shifts a lot
+  std::vector<uint64_t> values(512);
+  for (unsigned i = 0; i < values.size(); ++i)
+    values[i] = i;
+  pglog_index_t<uint64_t, uint64_t, int_key_t> idx;
+  std::unordered_map<uint64_t, uint64_t*> ref;
+  std::mt19937 rng(42);
+  for (unsigned n = 0; n < 200000; ++n) {
+    uint64_t k = rng() % values.size();
+    if (rng() % 3) {
+      idx.insert_or_assign(k, &values[k]);
+      ref[k] = &values[k];
+    } else {
+      auto it = idx.find(k);
+      ASSERT_EQ(ref.count(k), it != idx.end());
+      if (it != idx.end()) {
+	idx.erase(it);
+	ref.erase(k);
+      }
+    }
+    ASSERT_EQ(ref.size(), idx.size());
+    if (n % 1000 == 0) {
+      for (uint64_t j = 0; j < values.size(); ++j) {
+	auto it = idx.find(j);
+	ASSERT_EQ(ref.count(j), it != idx.end());
+	if (it != idx.end()) {
+	  ASSERT_EQ(j, it->first);
+	  ASSERT_EQ(ref[j], it->second);
+	}
+      }
+      size_t iterated = 0;
+      for (auto it = idx.begin(); it != idx.end(); ++it)
+	++iterated;
+      ASSERT_EQ(ref.size(), iterated);
+    }
+  }
+  idx.clear();
+  ASSERT_TRUE(idx.empty());
+  ASSERT_EQ(0u, idx.memory_usage());
+}
+
+TEST(pglog_index, indexed_log)
+{
+  IndexedLog log;
+  log.tail = eversion_t(1, 0);
+  for (unsigned v = 1; v <= 100; ++v) {
+    auto e = mk_entry(v, v % 10);
+    if (v % 5 == 0) {
+      e.extra_reqids.push_back(
+	make_pair(osd_reqid_t(entity_name_t::CLIENT(9000), 0, v), v));
+    }
+    log.add(e);
+  }
+  log.index();
+  EXPECT_EQ(10u, log.objects.size());
+  EXPECT_EQ(100u, log.caller_ops.size());
+  EXPECT_EQ(20u, log.extra_caller_ops.size());
+  for (unsigned o = 0; o < 10; ++o) {
+    // the newest entry of each object is indexed
+    auto it = log.objects.find(mk_obj(o));
+    ASSERT_NE(log.objects.end(), it);
+    EXPECT_EQ(mk_obj(o), it->first);
+    EXPECT_EQ(eversion_t(1, 90 + (o ? o : 10)), it->second->version);
+  }
+
+  eversion_t version;
+  version_t user_version;
+  int return_code;
+  vector<pg_log_op_return_item_t> op_returns;
+  EXPECT_TRUE(log.get_request(osd_reqid_t(entity_name_t::CLIENT(9000), 0, 45),
+			      &version, &user_version, &return_code,
+			      &op_returns));
+  EXPECT_EQ(eversion_t(1, 45), version);
+  EXPECT_EQ(45u, user_version);
+
+  // trim drops the index entries of the trimmed entries
+  log.skip_can_rollback_to_to_head();
+  set<eversion_t> trimmed;
+  set<string> trimmed_dups;
+  log.trim(g_ceph_context, eversion_t(1, 50), &trimmed, &trimmed_dups, nullptr);
+  EXPECT_EQ(50u, log.caller_ops.size());
+  EXPECT_EQ(10u, log.extra_caller_ops.size());
+  EXPECT_FALSE(log.logged_req(osd_reqid_t(entity_name_t::CLIENT(9000), 0, 45)));
+  EXPECT_TRUE(log.logged_req(osd_reqid_t(entity_name_t::CLIENT(9000), 0, 55)));
+  EXPECT_EQ(10u, log.objects.size());
+}
+
+TEST(pglog_index, memory_and_lookup)
+{
+  // a full log at osd_min_pg_log_entries with one entry per object
+  const unsigned num = 3000;
+  IndexedLog log;
+  log.tail = eversion_t(1, 0);
+  for (unsigned v = 1; v <= num; ++v) {
+    log.add(mk_entry(v, v));
+  }
+  log.index();
+  size_t flat = log.objects.memory_usage() + log.caller_ops.memory_usage();
+
+  node_bytes = 0;
+  std::unordered_map<hobject_t, pg_log_entry_t*, std::hash<hobject_t>,
+		     std::equal_to<hobject_t>,
+		     counting_allocator<std::pair<const hobject_t,
+						  pg_log_entry_t*>>> objects;
+  std::unordered_map<osd_reqid_t, pg_log_entry_t*, std::hash<osd_reqid_t>,
+		     std::equal_to<osd_reqid_t>,
+		     counting_allocator<std::pair<const osd_reqid_t,
+						  pg_log_entry_t*>>> caller_ops;
+  for (auto& e : log.log) {
+    objects[e.soid] = &e;
+    caller_ops[e.reqid] = &e;
+  }
+  // the heap strings of each hobject_t copy come on top of this
+  size_t nodes = node_bytes;
+  std::cout << num << " entries: open addressing index " << flat
+	    << " bytes, unordered_map " << nodes << " bytes" << std::endl;
+  EXPECT_LT(flat * 2, nodes);
+
+  std::vector<hobject_t> keys;
+  for (unsigned i = 0; i < num; ++i)
+    keys.push_back(mk_obj((i * 7919) % (2 * num)));
+  const unsigned rounds = 200;
+  size_t found_flat = 0, found_map = 0;
+  auto start = ceph::mono_clock::now();
+  for (unsigned r = 0; r < rounds; ++r)
+    for (auto& k : keys)
+      found_flat += log.objects.count(k);
+  auto mid = ceph::mono_clock::now();
+  for (unsigned r = 0; r < rounds; ++r)
+    for (auto& k : keys)
+      found_map += objects.count(k);
+  auto end = ceph::mono_clock::now();
+  EXPECT_EQ(found_map, found_flat);
+  auto per_lookup = [&](ceph::timespan t) {
+    return (double)std::chrono::nanoseconds(t).count() / (rounds * num);
+  };
+  std::cout << "lookup: open addressing index " << per_lookup(mid - start)
+	    << " ns, unordered_map " << per_lookup(end - mid) << " ns"
+	    << std::endl;
+}
@@ -22,6 +22,8 @@
 
 #include "global/global_init.h"
 #include "osd/OSDMap.h"
+#include "osd/OSDMapMapping.h"
+#include "osd/OSDMapSnapshot.h"
 
 
 void usage()
@@ -34,6 +36,8 @@ void usage()
   cout << "   --clobber               allows osdmaptool to overwrite <mapfilename> if it already exists" << std::endl;
   cout << "   --export-crush <file>   write osdmap's crush map to <file>" << std::endl;
   cout << "   --import-crush <file>   replace osdmap's crush map with <file>" << std::endl;
+  cout << "   --export-snapshot <file> write osdmap and its pg mappings as a snapshot to <file>" << std::endl;
+  cout << "   --snapshot              <mapfilename> is a snapshot, map it read-only" << std::endl;
   cout << "   --health                dump health checks" << std::endl;
   cout << "   --test-map-pgs [--pool <poolid>] [--pg_num <pg_num>] [--range-first <first> --range-last <last>] map all pgs" << std::endl;
   cout << "   --test-map-pgs-dump [--pool <poolid>] [--range-first <first> --range-last <last>] map all pgs" << std::endl;
@@ -126,6 +130,8 @@ int main(int argc, const char **argv)
   bool clobber = false;
   bool modified = false;
   std::string export_crush, import_crush, test_map_pg, test_map_object;
+  std::string export_snapshot;
+  bool from_snapshot = false;
   bool test_crush = false;
   int range_first = -1;
   int range_last = -1;
@@ -219,6 +225,10 @@ int main(int argc, const char **argv)
       export_crush = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--import_crush", (char*)NULL)) {
       import_crush = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--export_snapshot", (char*)NULL)) {
+      export_snapshot = val;
+    } else if (ceph_argparse_flag(args, i, "--snapshot", (char*)NULL)) {
+      from_snapshot = true;
     } else if (ceph_argparse_witharg(args, i, &val, "--test_map_pg", (char*)NULL)) {
       test_map_pg = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--test_map_object", (char*)NULL)) {
@@ -252,6 +262,13 @@ int main(int argc, const char **argv)
     usage();
   }
   fn = args[0];
+  if (from_snapshot &&
+      (createsimple || create_from_conf || clobber || upmap_save ||
+       !import_crush.empty())) {
+    cerr << me << ": a snapshot is read-only, use --export-snapshot to "
+	 << "write one" << std::endl;
+    usage();
+  }
 
   if (range_first >= 0 && range_last >= 0) {
     set<OSDMap*> maps;
@@ -279,6 +296,7 @@ int main(int argc, const char **argv)
   
   OSDMap osdmap;
   bufferlist bl;
+  OSDMapSnapshot snapshot;
 
   cerr << me << ": osdmap file '" << fn << "'" << std::endl;
   
@@ -286,7 +304,17 @@ int main(int argc, const char **argv)
   struct stat st;
   if (!createsimple && !create_from_conf && !clobber) {
     std::string error;
-    r = bl.read_file(fn.c_str(), &error);
+    if (from_snapshot) {
+      // decode in place from the mapped file
+      r = snapshot.open(fn);
+      if (r == 0) {
+	bl = snapshot.get_map_bl();
+      } else {
+	error = cpp_strerror(r);
+      }
+    } else {
+      r = bl.read_file(fn.c_str(), &error);
+    }
     if (r == 0) {
       try {
 	osdmap.decode(bl);
@@ -388,10 +416,33 @@ int main(int argc, const char **argv)
     if (!pools.empty())
       cout << " limiting to pools " << upmap_pools << " (" << pools << ")"
 	   << std::endl;
+    auto threads =
+      g_conf().get_val<uint64_t>("osd_calc_pg_upmaps_threads");
+    ThreadPool tp(g_ceph_context, "osdmaptool::upmap_tp", "upmap_tp",
+		  threads);
+    ParallelPGMapper mapper(g_ceph_context, &tp);
+    OSDMap::pg_batch_runner_t runner;
+    if (threads > 1) {
+      tp.start();
+      runner = mapper.get_runner(64);
+    }
+    OSDMap::upmap_calc_stats_t stats;
     int changed = osdmap.calc_pg_upmaps(
       g_ceph_context, upmap_deviation,
       upmap_max, pools,
-      &pending_inc);
+      &pending_inc, runner, &stats);
+    if (threads > 1) {
+      tp.stop();
+    }
+    cout << "upmap: " << changed << " changes in " << stats.rounds
+	 << " rounds (" << stats.evaluated << " candidate pgs), stddev "
+	 << stats.start_stddev << " -> " << stats.end_stddev
+	 << " in " << stats.elapsed << "s";
+    if (stats.elapsed > 0)
+      cout << " (" << stats.rounds / stats.elapsed << " rounds/s)";
+    if (stats.timed_out)
+      cout << ", out of time";
+    cout << std::endl;
     if (changed) {
       print_inc_upmaps(pending_inc, upmap_fd);
       if (upmap_save) {
@@ -501,6 +552,11 @@ int main(int argc, const char **argv)
     int max_size = 0;
     if (test_random)
       srand(getpid());
+    // the stored mapping is good as long as the map was left alone
+    OSDMapMapping mapping;
+    bool use_mapping = !modified && !mark_up_in && marked_out < 0 &&
+      !clear_temp && pg_num <= 0 && snapshot.is_open() &&
+      snapshot.get_mapping(osdmap, &mapping);
     auto& pools = osdmap.get_pools();
     for (auto p = pools.begin(); p != pools.end(); ++p) {
       if (pool != -1 && p->first != pool)
@@ -527,7 +583,9 @@ int main(int argc, const char **argv)
                                 &acting, &acting_primary);
 	 osds = acting;
 	 primary = acting_primary;
-       } else {
+       } else if (use_mapping) {
+	  mapping.get(pgid, nullptr, nullptr, &osds, &primary);
+	} else {
 	  osdmap.pg_to_acting_osds(pgid, &osds, &primary);
 	}
 	size[osds.size()]++;
@@ -646,7 +704,8 @@ int main(int argc, const char **argv)
   }
 
   if (!print && !health && !tree && !modified &&
-      export_crush.empty() && import_crush.empty() && 
+      export_crush.empty() && import_crush.empty() &&
+      export_snapshot.empty() &&
       test_map_pg.empty() && test_map_object.empty() &&
       !test_map_pgs && !test_map_pgs_dump && !test_map_pgs_dump_all &&
       !upmap && !upmap_cleanup) {
@@ -701,7 +760,20 @@ int main(int argc, const char **argv)
       return 1;
     }
   }
-  
+  if (!export_snapshot.empty()) {
+    OSDMapMapping mapping;
+    mapping.update(osdmap);
+    bufferlist sbl;
+    osdmap.encode(sbl, CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED);
+    int r = OSDMapSnapshot::write(export_snapshot, osdmap, sbl, &mapping);
+    if (r < 0) {
+      cerr << me << ": error writing snapshot to '" << export_snapshot
+	   << "': " << cpp_strerror(r) << std::endl;
+      return 1;
+    }
+    cout << me << ": exported epoch " << osdmap.get_epoch()
+	 << " snapshot to " << export_snapshot << std::endl;
+  }
 
   return 0;
 }